@@ -0,0 +1,30 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+#include <functional>
+#include <string>
+///\file AtomicFile.h
+/// \brief Write files so that readers never see them partially written.
+///
+/// ParaView may reload a PVD collection or a VTK file while it is written, and
+/// other `lignumvtk` runs read the HDF5 tree index. The file is written first to a
+/// temporary file in the same directory and then renamed, which replaces the file in one step.
+namespace lignumvtk{
+
+  ///\brief Temporary file name for writing \p file_name
+  ///
+  ///The temporary file is in the same directory so that the rename does not move data.
+  ///The extension is kept, VTK writers and readers use it to check the file type.
+  ///\param file_name File name
+  ///\return *tmp_* prefixed file name in the directory of \p file_name
+  std::string TemporaryFileName(const std::string& file_name);
+  ///\brief Write file with a temporary file and rename it
+  ///
+  ///The temporary file is removed if \p write fails.
+  ///\param file_name File name
+  ///\param write Write the file given as argument, return true on success
+  ///\retval true The file is written
+  ///\retval false \p write failed or the temporary file could not be renamed
+  ///\sa TemporaryFileName
+  bool WriteFileAtomically(const std::string& file_name,const std::function<bool(const std::string&)>& write);
+}
+#endif
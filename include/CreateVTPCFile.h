@@ -3,15 +3,31 @@
 #include <Lignum.h>
 #include <XMLTree.h>
 #include <HDF5ToLignum.h>
+#include <HDF5TreeColumns.h>
+#include <HDF5TreePrefetch.h>
 #include <LignumVTK.h>
 #include <LignumVTKXML.h>
 #include <LignumVTKTree.h>
+#include <PVDFile.h>
+#include <TreeCache.h>
+#include <LignumVTKSnapshot.h>
+#include <XMLStreamTreeReader.h>
+#include <XMLDirectTreeReader.h>
 ///\file CreateVTPCFile.h
 /// \brief Main functions to call to create VTK/VTPC files.
 
 using namespace lignumxml;
 namespace lignumvtk{
 
+  ///\brief Parameter sweep result file suffix
+  const string SWEEP_CSV_SUFFIX="_sweep.csv";
+  ///\brief Attempts for a year in follow mode before it is skipped, the newest year is always tried again
+  const int FOLLOW_YEAR_RETRIES=3;
+  ///\brief Estimated bytes for one point in VTK/VTP files
+  ///
+  ///Point and normal as 32-bit floats, eight tube scalars as doubles and two connectivity ids.
+  const double VTP_POINT_BYTES=3*4+3*4+8*8+2*8;
+
   ///\brief Find HDF5 dataset path with substring
   class FindSubString{
   public:
@@ -73,8 +89,22 @@ namespace lignumvtk{
   ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
   ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
   ///Default value lignumvtk::SPLINE_RESOLUTION.
+  ///\param snapshot_file Write collected tree data also to snapshot file, empty string for no snapshot
+  ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
+  ///\note If \p output_file is empty only the snapshot file is written
+  int CreateVTPCFileFromXML(const string& input_file,const string& output_file, int spline_resolution, int view,
+			    const string& snapshot_file="");
+  ///\brief Create VTK/VTPC file from snapshot file.
+  ///
+  ///Trees are not read from XML and reconstructed, the collected data is read from the snapshot.
+  ///The snapshot can contain both conifers and broadleaved trees.
+  ///\param snapshot_file Snapshot file
+  ///\param output_file VTK/VTPC file
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
   ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
-  int CreateVTPCFileFromXML(const string& input_file,const string& output_file, int spline_resolution, int view);
+  ///\sa TSDataSnapshotReader
+  int CreateVTPCFileFromSnapshot(const string& snapshot_file,const string& output_file,int spline_resolution,int view);
   ///\brief Create VTK/VTPC file from Lignum HDF5 file.
   ///
   ///Create VTK/VTPC representation for all trees.
@@ -84,8 +114,11 @@ namespace lignumvtk{
   ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
   ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
   ///Default value lignumvtk::SPLINE_RESOLUTION.
+  ///\param cache_dir TreeCache directory, empty string for no cache
+  ///\param snapshot_file Write collected tree data also to snapshot file, empty string for no snapshot
   ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
-  int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file,int year, int spline_resolution,int view);
+  int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file,int year, int spline_resolution,int view,
+			     const string& cache_dir="",const string& snapshot_file="");
   ///\brief Create VTK/VTPC file from Lignum HDF5 file.
   ///
   ///Create VTK/VTPC representation for trees trees matching \p dataset_path string.
@@ -96,8 +129,211 @@ namespace lignumvtk{
   ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
   ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
   ///Default value lignumvtk::SPLINE_RESOLUTION.
+  ///\param cache_dir TreeCache directory, empty string for no cache
+  ///\param snapshot_file Write collected tree data also to snapshot file, empty string for no snapshot
   ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
   int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file, const string& dataset_path, bool exact_match,
-			     int spline_resolution,int view);  
+			     int spline_resolution,int view,const string& cache_dir="",const string& snapshot_file="");
+  ///\brief Create VTK/VTPC file from a list of HDF5 tree datasets.
+  ///
+  ///Common implementation for the HDF5 conversions. The HDF5 file is already open in \p hdf5lignum
+  ///so that the same reader can be used for several VTK/VTPC files. HDF5_PREFETCH_TREES trees
+  ///are read ahead with HDF5TreePrefetcher.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param dataset_paths HDF5 dataset paths for trees 
+  ///\param output_file VTK/VTPC file
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\param cache Tree cache, trees found in the cache are not reconstructed. No cache if \p nullptr.
+  ///\param snapshot Snapshot writer for the collected tree data. No snapshot if \p nullptr.
+  ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
+  ///\note If \p output_file is empty only the snapshot is written
+  int CreateVTPCFileFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& dataset_paths,const string& output_file,
+			     int spline_resolution,int view,TreeCache* cache=nullptr,TSDataSnapshotWriter* snapshot=nullptr);
+  ///\brief Create VTK/VTPC file and snapshot file from a list of HDF5 tree datasets.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param dataset_paths HDF5 dataset paths for trees 
+  ///\param output_file VTK/VTPC file, empty string for snapshot only
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\param cache_dir TreeCache directory, empty string for no cache
+  ///\param snapshot_file Snapshot file, empty string for no snapshot
+  ///\return EXIT_SUCCESS if the files are created, EXIT_FAILURE otherwise
+  int CreateVTPCFileFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& dataset_paths,const string& output_file,
+			     int spline_resolution,int view,const string& cache_dir,const string& snapshot_file);
+  ///\brief Parse year range from the command line
+  ///
+  ///The range is *first:last:step* or *first:last* with step 1. A single number is a one year range.
+  ///\param range Year range string, e.g. 10:80:5
+  ///\return Years in the range, empty vector if the range is not valid 
+  vector<int> ParseYearRange(const string& range);
+  ///\brief Parse tree reader from the command line
+  ///\param name *dom*, *stream* or *direct*
+  ///\param[out] reader The tree reader
+  ///\return true if \p name is valid, false otherwise
+  ///\sa XML_TREE_READER
+  bool ParseTreeReader(const string& name,TREE_READER& reader);
+  ///\brief Create VTK/VTPC file for each year and ParaView PVD collection file for the years.
+  ///
+  ///The HDF5 file is opened once and tree datasets are collected in one pass over the
+  ///main group. Each year is written to its own VTK/VTPC file next to the PVD file,
+  ///named after the PVD file and the year. The simulation year is the PVD time value.
+  ///Years without tree datasets are skipped.
+  ///\param input_file Lignum HDF5 file
+  ///\param output_file ParaView PVD collection file
+  ///\param years Simulation years
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\param cache_dir TreeCache directory, empty string for no cache
+  ///\return EXIT_SUCCESS if PVD file is created, EXIT_FAILURE otherwise
+  ///\sa PVDFile
+  int CreatePVDFileFromHDF5(const string& input_file,const string& output_file,const vector<int>& years,
+			    int spline_resolution,int view,const string& cache_dir="");
+  ///\brief Follow HDF5 file written by a running simulation and convert each new year.
+  ///
+  ///The file is opened as SWMR reader and polled for new year groups. HDF5 readers do not see
+  ///groups created after the file was opened, so the file is opened again for each poll.
+  ///A year is converted when a later year exists, or when the file has not changed since the previous poll.
+  ///Each year is written to its own VTK/VTPC file and appended to the PVD file as in CreatePVDFileFromHDF5.
+  ///A year that cannot be read yet is tried again in the next poll. A year that is not the newest
+  ///is skipped after FOLLOW_YEAR_RETRIES failed attempts. The global HDF5_ACCESS_OPTIONS are
+  ///set for SWMR reading and restored at the end.
+  ///\param input_file Lignum HDF5 file, may not exist yet
+  ///\param output_file ParaView PVD collection file
+  ///\param poll_seconds Seconds between polls
+  ///\param idle_seconds Stop when there are no changes for \p idle_seconds, 0 to follow until interrupted
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\param cache_dir TreeCache directory, empty string for no cache
+  ///\return EXIT_SUCCESS if PVD file is created, EXIT_FAILURE otherwise
+  ///\note The simulation should close the file after each year. If the file is kept open in the normal
+  ///write mode HDF5 file locking prevents reading unless `HDF5_USE_FILE_LOCKING=FALSE` is set.
+  ///SWMR write mode is not supported, it does not allow new year groups and tree datasets.
+  int CreatePVDFileFollowHDF5(const string& input_file,const string& output_file,int poll_seconds,int idle_seconds,
+			      int spline_resolution,int view,const string& cache_dir="");
+  ///\brief VTK/VTPC file name for one year in a PVD collection
+  ///\param pvd_file ParaView PVD collection file
+  ///\param year Simulation year
+  ///\return The PVD file name with the year appended and *vtpc* extension
+  string YearVTPCFileName(const string& pvd_file,int year);
+  ///\brief Spline and tube parameter values for the parameter sweep
+  ///\sa ParseSweep CreateVTPCFileSweep
+  class SweepParameters{
+  public:
+    vector<int> spline;///< Spline resolutions
+    vector<int> sides;///< Tube numbers of sides
+  };
+  ///\brief Parse parameter sweep from the command line
+  ///
+  ///The sweep is *spline=5,10,20;sides=6,12,30*. A parameter not in the sweep
+  ///has one value, \p spline_resolution or lignumvtk::TUBE_NUMBER_OF_SIDES.
+  ///\param sweep Parameter sweep string
+  ///\param[out] parameters Parameter values
+  ///\param spline_resolution Spline resolution if *spline* is not in the sweep
+  ///\return true if \p sweep is valid, false otherwise
+  bool ParseSweep(const string& sweep,SweepParameters& parameters,int spline_resolution=SPLINE_SEGMENT_RESOLUTION);
+  ///\brief Read one tree from Lignum XML and collect the tree data
+  ///
+  ///The tree is read with the reader in XML_TREE_READER. TREE_READER::DIRECT reads the data
+  ///without the Lignum tree.
+  ///\param input Lignum XML file name or Lignum XML string
+  ///\param is_file \p input is file name
+  ///\param tree_type Tree type, "Cf" for coniferous or "Hw" for broadleaved
+  ///\param tree_id Tree id tag for vtkAssembly
+  ///\param[out] ct Collected tree data
+  ///\return true if the tree is collected, false otherwise
+  bool CollectTreeFromXML(const string& input,bool is_file,const string& tree_type,const string& tree_id,CollectedTree& ct);
+  ///\brief Read Lignum XML file and collect the tree data
+  ///\param input_file Lignum XML file
+  ///\param[out] stand The collected tree appended
+  ///\return EXIT_SUCCESS if the tree is collected, EXIT_FAILURE otherwise
+  int CollectStandFromXML(const string& input_file,CollectedStand& stand);
+  ///\brief Read one tree from Lignum HDF5 file and collect the tree data
+  ///
+  ///Trees in the columnar layout are read without parsing. For XML trees the tree type
+  ///is checked from the beginning of the XML string and the tree is read with CollectTreeFromXML.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param tree_path HDF5 tree dataset or tree group path, also the tree id
+  ///\param[out] ct Collected tree data
+  ///\return true if the tree is collected, false otherwise
+  bool CollectTreeFromHDF5(HDF5ToLignum& hdf5lignum,const string& tree_path,CollectedTree& ct);
+  ///\brief Read trees from Lignum HDF5 file and collect the tree data
+  ///
+  ///The tree type is checked for each tree, see CollectTreeFromHDF5.
+  ///HDF5_PREFETCH_TREES trees are read ahead with HDF5TreePrefetcher.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param dataset_paths HDF5 dataset paths for trees
+  ///\param[out] stand The collected trees appended
+  ///\return EXIT_SUCCESS if the trees are collected, EXIT_FAILURE otherwise
+  int CollectStandFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& dataset_paths,CollectedStand& stand);
+  ///\brief Select HDF5 tree datasets
+  ///
+  ///The selection is by \p year, by \p dataset with exact match or by \p substring in this order.
+  ///All tree datasets are selected if none is given. The datasets are looked up from the tree index.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param year Simulation year, -1 if not used
+  ///\param dataset HDF5 dataset name, empty string if not used
+  ///\param substring HDF5 dataset path substring, empty string if not used
+  ///\return HDF5 dataset paths for trees
+  vector<string> SelectTreeDataSets(HDF5ToLignum& hdf5lignum,int year,const string& dataset,const string& substring);
+  ///\brief List HDF5 tree datasets grouped by year without reading the trees
+  ///
+  ///Only the links in the year groups and the dataset headers are read, so the listing is fast
+  ///also for large files. Each tree is listed with its storage size and each year with the number
+  ///of trees and their total size. The trees are filtered by \p year, \p dataset and \p substring if given.
+  ///For the columnar layout the estimated VTK/VTPC size is listed too, see EstimateVTPCFileSize.
+  ///XML trees have no estimate, the number of segments is not known without parsing the XML.
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param year Simulation year, -1 if not used
+  ///\param dataset HDF5 dataset name, empty string if not used
+  ///\param substring HDF5 dataset path substring, empty string if not used
+  ///\param spline_resolution Number of spline points for tubes for the estimate
+  ///\param nsides Number of tube sides for the estimate
+  ///\return EXIT_SUCCESS
+  int ListTreeDataSets(HDF5ToLignum& hdf5lignum,int year,const string& dataset,const string& substring,
+		       int spline_resolution=SPLINE_SEGMENT_RESOLUTION,int nsides=TUBE_NUMBER_OF_SIDES);
+  ///\brief Estimated size of VTK/VTPC file for one tree in the columnar layout
+  ///
+  ///An axis with \e n points is a spline with \p spline_resolution * \e n points and a tube has
+  ///\p nsides points around each spline point. Conifers have three tubes (foliage, sapwood and heartwood),
+  ///broadleaved trees one tube and a leaf with four and a petiole with two points. A tree without
+  ///leaves is counted as a conifer. Each point takes VTP_POINT_BYTES.
+  ///\param segment_rows Number of rows in *Segments*
+  ///\param axes Number of rows in *Axes*
+  ///\param leaves Number of rows in *Leaves*
+  ///\param spline_resolution Number of spline points for tubes
+  ///\param nsides Number of tube sides
+  ///\return Estimated size in bytes
+  double EstimateVTPCFileSize(hsize_t segment_rows,hsize_t axes,hsize_t leaves,int spline_resolution,int nsides);
+  ///\brief Create VTK/VTPC file from collected trees
+  ///
+  ///Conifers and broadleaved trees can be mixed, see StandLignumToVTK.
+  ///\param stand Collected trees
+  ///\param output_file VTK/VTPC file
+  ///\param spline_resolution Number of spline points for tubes, higher values means more spline points.
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\param nsides Number of tube sides
+  ///\return EXIT_SUCCESS if VTK/VTPC file is created, EXIT_FAILURE otherwise
+  int CreateVTPCFileFromStand(CollectedStand& stand,const string& output_file,int spline_resolution,int view,
+			      int nsides=TUBE_NUMBER_OF_SIDES);
+  ///\brief Create VTK/VTPC files for each parameter combination from the same collected trees.
+  ///
+  ///The trees are read and collected once. Each spline and sides combination is written to
+  ///its own VTK/VTPC file. The number of points and cells, time to create and write the meshes
+  ///and the file size (VTK/VTPC file and its VTK/VTP files) are written for each combination
+  ///to CSV file named after \p output_file with suffix lignumvtk::SWEEP_CSV_SUFFIX.
+  ///\param stand Collected trees
+  ///\param output_file VTK/VTPC file name for the file name stem and directory
+  ///\param parameters Parameter sweep values
+  ///\param view Choose view for the partitioned dataset collection: tree view = 0, component view = 1.
+  ///\return EXIT_SUCCESS if VTK/VTPC files are created, EXIT_FAILURE otherwise
+  ///\sa SweepVTPCFileName
+  int CreateVTPCFileSweep(CollectedStand& stand,const string& output_file,const SweepParameters& parameters,int view);
+  ///\brief VTK/VTPC file name for one parameter combination in a parameter sweep
+  ///\param output_file VTK/VTPC file
+  ///\param spline_resolution Spline resolution
+  ///\param nsides Tube number of sides
+  ///\return \p output_file with the spline resolution and number of sides appended, e.g. *File_spline5_sides6.vtpc*
+  string SweepVTPCFileName(const string& output_file,int spline_resolution,int nsides);
 }
 #endif
@@ -0,0 +1,324 @@
+#ifndef CREATEVOXELSPACEFILE_H
+#define CREATEVOXELSPACEFILE_H
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+#include <HDF5ToLignum.h>
+#include <VoxelSpaceToVTK.h>
+#include <PVDFile.h>
+#include <VoxelExpression.h>
+///\file CreateVoxelSpaceFile.h
+/// \brief Main functions to call to create VTK files from HDF5 voxel spaces.
+///
+/// A voxel space is written either as a single VTK/VTS or VTK/VTI file or
+/// streamed in slabs of voxel layers in z dimension into pieces of a parallel
+/// VTK/PVTS or VTK/PVTI file. Streaming reads one slab at a time from HDF5
+/// so voxel spaces larger than available memory can be converted.
+/// Mostly empty voxel spaces can be written sparse as VTK/VTU file with
+/// the occupied voxels only. A multi-resolution pyramid of the voxel space is
+/// written as a VTK/VTM collection of levels. Several voxel spaces, e.g. one for
+/// each simulation year, are converted in parallel to a ParaView PVD time series.
+/// Isosurfaces, e.g. crown envelopes, are contoured at conversion time to VTK/VTP files.
+namespace lignumvtk{
+
+  ///\brief Parallel VTK structured grid file extension
+  const std::string PVTS_EXTENSION=".pvts";
+  ///\brief Parallel VTK image data file extension
+  const std::string PVTI_EXTENSION=".pvti";
+  ///\brief Default number of voxel layers in z dimension for one piece
+  const int VOXEL_SLAB_SIZE=64;
+  ///\brief Maximum number of coarser levels in a voxel space pyramid
+  const int VOXEL_PYRAMID_MAX_LEVELS=10;
+  ///\brief Point extent of a grid or a piece: i0,i1,j0,j1,k0,k1
+  typedef std::array<int,6> GridExtent;
+
+  ///\brief Options for voxel space conversion
+  class VoxelSpaceOptions{
+  public:
+    VoxelSpaceOptions():voxel_edge(0.0),slab(0),voi{0,-1,0,-1,0,-1},stride(1),
+			association(VOXEL_DATA_ASSOCIATION::BOTH),sparse_threshold(0.0),pyramid(0),derive_threads(0){}
+    double voxel_edge;///< Voxel edge length, 0 for the voxel edge lengths in the HDF5 file
+    int slab;///< Number of voxel layers in z for each piece, 0 for VOXEL_SLAB_SIZE
+    GridExtent voi;///< Volume of interest, first and last voxel in x,y,z. Empty range for the whole dimension.
+    int stride;///< Select every stride'th voxel in x,y,z
+    std::vector<std::string> attributes;///< Data columns by name, empty vector for all columns
+    VOXEL_DATA_ASSOCIATION association;///< Voxel data as cell data, point data or both
+    double sparse_threshold;///< Voxel is occupied if one of its data values is above the threshold (VTK/VTU only)
+    int pyramid;///< Number of coarser levels in the pyramid (VTK/VTM only)
+    std::map<std::string,VOXEL_AGGREGATE> aggregate;///< Aggregation by attribute name, VOXEL_AGGREGATE::MEAN if not given
+    std::string derive;///< Derived fields, e.g. *LAD=A/volume; ratio=Qabs/Qin*, see VoxelExpressions
+    unsigned int derive_threads;///< Threads to evaluate the derived fields, 0 for the number of hardware threads
+    std::string iso_attribute;///< Attribute for isosurfaces
+    std::vector<double> iso_values;///< Isosurface values, empty vector for no isosurfaces
+  };
+
+  ///\brief Selected voxels and the grid for them
+  ///\sa SelectVoxelSpace
+  class VoxelSpaceFrame{
+  public:
+    GridExtent voi;///< First and last selected voxel in x,y,z
+    int stride;///< Stride in x,y,z
+    int n[3];///< Number of selected voxels in x,y,z
+    double origin[3];///< Coordinates of the first selected voxel
+    double spacing[3];///< Distance between selected voxels in x,y,z
+    std::vector<hsize_t> columns;///< Selected data columns in ascending order, empty vector for all columns
+    std::vector<std::string> attr_names;///< Names of the selected data columns followed by the derived fields
+    VoxelExpressions derive;///< Derived fields appended to the data read
+  };
+
+  ///\brief Isosurface attribute collected while the voxel space is read for a voxel space file
+  ///
+  ///The voxel space is read once for both the voxel space file and its isosurfaces.
+  ///\sa CreateVoxelSpaceFile WriteIsosurfaceFile
+  class IsosurfaceGrid{
+  public:
+    IsosurfaceGrid():column(-1),nd(0),n{0,0,0},origin{0.0,0.0,0.0},spacing{1.0,1.0,1.0}{}
+    ///\brief Set the grid for the selected voxels
+    ///\param frame Selected voxels and the grid for them
+    ///\param iso_attribute Attribute for isosurfaces
+    ///\return true if \p iso_attribute is in the selected attributes, false otherwise
+    bool init(const VoxelSpaceFrame& frame,const std::string& iso_attribute);
+    ///\brief Check the attribute is collected
+    bool isValid()const{return column >= 0;}
+    ///\brief Copy the isosurface attribute from voxel layers read from HDF5
+    ///\param data Voxel data in HDF5 order, the selected attributes and derived fields for each voxel
+    ///\param nk Number of voxel layers in \p data
+    ///\param k0 First voxel layer of \p data
+    void insertVoxelSpaceData(const double* data,int nk,int k0);
+    std::vector<double> values;///< Attribute values in VTK point order, NaN as 0
+    int column;///< Attribute column in the voxel data, -1 if not selected
+    int nd;///< Number of attributes for each voxel
+    int n[3];///< Number of selected voxels in x,y,z
+    double origin[3];///< Coordinates of the first selected voxel
+    double spacing[3];///< Distance between selected voxels in x,y,z
+  };
+
+  ///\brief Parse volume of interest from the command line
+  ///
+  ///The volume of interest is *i0:i1,j0:j1,k0:k1* with the first and the last voxel index
+  ///in x,y,z dimensions.
+  ///\param range Volume of interest string
+  ///\param[out] voi Volume of interest
+  ///\return true if \p range is valid, false otherwise
+  bool ParseVoxelRange(const std::string& range,GridExtent& voi);
+  ///\brief Parse comma separated names from the command line
+  ///\param list Names separated with commas, e.g. *Qabs,LAD*
+  ///\return The names
+  std::vector<std::string> ParseNameList(const std::string& list);
+  ///\brief Parse data association from the command line
+  ///\param name *cell*, *point* or *both*
+  ///\param[out] association Data association
+  ///\return true if \p name is valid, false otherwise
+  bool ParseDataAssociation(const std::string& name,VOXEL_DATA_ASSOCIATION& association);
+  ///\brief Parse aggregation of attributes for the pyramid levels from the command line
+  ///\param list Attribute names with aggregation, e.g. *A:sum,Wf:sum,Qabs:mean*
+  ///\param[out] aggregate Aggregation by attribute name
+  ///\return true if \p list is valid, false otherwise
+  bool ParseAggregate(const std::string& list,std::map<std::string,VOXEL_AGGREGATE>& aggregate);
+  ///\brief Parse isosurface attribute and values from the command line
+  ///\param spec Attribute and values, e.g. *LAD:0.5,1.0*
+  ///\param[out] attribute Attribute name
+  ///\param[out] values Isosurface values
+  ///\return true if \p spec is valid, false otherwise
+  bool ParseIsoValues(const std::string& spec,std::string& attribute,std::vector<double>& values);
+  ///\brief Selected voxels and the grid for them
+  ///
+  ///The origin of the grid is the position of the first selected voxel and the spacing is
+  ///the voxel edge length times the stride. Data columns are selected by attribute names
+  ///and kept in the order of the dataset. The derived fields are parsed with the voxel volume
+  ///of the grid and appended after the selected data columns.
+  ///\param gdata Voxel space dimensions and voxel edge lengths
+  ///\param col_names Data column names in the dataset
+  ///\param options Conversion options
+  ///\param[out] frame Selected voxels and the grid for them
+  ///\return true if the selection is inside the voxel space, the attributes are found and
+  ///the derived fields are valid, false otherwise
+  bool SelectVoxelSpace(const GridData& gdata,const std::vector<std::string>& col_names,const VoxelSpaceOptions& options,
+			VoxelSpaceFrame& frame);
+  ///\brief Grid type from the output file extension
+  ///\param file_name VTK file
+  ///\retval VOXEL_GRID_TYPE::IMAGE_DATA for *vti* and *pvti* files
+  ///\retval VOXEL_GRID_TYPE::STRUCTURED_GRID otherwise
+  VOXEL_GRID_TYPE VoxelGridType(const std::string& file_name);
+  ///\brief Check for parallel VTK file extension
+  ///\param file_name VTK file
+  ///\return true for *pvti* and *pvts* files, false otherwise
+  bool IsParallelVoxelSpaceFile(const std::string& file_name);
+  ///\brief Check for sparse VTK file extension
+  ///\param file_name VTK file
+  ///\return true for *vtu* files, false otherwise
+  bool IsSparseVoxelSpaceFile(const std::string& file_name);
+  ///\brief Check for isosurface file extension
+  ///\param file_name VTK file
+  ///\return true for *vtp* files, false otherwise
+  bool IsIsosurfaceFile(const std::string& file_name);
+  ///\brief Isosurface file name next to the voxel space file
+  ///\param output_file Voxel space VTK file
+  ///\return *stem_iso.vtp*
+  std::string IsosurfaceFileName(const std::string& output_file);
+  ///\brief Check for voxel space pyramid file extension
+  ///\param file_name VTK file
+  ///\return true for *vtm* files, false otherwise
+  bool IsPyramidVoxelSpaceFile(const std::string& file_name);
+  ///\brief Create VTK file from HDF5 voxel space
+  ///
+  ///The output file extension decides the grid type and if the voxel space is streamed to pieces.
+  ///VTK/VTP output file has only the isosurfaces. For other output files the isosurfaces,
+  ///if any, are written next to the voxel space file, see IsosurfaceFileName. The isosurface
+  ///attribute is then taken from the voxel space data read for the file if it is selected.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/VTS, VTK/VTI, VTK/PVTS, VTK/PVTI, VTK/VTU, VTK/VTM or VTK/VTP file
+  ///\param options Conversion options
+  ///\return EXIT_SUCCESS if VTK file is created, EXIT_FAILURE otherwise
+  ///\sa CreateGridVoxelSpaceFile CreateParallelVoxelSpaceFile CreateSparseVoxelSpaceFile CreatePyramidVoxelSpaceFile
+  ///\sa CreateVoxelSpaceIsosurface
+  int CreateVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+			   const VoxelSpaceOptions& options);
+  ///\brief Create single VTK/VTS or VTK/VTI file from HDF5 voxel space
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/VTS or VTK/VTI file
+  ///\param options Conversion options
+  ///\param iso Isosurface attribute collected from the data read, nullptr if not needed
+  ///\return EXIT_SUCCESS if VTK file is created, EXIT_FAILURE otherwise
+  int CreateGridVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+			       const VoxelSpaceOptions& options,IsosurfaceGrid* iso=nullptr);
+  ///\brief Contour isosurfaces from HDF5 voxel space to VTK/VTP file
+  ///
+  ///The attribute VoxelSpaceOptions::iso_attribute, read from HDF5 or derived, is contoured
+  ///at VoxelSpaceOptions::iso_values with vtkFlyingEdges3D. The surfaces have normals
+  ///and the isosurface value as scalars.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/VTP file
+  ///\param options Conversion options
+  ///\return EXIT_SUCCESS if VTK file is created, EXIT_FAILURE otherwise
+  int CreateVoxelSpaceIsosurface(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+				 const VoxelSpaceOptions& options);
+  ///\brief Contour isosurfaces from collected isosurface attribute to VTK/VTP file
+  ///\param iso Isosurface attribute and the grid
+  ///\param output_file VTK/VTP file
+  ///\param options Conversion options
+  ///\return EXIT_SUCCESS if VTK file is created, EXIT_FAILURE otherwise
+  ///\sa CreateVoxelSpaceIsosurface
+  int WriteIsosurfaceFile(const IsosurfaceGrid& iso,const std::string& output_file,const VoxelSpaceOptions& options);
+  ///\brief Stream HDF5 voxel space to pieces of a parallel VTK file
+  ///
+  ///The selected voxels are read in slabs of VoxelSpaceOptions::slab voxel layers in z dimension with
+  ///HDF5 hyperslab selections. Consecutive pieces share one layer of points so that the cells
+  ///between the slabs are not lost. Each piece is written to its own VTK/VTS or VTK/VTI file
+  ///in a directory named after \p output_file.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/PVTS or VTK/PVTI file
+  ///\param options Conversion options
+  ///\param iso Isosurface attribute collected from the data read, nullptr if not needed
+  ///\return EXIT_SUCCESS if VTK files are created, EXIT_FAILURE otherwise
+  int CreateParallelVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+				   const VoxelSpaceOptions& options,IsosurfaceGrid* iso=nullptr);
+  ///\brief Write occupied voxels of HDF5 voxel space to VTK/VTU file
+  ///
+  ///The selected voxels are read in slabs of VoxelSpaceOptions::slab voxel layers in z dimension
+  ///and only voxels with at least one data value above VoxelSpaceOptions::sparse_threshold
+  ///are kept as hexahedra. The data is written as cell data.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/VTU file
+  ///\param options Conversion options
+  ///\param iso Isosurface attribute collected from the data read, nullptr if not needed
+  ///\return EXIT_SUCCESS if VTK file is created, EXIT_FAILURE otherwise
+  ///\sa SparseVoxelSpaceToVTK
+  int CreateSparseVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+				 const VoxelSpaceOptions& options,IsosurfaceGrid* iso=nullptr);
+  ///\brief Write multi-resolution pyramid of HDF5 voxel space to VTK/VTM file
+  ///
+  ///The selected voxels are read once in slabs of voxel layers in z dimension. The slab size
+  ///is rounded up to a multiple of 2^VoxelSpaceOptions::pyramid. Level 0 is the full resolution
+  ///written in pieces of a VTK/PVTI file, one piece for each slab. Level \e l aggregates
+  ///2^\e l x 2^\e l x 2^\e l voxels to one cell and is written to a VTK/VTI file.
+  ///The VTK/VTM file refers to the levels as blocks named *Level0*, *Level1*, etc.
+  ///The files for the levels are in a directory named after \p output_file.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param output_file VTK/VTM file
+  ///\param options Conversion options
+  ///\param iso Isosurface attribute collected from the data read, nullptr if not needed
+  ///\return EXIT_SUCCESS if VTK files are created, EXIT_FAILURE otherwise
+  ///\sa VoxelPyramid
+  int CreatePyramidVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const std::string& dataset_name,const std::string& output_file,
+				  const VoxelSpaceOptions& options,IsosurfaceGrid* iso=nullptr);
+  ///\brief Convert voxel spaces in parallel to a ParaView PVD time series
+  ///
+  ///Each dataset is converted with CreateVoxelSpaceFile to its own VTK file next to the PVD file.
+  ///The datasets are processed by \p threads worker threads. HDF5 reads are serialised
+  ///by HDF5ToVoxelSpace, the data transpose, compression and writing of VTK files run concurrently.
+  ///The hardware threads are shared between the workers for the derived fields.
+  ///The time value in the PVD file is the year in the dataset name, see VoxelSpaceDataSetYear.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param datasets VoxelSpace dataset names
+  ///\param output_file PVD file
+  ///\param extension VTK file extension for the datasets, e.g. *.vti*
+  ///\param options Conversion options
+  ///\param threads Number of worker threads, 0 for the number of hardware threads
+  ///\return EXIT_SUCCESS if all VTK files and the PVD file are created, EXIT_FAILURE otherwise
+  int CreateVoxelSpaceCollection(HDF5ToVoxelSpace& hdf5vs,const std::vector<std::string>& datasets,const std::string& output_file,
+				 const std::string& extension,const VoxelSpaceOptions& options,unsigned int threads=0);
+  ///\brief List voxel spaces without reading the voxel data
+  ///
+  ///For each dataset the number of voxels, data columns, voxel edge lengths, storage size in the HDF5 file
+  ///and the estimated size of a VTK/VTI file with all attributes as cell and point data are listed.
+  ///Only the dataset headers and attributes are read.
+  ///\param hdf5vs HDF5 voxel space file reader
+  ///\param pattern Substring for dataset paths, empty string for all datasets
+  ///\return EXIT_SUCCESS if datasets are found, EXIT_FAILURE otherwise
+  int ListVoxelSpaces(HDF5ToVoxelSpace& hdf5vs,const std::string& pattern);
+  ///\brief Estimated size of binary VTK/VTI file for a voxel space
+  ///\param nx Number of voxels in X dimension
+  ///\param ny Number of voxels in Y dimension
+  ///\param nz Number of voxels in Z dimension
+  ///\param nd Number of data columns
+  ///\param association Cell data, point data or both
+  ///\return Size of the data arrays in bytes
+  double EstimateVoxelSpaceFileSize(int nx,int ny,int nz,int nd,VOXEL_DATA_ASSOCIATION association);
+  ///\brief Simulation year from a voxel space dataset name
+  ///\param dataset_name VoxelSpace dataset name, e.g. */VoxelSpaceData60*
+  ///\return The trailing number of the dataset name, -1 if there is none
+  int VoxelSpaceDataSetYear(const std::string& dataset_name);
+  ///\brief VTK file name for one dataset in a PVD collection
+  ///\param pvd_file PVD file
+  ///\param dataset_name VoxelSpace dataset name
+  ///\param extension VTK file extension
+  ///\return The PVD file name with the dataset name appended and \p extension
+  std::string VoxelSpaceDataSetFileName(const std::string& pvd_file,const std::string& dataset_name,
+					const std::string& extension);
+  ///\brief Write VTK/VTM file referring to data set files 
+  ///\param file_name VTK/VTM file
+  ///\param block_names Block names
+  ///\param block_files Data set files relative to \p file_name
+  ///\return true if the file is written, false otherwise
+  bool WriteMultiBlockFile(const std::string& file_name,const std::vector<std::string>& block_names,
+			   const std::vector<std::string>& block_files);
+  ///\brief Write parallel VTK file referring to the pieces
+  ///\param file_name VTK/PVTS or VTK/PVTI file
+  ///\param grid_type Structured grid or image data
+  ///\param whole_extent Point extent of the whole voxel space
+  ///\param origin Coordinates of the first point
+  ///\param spacing Distance between points in x,y,z
+  ///\param attr_names Attribute names of the point and cell data arrays
+  ///\param association Point data arrays, cell data arrays or both
+  ///\param extents Point extents of the pieces
+  ///\param piece_files Piece files relative to \p file_name
+  ///\return true if the file is written, false otherwise
+  bool WriteParallelVoxelSpaceFile(const std::string& file_name,VOXEL_GRID_TYPE grid_type,const GridExtent& whole_extent,
+				   const double origin[3],const double spacing[3],const std::vector<std::string>& attr_names,
+				   VOXEL_DATA_ASSOCIATION association,
+				   const std::vector<GridExtent>& extents,const std::vector<std::string>& piece_files);
+  ///\brief Piece file name relative to the parallel VTK file
+  ///\param output_file VTK/PVTS or VTK/PVTI file
+  ///\param piece Piece number
+  ///\return *stem/stem_piece.vts* or *stem/stem_piece.vti*
+  std::string VoxelSpacePieceFileName(const std::string& output_file,int piece);
+}
+#endif
@@ -1,8 +1,11 @@
 #ifndef HDF5_TO_LIGNUM_H
 #define HDF5_TO_LIGNUM_H
+#include <memory>
+#include <mutex>
 #include <tuple>
 #include <LGMHDF5File.h>
 #include <Lignum.h>
+#include <HDF5TreeIndex.h>
 ///\file HDF5ToLignum.h
 /// \brief LIGNUM HDF5 file operations.
 ///
@@ -10,6 +13,7 @@
 
 ///\brief LIGNUM model representations in VTK 
 namespace lignumvtk{
+  class CollectedTree;
   ///\brief VoxelSpace data for VTK vtkStructuredGrid
   ///
   ///To visualize VoxelSpace necessary data is in std::pair.
@@ -23,6 +27,9 @@ namespace lignumvtk{
   ///\brief Trees are stored in HDF5 under "/TreeXML/" main group
   ///\sa LignumForest::TXMLGROUP
   const string TXMLGROUP= "/TreeXML/";
+  ///\brief Trees in the columnar layout are stored under "/TreeColumns/" main group
+  ///\sa HDF5TreeColumns.h
+  const string TREE_COLUMNS_GROUP="/TreeColumns/";
   ///\brief VoxelSpace main group
   ///\sa LignumForest::VOXELSPACEMAINGROUP
   const string VOXELSPACEMAINGROUP("/");
@@ -48,6 +55,54 @@ namespace lignumvtk{
   ///\pre At least one dataset must be available
   void AttributeNameCollector(H5::H5Object& loc, const std::string attr_name, void* user_data);
   
+  ///\brief Hyperslab selection of a VoxelSpace dataset
+  ///
+  ///Start, count and stride of voxels in x,y,z dimensions and the data columns. 
+  ///\sa HDF5ToVoxelSpace::getVoxelSpace(const string&,const VoxelSelection&,vector<double>&)
+  class VoxelSelection{
+  public:
+    VoxelSelection():start{0,0,0},count{0,0,0},stride(1){}
+    hsize_t start[3];///< First voxel in x,y,z
+    hsize_t count[3];///< Number of selected voxels in x,y,z
+    hsize_t stride;///< Select every stride'th voxel in x,y,z
+    vector<hsize_t> columns;///< Data columns in ascending order, empty vector for all columns
+  };
+
+  ///\brief Dataset shape and storage size without the data
+  ///\sa HDF5Base::getDataSetInfo()
+  class DataSetInfo{
+  public:
+    DataSetInfo():storage_size(0){}
+    vector<hsize_t> dims;///< Dataset dimensions, empty vector if reading error
+    hsize_t storage_size;///< Bytes allocated in the file, compressed size for compressed datasets
+  };
+
+  ///\brief Byte count as a human readable string, e.g. 12.3 MB
+  ///\param bytes Number of bytes
+  ///\return Size with a binary prefix unit
+  string ByteSizeString(double bytes);
+
+  ///\brief HDF5 file access settings for HDF5Base::openFile()
+  ///
+  ///Zero cache sizes keep the HDF5 library defaults.
+  class HDF5AccessOptions{
+  public:
+    HDF5AccessOptions():chunk_cache_bytes(0),meta_cache_bytes(0),core(false),swmr(false){}
+    size_t chunk_cache_bytes;///< Raw data chunk cache for each dataset in bytes
+    size_t meta_cache_bytes;///< Initial and minimum maximum size of the metadata cache in bytes
+    bool core;///< Read the whole file into memory (core driver) if it fits in the available memory
+    bool swmr;///< Open as single writer multiple readers (SWMR) reader, the file can be written at the same time
+  };
+  ///\brief File access settings used when HDF5 files are opened
+  ///\remark `inline` so that all translation units share the value set from command line.
+  inline HDF5AccessOptions HDF5_ACCESS_OPTIONS;
+
+  ///\brief File access property list for \p options
+  ///\param file_name HDF5 file, the file size is compared to the available memory for the core driver
+  ///\param options Cache sizes and file driver
+  ///\return File access property list, the core driver is set only if the file fits in memory
+  H5::FileAccPropList CreateFileAccess(const string& file_name,const HDF5AccessOptions& options);
+
   ///\brief Dataset names collection
   ///
   ///Helper class for InsertDataSet.
@@ -61,9 +116,13 @@ namespace lignumvtk{
   ///\brief Query datasets in HDF5 file.
   ///
   ///Query dataset paths, datasets and dataset attributes.
+  ///The HDF5 library is not thread safe by default. The read methods are serialised
+  ///with a mutex so that one object can be shared by threads converting datasets.
   class HDF5Base{
   public:
     ///\brief Open HDF5 file
+    ///
+    ///The file access properties are from HDF5_ACCESS_OPTIONS.
     ///\param file_name HDF5 file
     HDF5Base& openFile(const string& file_name);
     ///\brief Destructor
@@ -83,6 +142,16 @@ namespace lignumvtk{
     ///\param name HDF5 path
     ///\return Vector of HDF5 paths
     vector<std::string>& getDataSetNames(const string& name);
+    ///\brief Names of the direct members of a group
+    ///
+    ///Only the links in the group are iterated, the member objects are not opened.
+    ///\param group_name HDF5 group path
+    ///\return Member names without the group path, empty vector if \p group_name is not a group
+    vector<string> getGroupMembers(const string& group_name);
+    ///\brief Read dataset dimensions and storage size without the data
+    ///\param dataset_name HDF5 dataset path
+    ///\return Dataset dimensions and storage size
+    DataSetInfo getDataSetInfo(const string& dataset_name);
     vector<string> readAttributeNames(); 
     ///\brief Read dataset scalar attribute
     ///\param[in] dset_name Dataset name
@@ -118,18 +187,60 @@ namespace lignumvtk{
   protected:
     DataSetNames dataset_names;///< Collection of HDF5 path names
     H5::H5File hdf5_file;///< HDF5 file
+    ///\brief Serialise HDF5 calls, recursive because read methods call each other
+    ///
+    ///`mutable` to serialise the const read methods too.
+    mutable std::recursive_mutex hdf5_mutex;
   };
 
   ///\brief Read Lignum trees from HDF5 file
+  ///
+  ///The trees are either XML strings under TXMLGROUP or in the columnar layout
+  ///under TREE_COLUMNS_GROUP. The layout is checked when the file is opened.
   class HDF5ToLignum: public HDF5Base{
   public:
+    HDF5ToLignum():tree_columns(false),tree_columns_supported(false){}
+    ///\brief Open HDF5 file and check for the columnar layout
+    ///
+    ///The columnar layout is read only if its format version is not newer than TREE_COLUMNS_VERSION.
+    ///\param file_name HDF5 file
+    HDF5ToLignum& openFile(const string& file_name);
+    ///\brief The trees are in the columnar layout
+    ///\retval true Trees under TREE_COLUMNS_GROUP, read with getCollectedTree()
+    ///\retval false Trees are XML strings under TXMLGROUP, read with getLignumTreeString()
+    bool hasTreeColumns()const{return tree_columns;}
+    ///\brief Read tree in the columnar layout
+    ///\param tree_path HDF5 tree group path
+    ///\param[out] ct Collected tree data
+    ///\return true if the tree is read, false otherwise or if the format version is not supported
+    ///\sa ReadTreeColumns, CheckTreeColumnsVersion
+    bool getCollectedTree(const string& tree_path,CollectedTree& ct);
+    ///\brief Storage size of one tree
+    ///\param tree_path HDF5 tree dataset or tree group path
+    ///\return Bytes allocated in the file for the XML dataset or for the column datasets
+    hsize_t getTreeStorageSize(const string& tree_path);
     ///\brief Query Lignum XML string
     ///\param dataset_name HDF5 dataset path for the XML sring
     ///\return Lignum xml as std:;string
     const string getLignumTreeString(const string& dataset_name)const;
-    ///\brief Root group name for Lignum XML trees
-    ///\retval TXMLGROUP The main tree group name
-    const string getMainGroupName()const override{return TXMLGROUP;}
+    ///\brief Root group name for Lignum trees
+    ///\retval TXMLGROUP The main tree group name for XML trees
+    ///\retval TREE_COLUMNS_GROUP The main tree group name for the columnar layout
+    const string getMainGroupName()const override{return tree_columns ? TREE_COLUMNS_GROUP : TXMLGROUP;}
+    ///\brief Index of tree datasets by year and tree
+    ///
+    ///The index is built on the first call from the year groups or loaded from a valid sidecar index file.
+    ///\return The tree index
+    ///\sa HDF5TreeIndex
+    const HDF5TreeIndex& getTreeIndex();
+    ///\brief Save the tree index to the sidecar index file next to the HDF5 file
+    ///\retval true Index saved
+    ///\retval false Write error
+    bool saveTreeIndex();
+  private:
+    std::unique_ptr<HDF5TreeIndex> tree_index;///< Tree index, built when first needed
+    bool tree_columns;///< Trees are in the columnar layout
+    bool tree_columns_supported;///< The columnar layout version is supported
   };
 
   ///\brief Read VoxelSpace from HDF5 file
@@ -155,6 +266,26 @@ namespace lignumvtk{
     ///\sa LignumForest::VB_EDGE_SIZE_NAME 
     ///\sa GridData
     const GridData getVoxelSpace(const string& dataset_name,vector<double>& v);
+    ///\brief Check that the dataset is a VoxelSpace
+    ///\param dataset_name HDF5 dataset path
+    ///\return true if the dataset has rank 4 and at least three voxel edge sizes in VB_EDGE_SIZE_NAME, false otherwise
+    bool isVoxelSpace(const string& dataset_name);
+    ///\brief Read VoxelSpace dimensions and voxel edge lengths without data.
+    ///\param[in] dataset_name VoxelSpace dataset name
+    ///\return GridData Pair for 4-tuple of number of voxels and voxel data and 3-tuple of voxel edge lengths
+    ///\return GridData with EXIT_FAILURE entries if dataset reading error
+    const GridData getVoxelSpaceGrid(const string& dataset_name);
+    ///\brief Read hyperslab of one VoxelSpace.
+    ///
+    ///Only the selected voxels and data columns are read from the HDF5 file. The data in \p v is in the
+    ///same row-first order as the dataset with the dimensions of the selection. The data columns
+    ///are in the order of VoxelSelection::columns.
+    ///\param[in] dataset_name VoxelSpace dataset name
+    ///\param[in] selection Selected voxels
+    ///\param[in,out] v The vector to contain the selected VoxelSpace data
+    ///\return GridData Pair for 4-tuple of number of selected voxels and voxel data and 3-tuple of voxel edge lengths
+    ///\return GridData with EXIT_FAILURE entries if dataset reading error
+    const GridData getVoxelSpace(const string& dataset_name,const VoxelSelection& selection,vector<double>& v);
   };
 }
 #endif
@@ -0,0 +1,122 @@
+#ifndef HDF5TREECOLUMNS_H
+#define HDF5TREECOLUMNS_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <HDF5ToLignum.h>
+#include <LignumVTKTree.h>
+///\file HDF5TreeColumns.h
+/// \brief Columnar binary layout for trees in HDF5 files.
+///
+/// The data collected from a tree (CollectedTree) is stored in compound datasets with one
+/// named member (column) for each value so that VTK geometry can be created without
+/// parsing XML. Each tree is a group */TreeColumns/<year>/<tree>* with
+/// the *SegmentType* attribute ("Cf" or "Hw") and three datasets:
+/// -# *Segments*: one row (SegmentRow) for each spline point, i.e. the segment base points
+///    and the axis tip (bud) point, axis by axis in the order of CollectTSData.
+/// -# *Axes*: one row (AxisRow) for each axis with its first row in *Segments*.
+/// -# *Leaves*: one row (LeafRow) for each broadleaf with petiole and kite corners, empty for conifers.
+///
+/// The datasets are chunked and compressed with shuffle and deflate. The year and tree
+/// groups are the same as in */TreeXML/* and the trees are found with HDF5TreeIndex.
+/// The format version is the *TreeColumnsVersion* attribute of the main group.
+namespace lignumvtk{
+
+  ///\brief Tree segment dataset in a tree group
+  const std::string TREE_COLUMNS_SEGMENTS="Segments";
+  ///\brief Axis dataset in a tree group
+  const std::string TREE_COLUMNS_AXES="Axes";
+  ///\brief Leaf dataset in a tree group
+  const std::string TREE_COLUMNS_LEAVES="Leaves";
+  ///\brief Tree type attribute of a tree group, "Cf" or "Hw" as in Lignum XML
+  const std::string TREE_COLUMNS_SEGMENT_TYPE="SegmentType";
+  ///\brief Format version attribute of the main group
+  const std::string TREE_COLUMNS_VERSION_ATTRIBUTE="TreeColumnsVersion";
+  ///\brief Format version
+  const int TREE_COLUMNS_VERSION=1;
+  ///\brief Rows in one HDF5 chunk
+  const hsize_t TREE_COLUMNS_CHUNK_ROWS=4096;
+  ///\brief Deflate (gzip) compression level 1-9
+  const int TREE_COLUMNS_DEFLATE_LEVEL=4;
+  ///\brief Number of corner points of a kite leaf
+  const int TREE_COLUMNS_LEAF_VERTICES=4;
+
+  ///\brief One spline point of an axis
+  ///
+  ///The values of the tip point are those of the segment below as in CollectTSData.
+  class SegmentRow{
+  public:
+    std::int32_t axis;///< Axis index, row in *Axes*
+    ///\brief Parent row: the previous point in the axis, for the first point of a branch the point
+    ///of the mother axis at the branching point, -1 for the base of the tree
+    std::int32_t parent;
+    double x,y,z;///< Point
+    double dx,dy,dz;///< Direction to the next point in the axis
+    double L;///< Segment length
+    double R;///< Segment radius
+    double Rh;///< Heartwood radius
+    double Rf;///< Radius to foliage limit
+    double Wf;///< Foliage mass
+    double Qin;///< Incoming radiation
+    double Qabs;///< Absorbed radiation
+    double P;///< Photosynthesis
+  };
+
+  ///\brief One axis
+  class AxisRow{
+  public:
+    std::int32_t first;///< First row in *Segments*
+    std::int32_t count;///< Number of rows in *Segments*
+    std::int32_t from_bud;///< TreeSegmentDataCollection::from_bud
+    double total_length;///< Sum of segment lengths in the axis
+  };
+
+  ///\brief One broadleaf with its petiole
+  class LeafRow{
+  public:
+    double petiole_start[3];///< Petiole start point
+    double petiole_end[3];///< Petiole end point
+    double vertices[TREE_COLUMNS_LEAF_VERTICES][3];///< Leaf corner points as in Kite::getVertexVector
+    double A;///< Leaf area
+    double Qin;///< Incoming radiation
+    double Qabs;///< Absorbed radiation
+    double P;///< Photosynthesis
+  };
+
+  ///\brief Write collected trees to HDF5 file in the columnar layout.
+  ///
+  ///The file is created or truncated. Trees are written one at a time.
+  class TreeColumnsWriter{
+  public:
+    ///\brief Create the HDF5 file and the main group
+    ///\param file_name HDF5 file
+    ///\retval true File created
+    ///\retval false File cannot be created
+    bool open(const std::string& file_name);
+    ///\brief Write one tree
+    ///\param year Simulation year group
+    ///\param tree_id Tree group name in the year group, e.g. *Tree_8*
+    ///\param ct Data collected from the tree
+    ///\retval true Tree written
+    ///\retval false Write error or leaves that are not kites
+    bool addTree(int year,const std::string& tree_id,const CollectedTree& ct);
+    ///\brief Close the file
+    void close();
+  private:
+    H5::H5File file;///< HDF5 output file
+  };
+
+  ///\brief Check the format version of the columnar layout
+  ///\param file Open HDF5 file with TREE_COLUMNS_GROUP
+  ///\retval true TREE_COLUMNS_VERSION_ATTRIBUTE is at most TREE_COLUMNS_VERSION
+  ///\retval false No version attribute or the version is newer than TREE_COLUMNS_VERSION
+  bool CheckTreeColumnsVersion(const H5::H5File& file);
+  ///\brief Read one tree in the columnar layout
+  ///\param file Open HDF5 file
+  ///\param tree_path Tree group path, e.g. */TreeColumns/20/Tree_8*
+  ///\param[out] ct Collected tree data, CollectedTree::tree_id is \p tree_path
+  ///\retval true Tree read
+  ///\retval false No tree group or the datasets cannot be read
+  bool ReadTreeColumns(const H5::H5File& file,const std::string& tree_path,CollectedTree& ct);
+}
+#endif
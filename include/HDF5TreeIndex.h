@@ -0,0 +1,100 @@
+#ifndef HDF5TREEINDEX_H
+#define HDF5TREEINDEX_H
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+///\file HDF5TreeIndex.h
+/// \brief Index of tree datasets in Lignum HDF5 files.
+///
+/// Trees are stored in HDF5 as */TreeXML/<year>/<tree>*. The index is built once per file
+/// from the links of the year groups and answers the queries by year, by tree across years
+/// and by (year,tree) without walking the HDF5 file again. The index can be saved
+/// to a sidecar file next to the HDF5 file. The sidecar is valid as long as the size and
+/// the modification time of the HDF5 file are unchanged.
+namespace lignumvtk{
+
+  class HDF5Base;
+
+  ///\brief Sidecar index file extension appended to the HDF5 file name
+  const std::string TREE_INDEX_EXTENSION=".idx";
+  ///\brief Sidecar index file header
+  const std::string TREE_INDEX_HEADER="LignumVTKTreeIndex 1";
+
+  ///\brief One tree dataset in the index
+  class TreeDataSet{
+  public:
+    int year;///< Simulation year
+    std::string tree_id;///< Tree dataset name in the year group
+    std::string path;///< HDF5 dataset path
+  };
+
+  ///\brief Index of tree datasets by year and tree
+  class HDF5TreeIndex{
+  public:
+    ///\brief Build the index from the year groups in HDF5 file
+    ///\param hdf5 HDF5 file reader
+    ///\param main_group Main group for trees, e.g. */TreeXML/*
+    ///\return Number of tree datasets
+    std::size_t build(HDF5Base& hdf5,const std::string& main_group);
+    ///\brief Load the index from a sidecar file
+    ///\param index_file Sidecar index file
+    ///\param hdf5_file HDF5 file the index is for
+    ///\param main_group Main group for trees, e.g. */TreeXML/*
+    ///\retval true Index loaded
+    ///\retval false No sidecar file or the HDF5 file has changed since the index was saved
+    bool load(const std::string& index_file,const std::string& hdf5_file,const std::string& main_group);
+    ///\brief Save the index to a sidecar file
+    ///\param index_file Sidecar index file
+    ///\param hdf5_file HDF5 file the index is for
+    ///\retval true Index saved
+    ///\retval false Write error
+    bool save(const std::string& index_file,const std::string& hdf5_file)const;
+    ///\brief Number of tree datasets
+    std::size_t size()const{return datasets.size();}
+    ///\brief Tree dataset for year and tree
+    ///\param year Simulation year
+    ///\param tree_id Tree dataset name
+    ///\return The tree dataset, nullptr if not found
+    const TreeDataSet* find(int year,const std::string& tree_id)const;
+    ///\brief Simulation years in ascending order
+    std::vector<int> getYears()const;
+    ///\brief Dataset paths for one year
+    ///\param year Simulation year
+    std::vector<std::string> getYear(int year)const;
+    ///\brief Dataset paths for one tree in all years in ascending year order
+    ///\param tree_id Tree dataset name
+    std::vector<std::string> getTree(const std::string& tree_id)const;
+    ///\brief All dataset paths by year
+    std::vector<std::string> getAll()const;
+    ///\brief Select tree datasets
+    ///
+    ///The selection is by \p year, by \p dataset with exact match or by \p substring in this order.
+    ///A \p dataset without a group is a tree in all years. All tree datasets are selected if none is given.
+    ///\param year Simulation year, -1 if not used
+    ///\param dataset HDF5 dataset name or path, empty string if not used
+    ///\param substring HDF5 dataset path substring, empty string if not used
+    ///\return HDF5 dataset paths
+    std::vector<std::string> select(int year,const std::string& dataset,const std::string& substring)const;
+    ///\brief Sidecar index file name for HDF5 file
+    static std::string indexFileName(const std::string& hdf5_file){return hdf5_file+TREE_INDEX_EXTENSION;}
+  private:
+    ///\brief Add dataset to the lookup tables
+    void insert(int year,const std::string& tree_id,const std::string& main_group);
+    ///\brief Key for (year,tree) lookup
+    static std::string key(int year,const std::string& tree_id){return std::to_string(year)+"/"+tree_id;}
+    std::vector<TreeDataSet> datasets;///< Tree datasets by year
+    std::unordered_map<std::string,std::size_t> by_year_tree;///< Index of (year,tree) in \p datasets
+    std::unordered_map<std::string,std::vector<std::size_t>> by_tree;///< Indices of a tree in \p datasets
+    std::map<int,std::vector<std::size_t>> by_year;///< Indices of the trees of a year in \p datasets
+  };
+
+  ///\brief Size and modification time of a file to validate the sidecar index file
+  ///\param file_name File name
+  ///\param[out] size File size
+  ///\param[out] mtime Modification time in file clock ticks
+  ///\return true if the file exists, false otherwise
+  bool FileStamp(const std::string& file_name,std::uintmax_t& size,std::int64_t& mtime);
+}
+#endif
@@ -0,0 +1,73 @@
+#ifndef HDF5TREEPREFETCH_H
+#define HDF5TREEPREFETCH_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <HDF5ToLignum.h>
+#include <LignumVTKTree.h>
+///\file HDF5TreePrefetch.h
+/// \brief Read trees from HDF5 file ahead of consumption.
+///
+/// Reading a tree dataset and parsing or creating the VTK datasets of the previous tree
+/// are overlapped. A reader thread reads the next trees into a bounded queue while
+/// the trees already read are consumed. The HDF5 calls are still serialised by HDF5Base.
+namespace lignumvtk{
+
+  ///\brief Number of trees read ahead, 0 reads each tree when it is needed
+  ///\remark `inline` so that all translation units share the value set from command line.
+  inline unsigned int HDF5_PREFETCH_TREES = 0;
+
+  ///\brief One tree read from HDF5 file
+  class PrefetchedTree{
+  public:
+    PrefetchedTree():ok(false){}
+    std::string path;///< HDF5 tree dataset or tree group path
+    std::string lignum_string;///< Lignum XML for trees under TXMLGROUP
+    CollectedTree ct;///< Tree data for trees in the columnar layout
+    bool ok;///< The tree was read
+  };
+
+  ///\brief Read trees in the order of the dataset paths, \p depth trees ahead.
+  ///
+  ///With zero \p depth there is no reader thread and next() reads the tree itself.
+  ///XML trees are read as strings, trees in the columnar layout are read to CollectedTree.
+  class HDF5TreePrefetcher{
+  public:
+    ///\brief Start reading trees
+    ///\param hdf5lignum Open HDF5 file
+    ///\param paths Tree dataset paths
+    ///\param depth Maximum number of trees read but not yet consumed
+    HDF5TreePrefetcher(HDF5ToLignum& hdf5lignum,const std::vector<std::string>& paths,unsigned int depth);
+    ///\brief Stop reading and wait for the reader thread
+    ~HDF5TreePrefetcher();
+    HDF5TreePrefetcher(const HDF5TreePrefetcher&)=delete;
+    HDF5TreePrefetcher& operator=(const HDF5TreePrefetcher&)=delete;
+    ///\brief Take the next tree
+    ///\param[out] tree Next tree, PrefetchedTree::ok is false if the tree cannot be read
+    ///\retval true Tree taken
+    ///\retval false All trees consumed
+    bool next(PrefetchedTree& tree);
+  private:
+    ///\brief Read one tree
+    ///\param path Tree dataset path
+    ///\param[out] tree The tree read
+    void read(const std::string& path,PrefetchedTree& tree);
+    ///\brief Reader thread, read trees until all are read or stopped
+    void run();
+    HDF5ToLignum& hdf5lignum;///< HDF5 file
+    const std::vector<std::string> paths;///< Tree dataset paths
+    const std::size_t depth;///< Queue size limit
+    std::size_t consumed;///< Number of trees taken with next()
+    std::deque<PrefetchedTree> queue;///< Trees read but not consumed
+    bool stop;///< Stop the reader thread
+    std::mutex queue_mutex;///< Guards queue and stop
+    std::condition_variable not_full;///< Signalled when a tree is taken
+    std::condition_variable not_empty;///< Signalled when a tree is read
+    std::thread reader;///< Reader thread, not started if \p depth is 0
+  };
+}
+#endif
@@ -3,6 +3,7 @@
 #ifndef LIGNUMVTK_H
 #define LIGNUMVTK_H
 #include <vtkNew.h>
+#include <vtkSmartPointer.h>
 #include <vtkMath.h>
 #include <vtkProperty.h>
 #include <vtkInformation.h>
@@ -24,16 +25,23 @@
 #include <vtkParametricFunctionSource.h>
 #include <vtkSphereSource.h>
 #include <vtkTubeFilter.h>
+#include <vtkFlyingEdges3D.h>
 #include <vtkActor.h>
 #include <vtkDataAssembly.h>
 #include <vtkStructuredGrid.h>
+#include <vtkImageData.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkHexahedron.h>
 #include <vtkPartitionedDataSet.h>
 #include <vtkPartitionedDataSetCollection.h>
 #include <vtkXMLPartitionedDataSetCollectionWriter.h>
 #include <vtkMultiBlockDataSet.h>
 #include <vtkXMLMultiBlockDataWriter.h>
 #include <vtkXMLStructuredGridWriter.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkXMLUnstructuredGridWriter.h>
 #include <vtkXMLPolyDataWriter.h>
+#include <vtkXMLPolyDataReader.h>
 #include <vtkGlyph3DMapper.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -0,0 +1,103 @@
+#ifndef LIGNUMVTKEXPORTER_H
+#define LIGNUMVTKEXPORTER_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <LignumVTK.h>
+#include <LignumVTKTree.h>
+#include <PVDFile.h>
+///\file LignumVTKExporter.h
+/// \brief Create VTK/VTPC files from the trees of a running simulation.
+///
+/// A simulation linked with the LignumVTK::LignumVTK library adds its trees
+/// at the end of each simulation year. The tree data is collected directly
+/// from the Lignum trees, there is no XML or HDF5 round trip. The VTK datasets
+/// are created and written in a background thread while the simulation continues:
+///
+///     lignumvtk::LignumVTKExporter exporter("Stand.pvd");
+///     for (int year = 0; year < years; year++){
+///       //Simulate one year
+///       for (unsigned int i = 0; i < pine_trees.size(); i++){
+///         exporter.addConiferTree(*pine_trees[i],"Tree_"+std::to_string(i));
+///       }
+///       exporter.writeYear(year);
+///     }
+///     exporter.finish();
+namespace lignumvtk{
+
+  ///\brief Export the trees of a simulation as a VTK/VTPC time series.
+  ///
+  ///Each year is written to its own VTK/VTPC file named after the PVD file and the year
+  ///as in CreatePVDFileFromHDF5, and appended to the PVD collection file. Trees are collected
+  ///in the calling thread, the VTK datasets are created and written in the writer thread.
+  class LignumVTKExporter{
+  public:
+    ///\brief Start the writer thread
+    ///\param pvd_file ParaView PVD collection file
+    ///\param spline_resolution Number of spline points for tubes
+    ///\param view Dataset view: tree view = 0, component view = 1
+    ///\param max_pending Maximum number of years waiting to be written, writeYear() waits if there are more
+    ///\param nsides Number of tube sides, copied for the writer thread
+    LignumVTKExporter(const std::string& pvd_file,int spline_resolution=SPLINE_SEGMENT_RESOLUTION,int view=0,
+		      std::size_t max_pending=2,int nsides=TUBE_NUMBER_OF_SIDES);
+    ///\brief Write the remaining years and stop the writer thread
+    ~LignumVTKExporter();
+    LignumVTKExporter(const LignumVTKExporter&)=delete;
+    LignumVTKExporter& operator=(const LignumVTKExporter&)=delete;
+    ///\brief Add conifer tree to the current year
+    ///\param t Lignum conifer tree, not needed after the call
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\sa CollectConiferTree
+    template<class TS,class BUD>
+    LignumVTKExporter& addConiferTree(Tree<TS,BUD>& t,const std::string& tree_id);
+    ///\brief Add broadleaved tree with Kite leaves to the current year
+    ///\param t Lignum broadleaved tree, not needed after the call
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\sa CollectBroadLeafTree
+    template<class TS,class BUD>
+    LignumVTKExporter& addBroadLeafTree(Tree<TS,BUD>& t,const std::string& tree_id);
+    ///\brief Add data collected from a tree to the current year
+    ///\param ct Collected tree data, moved to the exporter
+    LignumVTKExporter& addTree(CollectedTree& ct);
+    ///\brief Hand the trees added since the previous call to the writer thread
+    ///\param year Simulation year, the PVD time value
+    ///\retval true The year is queued for writing
+    ///\retval false No trees added or the exporter is finished
+    bool writeYear(int year);
+    ///\brief Wait until all queued years are written and stop the writer thread
+    ///\retval true All years written
+    ///\retval false Some VTK/VTPC or PVD file could not be written
+    bool finish();
+    ///\brief Number of years written
+    std::size_t getNumberOfYears();
+  private:
+    ///\brief Writer thread, write years until finished
+    void run();
+    ///\brief Create VTK/VTPC file for one year and update the PVD file
+    ///\param year Simulation year
+    ///\param stand Trees of the year
+    ///\return true if the files are written, false otherwise
+    bool write(int year,CollectedStand& stand);
+    const std::string pvd_file;///< PVD collection file
+    const int spline_resolution;///< Number of spline points for tubes
+    const int view;///< Dataset view
+    const int nsides;///< Number of tube sides
+    const std::size_t max_pending;///< Queue size limit
+    CollectedStand stand;///< Trees of the current year, used by the calling thread only
+    std::deque<std::pair<int,CollectedStand>> queue;///< Years waiting to be written
+    PVDFile pvd;///< PVD collection, used by the writer thread only
+    std::size_t nyears;///< Years written
+    int failed;///< Years that could not be written
+    bool stop;///< No more years
+    std::mutex queue_mutex;///< Guards queue, nyears, failed and stop
+    std::condition_variable not_full;///< Signalled when a year is taken for writing
+    std::condition_variable not_empty;///< Signalled when a year is queued or at finish
+    std::thread writer;///< Writer thread
+  };
+}
+#endif
+#include <LignumVTKExporterI.h>
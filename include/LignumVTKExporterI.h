@@ -0,0 +1,24 @@
+#ifndef LIGNUMVTKEXPORTER_I_H
+#define LIGNUMVTKEXPORTER_I_H
+///\file LignumVTKExporterI.h
+/// \brief Implementation file
+
+namespace lignumvtk{
+
+  template<class TS,class BUD>
+  LignumVTKExporter& LignumVTKExporter::addConiferTree(Tree<TS,BUD>& t,const std::string& tree_id)
+  {
+    CollectedTree ct;
+    CollectConiferTree(t,tree_id,ct);
+    return addTree(ct);
+  }
+
+  template<class TS,class BUD>
+  LignumVTKExporter& LignumVTKExporter::addBroadLeafTree(Tree<TS,BUD>& t,const std::string& tree_id)
+  {
+    CollectedTree ct;
+    CollectBroadLeafTree<TS,BUD,cxxadt::Kite>(t,tree_id,ct);
+    return addTree(ct);
+  }
+}
+#endif
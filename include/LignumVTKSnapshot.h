@@ -0,0 +1,109 @@
+#ifndef LIGNUMVTK_SNAPSHOT_H
+#define LIGNUMVTK_SNAPSHOT_H
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <LignumVTKTree.h>
+#include <MappedFile.h>
+///\file LignumVTKSnapshot.h
+/// \brief Binary snapshot files for data collected from trees.
+///
+/// Creating VTK files requires XML parsing, Lignum tree construction and data
+/// collection with Lignum::AccumulateDown for each tree. The snapshot file stores
+/// the collected data (CollectedTree) so that VTK files with different spline and
+/// tube settings can be created directly from the snapshot.
+///
+/// \par File layout
+/// All items are 8 byte aligned in native byte order so that the file can be memory mapped:
+/// -# Header: magic string, byte order marker, version and number of trees
+/// -# For each tree: tree id, tree type and the segment, petiole and leaf TSDataVector
+/// -# For each TSData: bud marker, total length, points and the data vectors with
+///    their lengths, the scalar name and number of scalar names
+namespace lignumvtk{
+
+  ///\brief Snapshot file extension
+  const std::string SNAPSHOT_EXTENSION=".lvs";
+  ///\brief Snapshot file magic string, 8 bytes
+  const std::string SNAPSHOT_MAGIC="LGMVTKSN";
+  ///\brief Snapshot file format version
+  const std::uint64_t SNAPSHOT_VERSION=1;
+  ///\brief Byte order marker to detect snapshots from other platforms
+  const std::uint64_t SNAPSHOT_BYTE_ORDER=0x0102030405060708ULL;
+
+  ///\brief Write collected tree data to a snapshot file.
+  ///
+  ///Trees are written one at a time so that the whole stand need not be in memory.
+  ///The number of trees is updated in the header when the file is closed.
+  class TSDataSnapshotWriter{
+  public:
+    TSDataSnapshotWriter():ntrees(0){}
+    ///\brief Destructor, close the file if open
+    ~TSDataSnapshotWriter();
+    ///\brief Open snapshot file and write the header
+    ///\param file_name Snapshot file name
+    ///\retval true File opened
+    ///\retval false File cannot be opened
+    bool open(const std::string& file_name);
+    ///\brief Write data from one tree
+    ///\param ct Data collected from a tree
+    ///\retval *this The TSDataSnapshotWriter object
+    TSDataSnapshotWriter& addTree(const CollectedTree& ct);
+    ///\brief Update the number of trees in the header and close the file
+    ///\retval true File written
+    ///\retval false Write error
+    bool close();
+    ///\brief Number of trees written
+    std::uint64_t getNumberOfTrees()const{return ntrees;}
+  private:
+    void writeUInt(std::uint64_t i);
+    void writeDouble(double d);
+    void writeString(const std::string& s);
+    void writeDoubles(const std::vector<double>& v);
+    void writePoints(const std::vector<cxxadt::Point>& v);
+    void writeTSDataVector(const TSDataVector& v);
+    std::ofstream out;///< Snapshot file
+    std::uint64_t ntrees;///< Number of trees written
+  };
+
+  ///\brief Read collected tree data from a memory mapped snapshot file.
+  ///
+  ///Trees are read one at a time in the order they were written.
+  class TSDataSnapshotReader{
+  public:
+    TSDataSnapshotReader():offset(0),ntrees(0),nread(0){}
+    ///\brief Map the snapshot file and check the header
+    ///\param file_name Snapshot file name
+    ///\retval true Valid snapshot file
+    ///\retval false File cannot be mapped or it is not a snapshot file
+    bool open(const std::string& file_name);
+    ///\brief Number of trees in the snapshot
+    std::uint64_t getNumberOfTrees()const{return ntrees;}
+    ///\brief Read the next tree
+    ///\param[out] ct Data collected from a tree
+    ///\retval true Tree read
+    ///\retval false No more trees or the file is truncated
+    bool nextTree(CollectedTree& ct);
+  private:
+    ///\brief Number of bytes left after the read position
+    std::size_t remaining()const{return offset < file.size() ? file.size()-offset : 0;}
+    bool readUInt(std::uint64_t& i);
+    bool readDouble(double& d);
+    bool readString(std::string& s);
+    bool readDoubles(std::vector<double>& v);
+    bool readPoints(std::vector<cxxadt::Point>& v);
+    bool readTSDataVector(TSDataVector& v);
+    MappedFile file;///< Memory mapped snapshot file
+    std::size_t offset;///< Read position in the file
+    std::uint64_t ntrees;///< Number of trees in the file
+    std::uint64_t nread;///< Number of trees read
+  };
+
+  ///\brief Read all trees from a snapshot file
+  ///\param file_name Snapshot file name
+  ///\param[out] stand Trees in the snapshot
+  ///\retval true All trees read
+  ///\retval false Snapshot file cannot be read
+  bool ReadSnapshot(const std::string& file_name,CollectedStand& stand);
+}
+#endif
@@ -4,6 +4,7 @@
 #define LIGNUMVTK_TREE_H
 #include <cassert>
 #include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 #include <numeric>
@@ -142,6 +143,9 @@ namespace lignumvtk{
   ///\ingroup VTKTypes
   ///\brief Alias for actors generated for leaves
   typedef VTKActorVector LeafActorVector;
+  ///\ingroup VTKTypes
+  ///\brief Vector for polydata in one partitioned dataset
+  typedef std::vector<vtkSmartPointer<vtkPolyData>> PolyDataVector;
   
   ///\defgroup VTKconstants Constant definitions
   ///Constants used in LignumVTKTree
@@ -161,7 +165,8 @@ namespace lignumvtk{
   ///\note Tube number of sides can be set from command line.
   ///For a single tree and close views try value 30 but for a forest stand no more than 10.
   ///\attention Higher value allows better resolution but memory use can explode,
-  static int TUBE_NUMBER_OF_SIDES = 30;
+  ///\remark `inline` so that all translation units share the value set from command line.
+  inline int TUBE_NUMBER_OF_SIDES = 30;
   ///\ingroup VTKconstants
   ///\brief Technical minimum segment radius for visualization 
   ///\sa CollectTSData::operator()
@@ -224,6 +229,12 @@ namespace lignumvtk{
   ///\brief Root node name in LignumToVTK::dataset_assembly
   const std::string ROOT_TREE_NODE="Trees";
   ///\ingroup VTKconstants
+  ///\brief Node name for conifers in the data assemblies of a mixed stand
+  const std::string CONIFER_TREES_NODE="Conifers";
+  ///\ingroup VTKconstants
+  ///\brief Node name for broadleaved trees in the data assemblies of a mixed stand
+  const std::string BROADLEAF_TREES_NODE="BroadLeaves";
+  ///\ingroup VTKconstants
   ///\brief Default conifer tree id
   const std::string LIGNUM_CONIFER_ID="ConiferTree";
   ///\ingroup VTKconstants
@@ -257,6 +268,31 @@ namespace lignumvtk{
   };
  
   
+  ///\brief Data collected from one tree.
+  ///
+  ///Tree segment data for spline tubes and for broadleaved trees petiole and leaf data.
+  ///This is all that is needed to create the VTK datasets for a tree, i.e. the Lignum
+  ///tree itself is not needed after the data is collected.
+  ///\sa CollectConiferTree
+  ///\sa CollectBroadLeafTree
+  ///\sa TSDataSnapshotWriter
+  class CollectedTree{
+  public:
+    std::string tree_id;///< Tree id tag for vtkAssembly, e.g. HDF5 dataset path
+    std::string tree_type;///< Tree type, "Cf" for coniferous or "Hw" for broadleaved
+    TSDataVector segments;///< Tree segment data in axes
+    TSDataVector petioles;///< Petiole data, empty for conifers
+    TSDataVector leaves;///< Leaf data, empty for conifers
+  };
+  ///\ingroup VTKTypes
+  ///\brief Data collected from trees in a forest stand
+  typedef std::vector<CollectedTree> CollectedStand;
+  ///\ingroup VTKTypes
+  ///\brief Indices of the three partitioned datasets of one tree in LignumToVTK::dataset_collection
+  ///
+  ///Foliage, heartwood and segments for conifers, leaves, petioles and segments for broadleaved trees.
+  typedef std::array<int,3> TreeDataSetIndices;
+
   ///\brief Append two vectors
   ///\param v1 The first vector
   ///\param v2 The second vector
@@ -303,6 +339,9 @@ namespace lignumvtk{
   ///Use the functor with std::accumulate.
   class CreateVTKTubeFilter{
   public:
+    ///\brief Constructor
+    ///\param n Number of tube sides
+    CreateVTKTubeFilter(int n=TUBE_NUMBER_OF_SIDES):nsides(n){}
     ///Create and append one tube filter to the vector \p v
     ///
     ///Create a new  tube mapper and associate parametric function source \p fs with it
@@ -310,6 +349,8 @@ namespace lignumvtk{
     ///\param fs VTK parametric function source
     ///\return TubeFilterVector with new tube filter appended
     TubeFilterVector& operator()(TubeFilterVector& v,PFSptr fs)const;
+  private:
+    int nsides;///< Number of tube sides
   };
 
   ///\brief Create line actor vector for leaf petioles
@@ -407,6 +448,41 @@ namespace lignumvtk{
     TSDataVector& operator()(TSDataVector& v, TreeCompartment<TS,BUD>* tc)const;
   };
 
+  ///\brief Collect data from a conifer tree
+  ///\param t Lignum conifer tree
+  ///\param tree_id Tree id tag for vtkAssembly
+  ///\param[out] ct Collected tree data
+  ///\retval ct Tree segment data collected with CollectTSData
+  CollectedTree& CollectConiferTree(LignumVTKCfTree& t,const string& tree_id,CollectedTree& ct);
+  ///\brief Collect data from a broadleaved tree
+  ///\param t Lignum broadleaved tree
+  ///\param tree_id Tree id tag for vtkAssembly
+  ///\param[out] ct Collected tree data
+  ///\retval ct Tree segment, petiole and leaf data collected with CollectTSData,
+  ///CollectPetioleData and CollectLeafData respectively
+  CollectedTree& CollectBroadLeafTree(LignumVTKTree& t,const string& tree_id,CollectedTree& ct);
+  ///\brief Collect data from a conifer tree of any conifer segment type
+  ///
+  ///For trees of a running simulation, e.g. with LignumVTKExporter. No XML round trip is needed.
+  ///\tparam TS Conifer tree segment, derived from CfTreeSegment
+  ///\tparam BUD Bud
+  ///\param t Lignum conifer tree
+  ///\param tree_id Tree id tag for vtkAssembly
+  ///\param[out] ct Collected tree data
+  ///\retval ct Tree segment data collected with CollectTSData
+  template<class TS,class BUD>
+  CollectedTree& CollectConiferTree(Tree<TS,BUD>& t,const string& tree_id,CollectedTree& ct);
+  ///\brief Collect data from a broadleaved tree of any broadleaved segment type
+  ///\tparam TS Broadleaved tree segment, derived from HwTreeSegment
+  ///\tparam BUD Bud
+  ///\tparam S Leaf shape, Kite is supported
+  ///\param t Lignum broadleaved tree
+  ///\param tree_id Tree id tag for vtkAssembly
+  ///\param[out] ct Collected tree data
+  ///\retval ct Tree segment, petiole and leaf data
+  template<class TS,class BUD,class S=cxxadt::Kite>
+  CollectedTree& CollectBroadLeafTree(Tree<TS,BUD>& t,const string& tree_id,CollectedTree& ct);
+
   ///\brief Produce Lignum tree VTK/VTPC files for ParaView.
   ///
   ///Tree segments in Lignum::Axis will be represented as VTK tubes for sapwood
@@ -432,7 +508,9 @@ namespace lignumvtk{
     ///LignumToVTK::dataset_assembly, LignumToVTK::dataset_assembly_component_view
     ///and LignumVTK::dataset_collection initialized for use.
     ///\param resolution Spline segment lengthwise resolution
-    LignumToVTK(int resolution);
+    ///\param sides Number of tube sides, copied so that a writer thread does not read TUBE_NUMBER_OF_SIDES
+    LignumToVTK(int resolution,int sides=TUBE_NUMBER_OF_SIDES);
+    virtual ~LignumToVTK(){}
     ///\brief Write VTK partitioned data sets to a file
     ///
     ///Before writing data \p view selects data assembly to use. Default is tree view where datasets
@@ -467,6 +545,21 @@ namespace lignumvtk{
     ///\retval renderer The VTK renderer
     ///\deprecated No longer need to open VTK 
     vtkRenderer* getRenderer()const{return renderer;}
+    ///\brief Number of partitioned datasets in \p dataset_collection
+    int getNumberOfPartitionedDataSets()const{return dataset_collection->GetNumberOfPartitionedDataSets();}
+    ///\brief Block name of a partitioned dataset in \p dataset_collection
+    ///\param index Index of the partitioned dataset
+    ///\return Block name given in LignumToVTK::addPartitionedDataSet
+    const string getPartitionedDataSetName(int index)const;
+    ///\brief Polydata of a partitioned dataset in \p dataset_collection
+    ///\param index Index of the partitioned dataset
+    ///\param[out] v Vector for the polydata partitions
+    ///\retval v The polydata partitions of the dataset
+    PolyDataVector& getPartitionedDataSet(int index,PolyDataVector& v)const;
+    ///\brief Check the last writePartitionedDataSetCollection
+    ///\retval true The VTK/VTPC file was written
+    ///\retval false The writer failed or nothing is written yet
+    bool isWritten()const{return written;}
   protected:
     ///\brief Collect data from broadleaved tree segments.
     ///
@@ -583,12 +676,32 @@ namespace lignumvtk{
     ///\return Index number of the partitioned dataset in the \p dataset_collection  
     ///\sa LignumVTK::dataset_collection
     int addPartitionedDataSet(VTKActorVector& v, const string& block_name);
+    ///\brief Add vector \p v of polydata to \p dataset_collection as VTK partitioned data set block
+    ///\param v Vector of polydata, e.g. read from LignumVTK::TreeCache
+    ///\param block_name Name of the dataset block, visible in ParaView
+    ///\return Index number of the partitioned dataset in the \p dataset_collection  
+    int addPartitionedDataSet(PolyDataVector& v, const string& block_name);
     ///\brief Populate VTK multiblock data set with actors
     ///\param v Vector of actors
     ///\note The use of VTK MultiBlockDataSets is discouraged, use VTK ParitionedDataSets instead.
     ///\sa createBroadLeafTreeVTKDataSets
     ///\sa writePartitionedDataSetCollection
     LignumToVTK& addMultiBlockDataSet(VTKActorVector& v);
+    ///\brief Create conifer tree datasets for foliage, heartwood and segments from collected data
+    ///\param ct Data collected from a conifer tree
+    ///\param add_to_renderer Add vtkActors to VTK built-in renderer
+    ///\return Indices of the foliage, heartwood and segment datasets in \p dataset_collection
+    TreeDataSetIndices createConiferTreeDataSets(CollectedTree& ct,bool add_to_renderer);
+    ///\brief Create broadleaved tree datasets for leaves, petioles and segments from collected data
+    ///\param ct Data collected from a broadleaved tree
+    ///\param add_to_renderer Add vtkActors to VTK built-in renderer
+    ///\return Indices of the leaf, petiole and segment datasets in \p dataset_collection
+    TreeDataSetIndices createBroadLeafTreeDataSets(CollectedTree& ct,bool add_to_renderer);
+    ///\brief Update data assemblies before writing
+    ///
+    ///Called by writePartitionedDataSetCollection(). The default does nothing, the assemblies
+    ///are updated as the trees are added.
+    virtual void updateDataAssembly(){}
   protected:
     vtkNew<vtkPartitionedDataSetCollection> dataset_collection;///< Partitioned data set for VTK geometry models
     ///\brief Tree view hierarchy between items in \p dataset_collection
@@ -604,6 +717,8 @@ namespace lignumvtk{
     vtkNew<vtkRenderer> renderer;///< \deprecated VTK renderer for VTK render window for quick testing
     vtkNew<vtkXMLMultiBlockDataWriter> writer;///< File output for VTK MultiBlock data sets
     int resolution;///< Spline resolution, number of spline segments
+    int nsides;///< Number of tube sides
+    bool written;///< The last writePartitionedDataSetCollection succeeded
   };
 
   ///\brief Produce conifer Lignum tree VTK/VTPC files for ParaView.
@@ -630,6 +745,21 @@ namespace lignumvtk{
     ///\retval *this The LignumToVTK object
     template<typename TREE>
     CfLignumToVTK& createConiferTreeVTKDataSets(TREE& t,const string& tree_id,bool add_to_renderer=false);
+    ///\brief Create VTK geometric representation of a conifer tree from collected data.
+    ///
+    ///The Lignum tree is not needed, e.g. the data is read from a TSDataSnapshotReader.
+    ///\param ct Data collected from a conifer tree
+    ///\param add_to_renderer Add vtkActors to VTK built-in renderer
+    ///\retval *this The CfLignumToVTK object
+    ///\sa CollectConiferTree
+    CfLignumToVTK& createConiferTreeVTKDataSets(CollectedTree& ct,bool add_to_renderer=false);
+  protected:
+    ///\brief Update the data assembly views for one conifer tree
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\param foliage_dataset_index Index of the foliage dataset in \p dataset_collection
+    ///\param ts_rh_dataset_index Index of the heartwood dataset in \p dataset_collection
+    ///\param ts_r_dataset_index Index of the segment dataset in \p dataset_collection
+    void addConiferTreeAssembly(const string& tree_id,int foliage_dataset_index,int ts_rh_dataset_index,int ts_r_dataset_index);
   };
   ///\brief Produce broadleaf Lignum tree VTK/VTPC files for ParaView.
   ///\remark Creates also VTK actors and mappers.
@@ -658,6 +788,62 @@ namespace lignumvtk{
     ///if necessary.
     template <typename TREE>
     HwLignumToVTK& createBroadLeafTreeVTKDataSets(TREE& t, const string& tree_id, bool add_to_renderer=false);
+    ///\brief Create VTK geometric representation of a broadleaved tree from collected data.
+    ///
+    ///The Lignum tree is not needed, e.g. the data is read from a TSDataSnapshotReader.
+    ///\param ct Data collected from a broadleaved tree
+    ///\param add_to_renderer Add vtkActors to VTK built-in renderer
+    ///\retval *this The HwLignumToVTK object
+    ///\sa CollectBroadLeafTree
+    HwLignumToVTK& createBroadLeafTreeVTKDataSets(CollectedTree& ct,bool add_to_renderer=false);
+  protected:
+    ///\brief Update the data assembly views for one broadleaved tree
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\param indices Indices of the leaf, petiole and segment datasets in \p dataset_collection
+    void addBroadLeafTreeAssembly(const string& tree_id,const TreeDataSetIndices& indices);
+  };
+
+  ///\brief Produce VTK/VTPC files for a forest stand of conifers, broadleaved trees or both.
+  ///
+  ///Trees are added in any order and the tree type is given for each tree. The data assemblies
+  ///are made when the collection is written. For a stand of one tree type the assemblies are the same
+  ///as with CfLignumToVTK and HwLignumToVTK. For a mixed stand both views have the subtrees
+  ///CONIFER_TREES_NODE and BROADLEAF_TREES_NODE under ROOT_TREE_NODE: in the tree view the trees
+  ///are under their subtree, in the component view the three component nodes of the tree type are.
+  class StandLignumToVTK: public LignumToVTK{
+  public:
+    ///\brief Constructor
+    ///\param resolution Spline length resolution
+    ///\param sides Number of tube sides
+    StandLignumToVTK(double resolution,int sides=TUBE_NUMBER_OF_SIDES);
+    ///\brief Create VTK geometric representation of a tree from collected data
+    ///
+    ///CollectedTree::tree_type chooses conifer or broadleaved datasets.
+    ///\param ct Data collected from a tree
+    ///\param add_to_renderer Add vtkActors to VTK built-in renderer
+    ///\retval *this The StandLignumToVTK object
+    StandLignumToVTK& createTreeVTKDataSets(CollectedTree& ct,bool add_to_renderer=false);
+    ///\brief Add tree datasets created earlier
+    ///\param tree_type "Cf" or "Hw"
+    ///\param b0 Polydata for foliage (Cf) or leaves (Hw)
+    ///\param b1 Polydata for heartwood (Cf) or petioles (Hw)
+    ///\param b2 Polydata for segment spline tubes
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\retval *this The StandLignumToVTK object
+    ///\sa TreeCache
+    StandLignumToVTK& addTreeVTKDataSets(const string& tree_type,PolyDataVector& b0,PolyDataVector& b1,PolyDataVector& b2,
+					 const string& tree_id);
+  protected:
+    ///\brief Make both data assembly views for the trees added
+    void updateDataAssembly() override;
+    ///\brief Tree added to the stand
+    class StandTree{
+    public:
+      string tree_id;///< Tree id tag for vtkAssembly
+      string tree_type;///< "Cf" or "Hw"
+      TreeDataSetIndices indices;///< Dataset indices in \p dataset_collection
+    };
+    std::vector<StandTree> trees;///< Trees in the order added
   };
     
 }				
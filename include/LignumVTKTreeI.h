@@ -143,62 +143,33 @@ namespace lignumvtk{
     return v;
   }
 
+  template<class TS,class BUD>
+  CollectedTree& CollectConiferTree(Tree<TS,BUD>& t,const string& tree_id,CollectedTree& ct)
+  {
+    ct.tree_id = tree_id;
+    ct.tree_type = "Cf";
+    ct.segments = AccumulateDown(t,ct.segments,Append,CollectTSData<TS,BUD>());
+    return ct;
+  }
+
+  template<class TS,class BUD,class S>
+  CollectedTree& CollectBroadLeafTree(Tree<TS,BUD>& t,const string& tree_id,CollectedTree& ct)
+  {
+    ct.tree_id = tree_id;
+    ct.tree_type = "Hw";
+    ct.segments = AccumulateDown(t,ct.segments,Append,CollectTSData<TS,BUD>());
+    ct.petioles = AccumulateDown(t,ct.petioles,Append,CollectPetioleData<TS,BUD,S>());
+    ct.leaves = AccumulateDown(t,ct.leaves,Append,CollectLeafData<TS,BUD,S>());
+    return ct;
+  }
+
   template<typename TREE>
   HwLignumToVTK& HwLignumToVTK::createBroadLeafTreeVTKDataSets(TREE& t, const string& tree_id, bool add_to_renderer)
   {
     //Data collection from the tree
-    TSDataVector tsv;
-    tsv = treeToHwTSData(t,tsv);
-    TSDataVector pv;
-    pv = treeToPetioleData(t,pv);
-    TSDataVector lv;
-    lv = treeToKiteLeafData(t,lv);
-
-    //Create geometric obtects for tree segments
-    TubeMapperVector tmv;
-    tmv = createTubeMappers(tsv,tmv,TUBE_RADIUS_SCALAR);
-
-    //VTK actors for tree segments, leaves an petioles.
-    //Leaf and petiole actor construction creates also
-    //corresponding geometric objects
-    TubeActorVector tav;
-    tav = createTubeActors(tmv,tav);
-    LeafActorVector lav;
-    lav = createKiteLeafActors(lv,lav);
-    LineActorVector lineav;
-    lineav = createLineActors(pv,lineav);
-
-    //Add datasets to dataset collection
-    int foliage_dataset_index = addPartitionedDataSet(lav,TREE_SEGMENT_LEAF_BLOCK);
-    int petiole_dataset_index = addPartitionedDataSet(lineav,TREE_SEGMENT_PETIOLE_BLOCK);
-    int ts_r_dataset_index = addPartitionedDataSet(tav,TREE_SEGMENT_R_BLOCK);
-    //Update vtkDataAssembly views on the datasets for hierarchy information
-    //Create the tree hierarchy
-    const string valid_tree_id = dataset_assembly->MakeValidNodeName(tree_id.c_str());
-    //Create data assembly view where a tree is a collection of its segments and foliage 
-    //Zero (0) is the root of the tree and the tree becomes next node base on its id tag
-    int tree_node_id = dataset_assembly->AddNode(valid_tree_id.c_str(),0);
-    //Three nodes for foliage, segments and petioles of the tree
-    int foliage_node_id = dataset_assembly->AddNode(TREE_SEGMENT_LEAF_BLOCK.c_str(),tree_node_id);
-    int petiole_node_id = dataset_assembly->AddNode(TREE_SEGMENT_PETIOLE_BLOCK.c_str(),tree_node_id);
-    int ts_r_node_id = dataset_assembly->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),tree_node_id);
-    //Set data assembly node indices to point to foliage, segment and petiole dataset indices 
-    dataset_assembly->AddDataSetIndex(foliage_node_id,foliage_dataset_index);
-    dataset_assembly->AddDataSetIndex(petiole_node_id,petiole_dataset_index);
-    dataset_assembly->AddDataSetIndex(ts_r_node_id,ts_r_dataset_index);
-    ///Create three part view to foliage, segments and petiole
-    int fol_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_LEAF_BLOCK.c_str());
-    int petiole_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_PETIOLE_BLOCK.c_str());
-    int r_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_R_BLOCK.c_str());
-    dataset_assembly_component_view->AddDataSetIndex(fol_id,foliage_dataset_index);
-    dataset_assembly_component_view->AddDataSetIndex(petiole_id,petiole_dataset_index);
-    dataset_assembly_component_view->AddDataSetIndex(r_id,ts_r_dataset_index);
-    if (add_to_renderer == true){
-      addActorsToRenderer(tav);
-      addActorsToRenderer(lav);
-      addActorsToRenderer(lineav);
-    }
-    return *this;
+    CollectedTree ct;
+    ct = CollectBroadLeafTree(t,tree_id,ct);
+    return createBroadLeafTreeVTKDataSets(ct,add_to_renderer);
   }
 
   template<typename TREE>
@@ -230,52 +201,10 @@ namespace lignumvtk{
   template<typename TREE>
   CfLignumToVTK& CfLignumToVTK::createConiferTreeVTKDataSets(TREE& t,const string& tree_id, bool add_to_renderer)
   {
-    TSDataVector tsv;
-    tsv = treeToCfTSData(t,tsv);
-    TubeMapperVector tm_radius_v;
-    tm_radius_v = createTubeMappers(tsv,tm_radius_v,TUBE_RADIUS_SCALAR);
-    TubeMapperVector tm_radius_rh_v;
-    tm_radius_rh_v = createTubeMappers(tsv,tm_radius_rh_v,TUBE_HW_RADIUS_SCALAR);
-    TubeMapperVector tm_foliage_radius_v;
-    tm_foliage_radius_v = createTubeMappers(tsv,tm_foliage_radius_v,TUBE_FOLIAGE_RADIUS_SCALAR);
-    TubeActorVector ta_radius_v;
-    ta_radius_v= createTubeActors(tm_radius_v,ta_radius_v);
-    TubeActorVector ta_radius_rh_v;
-    ta_radius_rh_v = createTubeActors(tm_radius_rh_v,ta_radius_rh_v);
-    TubeActorVector ta_foliage_radius_v;
-    ta_foliage_radius_v = createTubeActors(tm_foliage_radius_v,ta_foliage_radius_v);
-
-    int foliage_dataset_index = addPartitionedDataSet(ta_foliage_radius_v,TREE_SEGMENT_FOLIAGE_BLOCK);
-    int ts_rh_dataset_index = addPartitionedDataSet(ta_radius_rh_v,TREE_SEGMENT_RH_BLOCK);
-    int ts_r_dataset_index = addPartitionedDataSet(ta_radius_v,TREE_SEGMENT_R_BLOCK);
-    //Update vtkDataAssembly view on the datasets for hierarchy information
-    //Create the tree hierarchy
-    const string valid_tree_id = dataset_assembly->MakeValidNodeName(tree_id.c_str());
-    //Create data assembly view where a tree is a collection of its segments and foliage 
-    //Zero (0) is the root of the tree and the tree becomes next node base on its id tag
-    int tree_node_id = dataset_assembly->AddNode(valid_tree_id.c_str(),0);
-    //Three nodes for foliage and segments of the tree
-    int foliage_node_id = dataset_assembly->AddNode(TREE_SEGMENT_FOLIAGE_BLOCK.c_str(),tree_node_id);
-    int ts_rh_node_id = dataset_assembly->AddNode(TREE_SEGMENT_RH_BLOCK.c_str(),tree_node_id);
-    int ts_r_node_id = dataset_assembly->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),tree_node_id);
-    //Set data assembly node indices to point to foliage and segment dataset indices 
-    dataset_assembly->AddDataSetIndex(foliage_node_id,foliage_dataset_index);
-    dataset_assembly->AddDataSetIndex(ts_rh_node_id,ts_rh_dataset_index);
-    dataset_assembly->AddDataSetIndex(ts_r_node_id,ts_r_dataset_index);
-    ///Three part view to foliage, segments and heartwood 
-    int fol_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_FOLIAGE_BLOCK.c_str());
-    int rh_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_RH_BLOCK.c_str());
-    int r_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_R_BLOCK.c_str());
-    dataset_assembly_component_view->AddDataSetIndex(fol_id,foliage_dataset_index);
-    dataset_assembly_component_view->AddDataSetIndex(rh_id,ts_rh_dataset_index);
-    dataset_assembly_component_view->AddDataSetIndex(r_id,ts_r_dataset_index);
-    //Deprecated
-    if (add_to_renderer == true){
-      addActorsToRenderer(ta_radius_v);
-      addActorsToRenderer(ta_radius_rh_v);
-      addActorsToRenderer(ta_foliage_radius_v);
-    }
-    return *this;
+    //Data collection from the tree
+    CollectedTree ct;
+    ct = CollectConiferTree(t,tree_id,ct);
+    return createConiferTreeVTKDataSets(ct,add_to_renderer);
   }
 }
 #endif
@@ -1,15 +1,18 @@
 #ifndef LIGNUMVTKXML_H
 #define LIGNUMVTKXML_H
+#include <cstddef>
 #include <string>
-#include <vtkNew.h>
-#include <vtkSmartPointer.h>
-#include <vtkXMLDataParser.h>
 ///\file LignumVTKXML.h
 /// \brief Query the tree classification in the LIGNUM xml file.
-
-typedef vtkSmartPointer<vtkXMLDataElement> vtkXMLElementPtr;
+///
+/// Only the beginning of the XML is scanned: the root element for the tree type
+/// and for broadleaved trees the first *BroadLeaf* element for the leaf shape.
+/// The rest of the file is not read. The tree itself is parsed once with the tree reader.
 
 namespace lignumvtk{
+  ///\brief Bytes read at a time from the XML file
+  const std::size_t LIGNUM_XML_CHUNK_SIZE=64*1024;
+
   ///\brief Check Lignum tree type
   ///
   ///Peek into Lignum XML and determine tree type,
@@ -17,21 +20,53 @@ namespace lignumvtk{
   ///determine leaf shape, ellipse, triangle or kite.
   class LignumVTKXML{
   public:
+    LignumVTKXML():state(SCAN_STATE::ROOT),bytes_read(0){}
     ///\brief Set file name for the XML \p parser
     ///\param file_name Lignum XML File name
     LignumVTKXML& setFileName(const std::string& file_name);
-    ///\brief Parse Lignum XML file
+    ///\brief Scan the beginning of the Lignum XML file
+    ///
+    ///The file is memory mapped and scanned in place until the tree type and the leaf type are known.
+    ///If the file cannot be mapped it is read in chunks of LIGNUM_XML_CHUNK_SIZE bytes.
     LignumVTKXML& parse();
+    ///\brief Scan the beginning of Lignum XML in memory
+    ///\param data Lignum XML
+    ///\param n Length of \p data
+    LignumVTKXML& parse(const char* data,std::size_t n);
+    ///\brief Scan the beginning of Lignum XML string, e.g. from HDF5 file
+    ///\param xml Lignum XML
+    LignumVTKXML& parse(const std::string& xml){return parse(xml.data(),xml.size());}
     ///\brief Query tree type
-    ///\return tree type, "Cf" for coniferous or "Hw" for broadleaved
-    const std::string treeType()const;
+    ///\return tree type, "Cf" for coniferous or "Hw" for broadleaved.
+    ///Empty string if the root element has no *SegmentType*.
+    const std::string treeType()const{return tree_type;}
     ///\brief Query leaf type
     ///\return "Ellipse", "Triangle" or "Kite" for broadleaved.
-    ///Empty string if applied to coniferous trees.
-    const std::string leafType()const;
+    ///Empty string if applied to coniferous trees or broadleaved trees without leaves.
+    const std::string leafType()const{return leaf_type;}
+    ///\brief Number of bytes of the XML file scanned in parse()
+    std::size_t bytesRead()const{return bytes_read;}
   private:
+    ///\brief Scanner state
+    enum class SCAN_STATE{ROOT,LEAF,DONE};
+    ///\brief Reset the scanner for new input
+    void reset();
+    ///\brief Scan XML
+    ///\param data XML input
+    ///\param n Length of \p data
+    ///\return Number of bytes of \p data consumed, the rest is needed again with the next input
+    std::size_t scan(const char* data,std::size_t n);
     std::string file_name;///< Lignum XML file name
-    vtkNew<vtkXMLDataParser> parser;///< XML file parser
+    SCAN_STATE state;///< Scanner state
+    std::string tree_type;///< *SegmentType* of the root element
+    std::string leaf_type;///< *Shape* of the first *BroadLeaf* element
+    std::size_t bytes_read;///< Bytes scanned from the XML file
   };
+
+  ///\brief Value of an attribute in XML start tag
+  ///\param tag Start tag from the element name up to but not including *>*
+  ///\param name Attribute name
+  ///\return Attribute value, empty string if not found
+  std::string XMLAttribute(const std::string& tag,const std::string& name);
 }
 #endif
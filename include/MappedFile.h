@@ -0,0 +1,45 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+///\file MappedFile.h
+/// \brief Read-only memory mapped files.
+///
+/// The file content is mapped to memory with POSIX `mmap` and the operating system
+/// reads pages on demand. Large input files are not copied to separate buffers.
+namespace lignumvtk{
+
+  ///\brief Read-only memory mapped file.
+  ///
+  ///The mapping is released in the destructor. The class is not copyable.
+  class MappedFile{
+  public:
+    MappedFile():mapped_data(nullptr),mapped_size(0){}
+    ///\brief Constructor, map the file
+    ///\param file_name File name
+    ///\sa open()
+    MappedFile(const std::string& file_name);
+    ///\brief Destructor, release the mapping
+    ~MappedFile();
+    MappedFile(const MappedFile&)=delete;
+    MappedFile& operator=(const MappedFile&)=delete;
+    ///\brief Map the file to memory
+    ///\param file_name File name
+    ///\param sequential Advise the kernel for sequential reading with read ahead
+    ///\retval true File is mapped
+    ///\retval false File could not be opened or mapped
+    bool open(const std::string& file_name,bool sequential=true);
+    ///\brief Release the mapping
+    void close();
+    ///\brief Query if the file is mapped
+    bool isOpen()const{return mapped_data != nullptr;}
+    ///\brief Mapped file content
+    const char* data()const{return mapped_data;}
+    ///\brief File size in bytes
+    std::size_t size()const{return mapped_size;}
+  private:
+    const char* mapped_data;///< Start of the mapped region
+    std::size_t mapped_size;///< Length of the mapped region
+  };
+}
+#endif
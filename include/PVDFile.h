@@ -0,0 +1,51 @@
+#ifndef PVDFILE_H
+#define PVDFILE_H
+#include <string>
+#include <vector>
+///\file PVDFile.h
+/// \brief ParaView data (PVD) collection files.
+///
+/// A PVD file is a small XML metadata file listing VTK data files with
+/// time step values. ParaView shows the datasets as a time series, for example
+/// forest stand growth with the simulation year as the time value.
+namespace lignumvtk{
+
+  ///\brief PVD file extension
+  const std::string PVD_EXTENSION=".pvd";
+
+  ///\brief One dataset entry in the PVD collection
+  class PVDDataSet{
+  public:
+    double time_step;///< Time value, e.g. simulation year
+    int part;///< Part number for datasets sharing the same time value
+    std::string name;///< Optional dataset name shown in ParaView
+    std::string file_name;///< VTK file relative to the PVD file location
+  };
+
+  ///\brief Create ParaView PVD collection files.
+  ///
+  ///Collect VTK data files with their time step values and write
+  ///the PVD collection file. The data files are written separately.
+  class PVDFile{
+  public:
+    ///\brief Add dataset to the collection
+    ///\param time_step Time value for the dataset, e.g. simulation year
+    ///\param file_name VTK data file relative to the PVD file location
+    ///\param part Part number if several datasets share the same time value
+    ///\param name Optional dataset name
+    ///\retval *this PVDFile object
+    PVDFile& addDataSet(double time_step, const std::string& file_name, int part=0, const std::string& name="");
+    ///\brief Number of datasets in the collection
+    std::size_t size()const{return datasets.size();}
+    ///\brief Write the PVD collection file
+    ///
+    ///The file is rewritten completely so that the collection can grow between writes.
+    ///\param file_name PVD file name
+    ///\retval true File written
+    ///\retval false File could not be opened for writing
+    bool write(const std::string& file_name)const;
+  private:
+    std::vector<PVDDataSet> datasets;///< Datasets in the collection
+  };
+}
+#endif
@@ -0,0 +1,96 @@
+#ifndef TREECACHE_H
+#define TREECACHE_H
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <LignumVTK.h>
+#include <LignumVTKTree.h>
+///\file TreeCache.h
+/// \brief Persistent cache for VTK datasets of trees.
+///
+/// Re-exporting the same HDF5 file after adding a few years or trees regenerates
+/// every tree. The cache stores the VTK datasets of each tree under a key computed
+/// from the tree XML string and the geometry options. Unchanged trees are read
+/// from the cache and only new or modified trees are reconstructed.
+namespace lignumvtk{
+
+  ///\brief Cache format version, part of the cache key.
+  ///\attention Increase the version if the VTK datasets created for trees change.
+  const std::string TREE_CACHE_VERSION="LignumVTKTreeCache-1";
+  ///\brief Manifest file in each cache entry directory.
+  ///
+  ///The manifest lists the block names and number of partitions in the cache entry.
+  ///It is written last so that incomplete entries are never used.
+  const std::string TREE_CACHE_MANIFEST="manifest.txt";
+  ///\brief Number of blocks in a cache entry.
+  ///
+  ///Foliage, heartwood and segments for conifers, leaves, petioles and segments for broadleaved trees.
+  const unsigned int TREE_CACHE_BLOCKS=3;
+
+  ///\brief Partitioned dataset blocks of one tree, block name and polydata partitions
+  typedef std::vector<std::pair<std::string,PolyDataVector>> TreeBlocks;
+
+  ///\brief 64-bit FNV-1a hash.
+  ///
+  ///Simple and stable over compilers and platforms, unlike std::hash.
+  class ContentHash{
+  public:
+    ContentHash():hash(14695981039346656037ULL){}
+    ///\brief Add bytes to the hash
+    ///\param data Data bytes
+    ///\param n Number of bytes
+    ContentHash& add(const void* data,std::size_t n);
+    ///\brief Add string to the hash
+    ContentHash& add(const std::string& s){return add(s.data(),s.size());}
+    ///\brief Add integer to the hash as four bytes in little-endian order
+    ContentHash& add(int i);
+    ///\brief Hash value as 16 hexadecimal digits
+    const std::string hex()const;
+  private:
+    std::uint64_t hash;///< Current hash value
+  };
+
+  ///\brief Persistent content addressed cache for tree VTK datasets.
+  ///
+  ///Each cache entry is a directory named by the cache key. The directory contains
+  ///one VTK/VTP file for each polydata partition and the manifest file.
+  ///The key is computed from the tree XML string, the tree reader and geometry options. The dataset
+  ///view (tree or component) is chosen at writing and is not part of the key.
+  class TreeCache{
+  public:
+    ///\brief Constructor
+    ///
+    ///The cache directory is created if it does not exist.
+    ///\param dir Cache directory
+    TreeCache(const std::string& dir);
+    ///\brief Cache key for a tree
+    ///\param tree_string Lignum XML string of the tree
+    ///\param spline_resolution Spline segment resolution
+    ///\param nsides Number of tube sides
+    ///\param reader Tree reader, the TREE_READER value, the readers may collect different tree data
+    ///\return Cache key as hexadecimal string
+    const std::string key(const std::string& tree_string,int spline_resolution,int nsides,int reader)const;
+    ///\brief Read tree datasets from the cache
+    ///\param key Cache key
+    ///\param[out] blocks Tree datasets
+    ///\retval true Cache hit, TREE_CACHE_BLOCKS blocks
+    ///\retval false Cache miss, \p blocks is not valid
+    bool load(const std::string& key,TreeBlocks& blocks);
+    ///\brief Write tree datasets to the cache
+    ///\param key Cache key
+    ///\param blocks Tree datasets
+    ///\retval true Cache entry written
+    ///\retval false Cache entry could not be written
+    bool store(const std::string& key,const TreeBlocks& blocks)const;
+    ///\brief Number of cache hits
+    int getHits()const{return hits;}
+    ///\brief Number of cache misses
+    int getMisses()const{return misses;}
+  private:
+    std::string cache_dir;///< Cache directory
+    int hits;///< Number of cache hits
+    int misses;///< Number of cache misses
+  };
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef VOXELEXPRESSION_H
+#define VOXELEXPRESSION_H
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+///\file VoxelExpression.h
+/// \brief Derived voxel fields computed during voxel space conversion.
+///
+/// Derived fields are given as assignments separated with semicolons, e.g.
+/// *LAD=A/volume; ratio=Qabs/Qin; shade=cumz(LAD)*. An expression has numbers,
+/// attribute names, names of derived fields assigned before, the voxel volume *volume*,
+/// the operators + - * / and parentheses. The function *cumz(expression)* is the cumulative
+/// sum in each voxel column along z from the lowest voxel layer up. There is no sum from
+/// the top down: slabs are evaluated from the bottom up and a column sum is not known before
+/// the top slab.
+///
+/// Expressions are evaluated one array at a time for all voxels in a slab. The loops over
+/// the arrays are split between threads and simple enough for the compiler to vectorise.
+/// The number of threads is set with VoxelExpressions::setThreads, e.g. one thread when several
+/// voxel spaces are converted in parallel.
+namespace lignumvtk{
+
+  ///\brief Node in the expression tree
+  ///
+  ///Each node is one operation on arrays of voxel values.
+  class VoxelExpressionNode{
+  public:
+    ///\brief Operation
+    enum class OPERATION{NUMBER,COLUMN,ADD,SUBTRACT,MULTIPLY,DIVIDE,NEGATE,CUMZ};
+    VoxelExpressionNode(OPERATION o):op(o),value(0.0),column(-1),carry_k(0){}
+    OPERATION op;///< Operation
+    double value;///< Value for OPERATION::NUMBER
+    int column;///< Input or derived column for OPERATION::COLUMN
+    std::unique_ptr<VoxelExpressionNode> left;///< First operand
+    std::unique_ptr<VoxelExpressionNode> right;///< Second operand for binary operations
+    std::vector<double> carry;///< OPERATION::CUMZ sums for each voxel column below the layer \p carry_k
+    int carry_k;///< OPERATION::CUMZ first voxel layer not summed to \p carry
+  };
+
+  ///\brief Parse and evaluate derived voxel fields
+  ///
+  ///The derived fields are appended as new data columns to the voxel data read from HDF5.
+  ///Voxel data can be evaluated in consecutive slabs of voxel layers in z dimension.
+  ///Slabs may overlap, the cumulative sums take the overlap into account.
+  ///\note Division by zero follows IEEE arithmetic, e.g. 0/0 is NaN and NaN values are set to 0
+  ///when the data is transposed to VTK arrays.
+  class VoxelExpressions{
+  public:
+    VoxelExpressions():nd(0),volume(1.0),threads(std::max(1u,std::thread::hardware_concurrency())){}
+    ///\brief Parse derived fields
+    ///\param text Assignments separated with semicolons, e.g. *LAD=A/volume; ratio=Qabs/Qin*
+    ///\param attr_names Names of the data columns in the voxel data
+    ///\param voxel_volume Value of the variable *volume*
+    ///\retval true All assignments are valid
+    ///\retval false Syntax error or unknown name
+    bool parse(const std::string& text,const std::vector<std::string>& attr_names,double voxel_volume);
+    ///\brief Set the number of threads for evaluation
+    ///\param n Number of threads, 0 for the number of hardware threads
+    void setThreads(unsigned int n){threads = (n == 0) ? std::max(1u,std::thread::hardware_concurrency()) : n;}
+    ///\brief Names of the derived fields in the order of assignment
+    const std::vector<std::string>& getNames()const{return names;}
+    ///\brief Append derived fields to voxel data
+    ///\param[in,out] data Voxel data [x][y][z][d] in row-major order, derived fields are appended to \e d
+    ///\param nx Number of voxels in X dimension
+    ///\param ny Number of voxels in Y dimension
+    ///\param nz Number of voxel layers in Z dimension
+    ///\param k_offset Index of the first voxel layer of \p data in Z dimension
+    ///\pre Slabs are evaluated in the order of \p k_offset
+    void evaluate(std::vector<double>& data,int nx,int ny,int nz,int k_offset=0);
+  private:
+    ///\brief Evaluate expression tree to \p out
+    void evaluate(VoxelExpressionNode& node,std::size_t n,int nz,int k_offset,std::vector<double>& out);
+    ///\brief Operand array, a column array or \p tmp with the evaluated node
+    const double* operand(VoxelExpressionNode& node,std::size_t n,int nz,int k_offset,std::vector<double>& tmp);
+    int nd;///< Number of data columns in the voxel data
+    double volume;///< Voxel volume
+    unsigned int threads;///< Number of threads for evaluation
+    std::vector<std::string> names;///< Names of the derived fields
+    std::vector<std::unique_ptr<VoxelExpressionNode>> expressions;///< Expression tree for each derived field
+    std::vector<bool> used;///< Input columns used in expressions
+    std::vector<std::vector<double>> columns;///< Input and derived columns for one slab
+  };
+}
+#endif
@@ -4,14 +4,65 @@
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <cstdint>
+#include <unordered_map>
 #include <LignumVTK.h>
 #include <TMatrixN.h>
 ///\file VoxelSpaceToVTK.h
-/// \brief Transform TMatrix4D  to VTK structured grid
+/// \brief Transform TMatrix4D  to VTK structured grid or image data
 ///
-/// Transform TMatrix4D voxel space data to a VTK structured grid for ParaView visualization.
+/// Transform TMatrix4D voxel space data to a VTK structured grid or image data for ParaView visualization.
 namespace lignumvtk{
 
+  ///\brief VTK structured grid file extension
+  const std::string VTS_EXTENSION=".vts";
+  ///\brief VTK image data file extension
+  const std::string VTI_EXTENSION=".vti";
+  ///\brief VTK unstructured grid file extension
+  const std::string VTU_EXTENSION=".vtu";
+  ///\brief VTK grid type for voxel space
+  ///
+  ///Structured grid stores coordinates for each grid point. Image data is a regular grid
+  ///defined by the origin and spacing (voxel edge sizes) and no point coordinates are stored.
+  enum class VOXEL_GRID_TYPE{STRUCTURED_GRID,IMAGE_DATA};
+  ///\brief Voxel data as cell data, point data or both
+  enum class VOXEL_DATA_ASSOCIATION{CELL,POINT,BOTH};
+  ///\brief Aggregation of voxel data to coarser levels
+  ///
+  ///Masses and areas are summed, intensities and densities are averaged.
+  enum class VOXEL_AGGREGATE{MEAN,SUM};
+  ///\brief Tile size for TransposeVoxelData
+  const int VOXEL_TRANSPOSE_BLOCK=16;
+
+  ///\brief Transpose HDF5 voxel space data to VTK point arrays.
+  ///
+  ///HDF5 voxel space data is in row-major order [x][y][z][d], i.e. the data dimension \p d
+  ///changes fastest and \p x slowest. VTK arrays are in x-y-z order with \p x changing fastest.
+  ///The transpose is done in VOXEL_TRANSPOSE_BLOCK sized tiles in x and z so that
+  ///both reads and writes stay in cache. NaN values are replaced with 0.
+  ///\param src Voxel space data, \p nx*ny*nz*nd values 
+  ///\param nx Number of points in X dimension
+  ///\param ny Number of points in Y dimension
+  ///\param nz Number of points in Z dimension
+  ///\param nd Number of data columns
+  ///\param[out] dst Arrays of \p nx*ny*nz values, one for each data column 
+  ///\return Number of NaN values replaced
+  std::size_t TransposeVoxelData(const double* src,int nx,int ny,int nz,int nd,const vector<double*>& dst);
+  ///\brief Copy cell values from point values.
+  ///
+  ///The value of cell (i,j,k) is the value of its first corner point (i,j,k).
+  ///The copy can be done in place, i.e. \p cell can be the same array as \p point.
+  ///\param point Point array with \p nx*ny*nz values in x-y-z order
+  ///\param nx Number of points in X dimension
+  ///\param ny Number of points in Y dimension
+  ///\param nz Number of points in Z dimension
+  ///\param[out] cell Cell array with (\p nx-1)*(\p ny-1)*(\p nz-1) values in x-y-z order
+  void CopyPointToCellData(const double* point,int nx,int ny,int nz,double* cell);
+  ///\brief Write image data to a file in binary appended mode
+  ///\param image Image data
+  ///\param file_name VTK/VTI file
+  void WriteImageData(vtkImageData* image,const std::string& file_name);
+
   ///\brief Transform VoxelSpace data to a VTK file for visualization
   ///
   ///Convert VoxelSpace and data to vtkStructuredGrid representation.
@@ -31,38 +82,185 @@ namespace lignumvtk{
     VoxelSpaceToVTK(int nx, int ny, int nz);
     ///\brief Constructor
     ///
-    ///Create vtkStructuredGrid \p sgrid with dimensions and grid points based on edge lengths.
+    ///Create vtkStructuredGrid \p sgrid with dimensions and grid points based on edge lengths
+    ///or vtkImageData \p igrid with dimensions, origin at (0,0,0) and edge lengths as spacing.
     ///\param nx Number of vo in X dimension
     ///\param ny Number of voxels in Y dimension
     ///\param nz Number of voxels in Z dimension
     ///\param x_edge Length of a voxel edge in X dimension
     ///\param y_edge Length of a voxel edge in Y dimension
     ///\param z_edge Length of a voxel edge in Z dimension
+    ///\param grid_type Structured grid or image data
     ///\remark The point ordering in the 3D structured grid
-    ///is i-j-k with i increasing fastest, then j and k is the slowest.  
-    VoxelSpaceToVTK(int nx, int ny, int nz, double x_edge, double y_edge, double z_edge);
-    ///\brief Insert VoxelSpace data to \p sgrid.
+    ///is i-j-k with i increasing fastest, then j and k is the slowest. Image data uses the same ordering.
+    VoxelSpaceToVTK(int nx, int ny, int nz, double x_edge, double y_edge, double z_edge,
+		    VOXEL_GRID_TYPE grid_type=VOXEL_GRID_TYPE::STRUCTURED_GRID);
+    ///\brief Constructor for a piece or a subvolume of a voxel space
+    ///
+    ///Create the grid for the points in \p extent. The point coordinates (structured grid)
+    ///or the origin (image data) are those of the whole grid so that the pieces
+    ///can be combined to parallel VTK files.
+    ///\param extent First and last point index in x,y,z: i0,i1,j0,j1,k0,k1
+    ///\param origin Coordinates of the point (0,0,0) 
+    ///\param spacing Distance between points in x,y,z 
+    ///\param grid_type Structured grid or image data
+    VoxelSpaceToVTK(const int extent[6], const double origin[3], const double spacing[3],
+		    VOXEL_GRID_TYPE grid_type=VOXEL_GRID_TYPE::STRUCTURED_GRID);
+    ///\brief Insert VoxelSpace data to the grid.
     ///
-    ///Data from the matrix \p vsm  is inserted to \p sgrid as cell data named attributes.
+    ///Data from the matrix \p vsm  is inserted to \p sgrid or \p igrid as cell data named attributes.
     ///The index of an attribute  name in the \p attr_names vector corresponds
     ///to the index in the data (4th) dimension of \p vsm.
     ///\param vsm 4D Matrix representing VoxelSpace spatial dimensions and data
     ///\param attr_names Attribute names
-    ///\pre Dimensions between \p sgrid and \p vsm match
+    ///\pre Dimensions between the grid and \p vsm match
     ///\pre The length of \p attr_data equals \p vsm.d()
     ///\retval *this VoxelSpaceToVTK object
-    ///\sa sgrid
+    ///\sa sgrid igrid
     VoxelSpaceToVTK& insertVoxelSpaceData(const cxxadt::TMatrix4D<double>& vsm,const vector<string>& attr_names);
+    ///\brief Insert VoxelSpace data from HDF5 buffer to the grid.
+    ///
+    ///Data from the buffer \p data is transposed directly to VTK point arrays and the cell arrays
+    ///are copied from the point arrays. No intermediate TMatrix4D is needed.
+    ///\param data Voxel space data as read from HDF5, [x][y][z][d] in row-major order
+    ///\param nx Number of voxels in X dimension
+    ///\param ny Number of voxels in Y dimension
+    ///\param nz Number of voxels in Z dimension
+    ///\param nd Number of data columns
+    ///\param attr_names Attribute names
+    ///\param association Insert data as cell data, point data or both
+    ///\pre Dimensions between the grid and \p data match
+    ///\pre The length of \p attr_names equals \p nd
+    ///\retval *this VoxelSpaceToVTK object
+    ///\sa TransposeVoxelData CopyPointToCellData
+    VoxelSpaceToVTK& insertVoxelSpaceData(const double* data,int nx,int ny,int nz,int nd,const vector<string>& attr_names,
+					  VOXEL_DATA_ASSOCIATION association=VOXEL_DATA_ASSOCIATION::BOTH);
     ///\brief Write \p sgrid to a file
     ///\param file_name File name
     ///\retval *this VoxelSpaceToVTK object
     ///\sa sgrid
     VoxelSpaceToVTK& writeStructuredGrid(const std::string& file_name);
+    ///\brief Write \p igrid to a file
+    ///
+    ///The data arrays are written in binary appended mode.
+    ///\param file_name File name
+    ///\retval *this VoxelSpaceToVTK object
+    ///\sa igrid
+    VoxelSpaceToVTK& writeImageData(const std::string& file_name);
+    ///\brief Write the grid to a file with the writer for the grid type
+    ///\param file_name File name
+    ///\retval *this VoxelSpaceToVTK object
+    VoxelSpaceToVTK& writeGrid(const std::string& file_name);
+    ///\brief The grid type
+    VOXEL_GRID_TYPE getGridType()const{return grid_type;}
   private:
+    ///\brief The grid in use, \p sgrid or \p igrid
+    vtkDataSet* grid();
+    ///\brief Grid type 
+    VOXEL_GRID_TYPE grid_type;
     ///\brief Structured grid for VoxelSpace dimensions and data representation
     vtkNew<vtkStructuredGrid> sgrid;
+    ///\brief Image data for VoxelSpace dimensions and data representation
+    vtkNew<vtkImageData> igrid;
     ///\brief Structureg grid writer
     vtkNew<vtkXMLStructuredGridWriter> writer;
+    ///\brief Image data writer
+    vtkNew<vtkXMLImageDataWriter> image_writer;
+  };
+
+  ///\brief Transform occupied voxels to a VTK unstructured grid of hexahedra
+  ///
+  ///Voxels where all data values are below or equal to a threshold are skipped and
+  ///each remaining voxel is one hexahedron with the voxel data as cell data.
+  ///The hexahedra share their corner points. The size of the grid is proportional
+  ///to the number of occupied voxels. Data can be inserted in slabs.
+  class SparseVoxelSpaceToVTK{
+  public:
+    ///\brief Constructor
+    ///\param origin Coordinates of the voxel (0,0,0) corner 
+    ///\param spacing Voxel edge lengths in x,y,z 
+    ///\param attr_names Attribute names
+    ///\param threshold Voxel is occupied if one of its data values is above \p threshold
+    SparseVoxelSpaceToVTK(const double origin[3],const double spacing[3],const vector<string>& attr_names,double threshold);
+    ///\brief Insert occupied voxels from HDF5 buffer
+    ///\param data Voxel space data as read from HDF5, [x][y][z][d] in row-major order
+    ///\param nx Number of voxels in X dimension
+    ///\param ny Number of voxels in Y dimension
+    ///\param nz Number of voxels in Z dimension
+    ///\param nd Number of data columns
+    ///\param k_offset Index of the first voxel layer of \p data in Z dimension 
+    ///\return Number of occupied voxels inserted
+    ///\pre \p nd equals the number of attribute names
+    std::size_t insertVoxelSpaceData(const double* data,int nx,int ny,int nz,int nd,int k_offset=0);
+    ///\brief Write the unstructured grid to a file in binary appended mode
+    ///\param file_name File name
+    ///\retval *this SparseVoxelSpaceToVTK object
+    SparseVoxelSpaceToVTK& writeUnstructuredGrid(const std::string& file_name);
+    ///\brief Number of occupied voxels
+    vtkIdType getNumberOfVoxels(){return ugrid->GetNumberOfCells();}
+  private:
+    ///\brief Point id for the voxel corner (i,j,k), the point is created if needed
+    vtkIdType pointId(int i,int j,int k);
+    double origin[3];///< Coordinates of the voxel (0,0,0) corner 
+    double spacing[3];///< Voxel edge lengths
+    double threshold;///< Occupancy threshold
+    ///\brief Voxel corner index to point id 
+    std::unordered_map<std::uint64_t,vtkIdType> point_ids;
+    ///\brief Unstructured grid for the occupied voxels
+    vtkNew<vtkUnstructuredGrid> ugrid;
+    ///\brief Voxel corner points
+    vtkNew<vtkPoints> points;
+    ///\brief Cell data arrays, one for each attribute
+    vector<vtkNew<vtkDoubleArray>> v_attr_cell;
+    ///\brief Unstructured grid writer
+    vtkNew<vtkXMLUnstructuredGridWriter> writer;
+  };
+
+  ///\brief Multi-resolution pyramid of a voxel space
+  ///
+  ///Level \e l has 2^\e l x 2^\e l x 2^\e l voxels aggregated to one cell. All levels
+  ///are accumulated in one pass over the voxel data that can be inserted in slabs of voxel layers.
+  ///Each level is a cell centred image data with the voxel data as cell data.
+  ///Level 0 (full resolution) is not stored, the coarser levels together take
+  ///less than 1/7 of the memory of the full resolution data.
+  class VoxelPyramid{
+  public:
+    ///\brief Constructor
+    ///\param nx Number of voxels in X dimension
+    ///\param ny Number of voxels in Y dimension
+    ///\param nz Number of voxels in Z dimension
+    ///\param levels Number of coarser levels 
+    ///\param aggregate Aggregation for each data column
+    VoxelPyramid(int nx,int ny,int nz,int levels,const vector<VOXEL_AGGREGATE>& aggregate);
+    ///\brief Accumulate voxel data to the coarser levels
+    ///\param data Voxel space data as read from HDF5, [x][y][z][d] in row-major order
+    ///\param nz Number of voxel layers in \p data
+    ///\param k_offset Index of the first voxel layer of \p data in Z dimension 
+    ///\pre The voxels in X and Y dimensions and the data columns are those given in the constructor
+    ///\retval *this VoxelPyramid object
+    VoxelPyramid& insertVoxelSpaceData(const double* data,int nz,int k_offset);
+    ///\brief Number of coarser levels 
+    int getNumberOfLevels()const{return levels;}
+    ///\brief Number of cells in one dimension for a level
+    ///\param level Level, 0 is the full resolution
+    ///\param dim Dimension 0,1,2 for x,y,z
+    int getNumberOfCells(int level,int dim)const{return (n[dim]+(1<<level)-1) >> level;}
+    ///\brief Image data for a coarser level
+    ///\param level Level, 1 to getNumberOfLevels()
+    ///\param origin Coordinates of the voxel (0,0,0) corner 
+    ///\param spacing Voxel edge lengths at full resolution
+    ///\param attr_names Attribute names
+    ///\return Image data with the aggregated voxel data as cell data
+    vtkSmartPointer<vtkImageData> getLevel(int level,const double origin[3],const double spacing[3],
+					    const vector<string>& attr_names)const;
+  private:
+    int n[3];///< Number of voxels at full resolution
+    int levels;///< Number of coarser levels
+    vector<VOXEL_AGGREGATE> aggregate;///< Aggregation for each data column
+    ///\brief Sums for each level 1..levels, data columns are contiguous for each cell
+    vector<vector<double>> sum;
+    ///\brief Number of voxels in each cell for each level 1..levels
+    vector<vector<std::uint32_t>> count;
   };
 }
 #endif
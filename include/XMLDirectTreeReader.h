@@ -0,0 +1,61 @@
+#ifndef XMLDIRECTTREEREADER_H
+#define XMLDIRECTTREEREADER_H
+#include <string>
+#include <QXmlStreamReader>
+#include <LignumVTKTree.h>
+#include <XMLStreamTreeReader.h>
+///\file XMLDirectTreeReader.h
+/// \brief Read Lignum XML directly to tree segment data.
+///
+/// The Lignum XML axis structure is streamed with QXmlStreamReader into the tree segment data
+/// collections for spline tubes, one TSData for each axis, and for broadleaved trees petiole and leaf data.
+/// No Lignum tree is built. The collected data is the same as from CollectConiferTree and
+/// CollectBroadLeafTree for the tree read with XMLDomTreeReader or XMLStreamTreeReader.
+/// The segment values are taken from the tree segment elements, i.e. the values Lignum wrote
+/// for the segment. The Lignum tree readers set the segment and leaf attributes these values are
+/// computed from. The program *treereaders* in *tools* compares the three readers.
+namespace lignumvtk{
+
+  ///\brief Read Lignum XML to CollectedTree without Lignum tree
+  ///\sa XMLStreamTreeReader for the XML elements read
+  class XMLDirectTreeReader{
+  public:
+    XMLDirectTreeReader():broadleaf(false){}
+    ///\brief Read Lignum XML file
+    ///\param file_name Lignum XML file
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\param[out] ct Collected tree data
+    ///\retval true The tree is read
+    ///\retval false The file cannot be read or it is not Lignum XML
+    bool readXMLToCollectedTree(const std::string& file_name,const std::string& tree_id,CollectedTree& ct);
+    ///\brief Read Lignum XML string, e.g. from HDF5 file
+    ///\param xml Lignum XML
+    ///\param tree_id Tree id tag for vtkAssembly
+    ///\param[out] ct Collected tree data
+    ///\retval true The tree is read
+    ///\retval false The string is not Lignum XML
+    ///\note The string is not copied
+    bool readXMLStringToCollectedTree(const std::string& xml,const std::string& tree_id,CollectedTree& ct);
+  private:
+    ///\brief Read the root element and the main axis
+    bool readTree(QXmlStreamReader& reader,const std::string& tree_id,CollectedTree& ct);
+    ///\brief Read the compartments of an axis
+    ///
+    ///The TSData of the axis is appended to \p v before the data of its branches
+    ///as in CollectTSData with Lignum::AccumulateDown.
+    ///\param reader XML reader at *Axis* start element
+    ///\param[out] ct Petiole and leaf data appended for broadleaved trees
+    ///\param[out] v Tree segment data of the axis and its branches appended
+    void readAxis(QXmlStreamReader& reader,CollectedTree& ct,TSDataVector& v);
+    ///\brief Read tree segment and append its point and data to \p data
+    void readTreeSegment(QXmlStreamReader& reader,CollectedTree& ct,TSData& data);
+    ///\brief Read bud point and append it with the data of the last segment to \p data
+    void readBud(QXmlStreamReader& reader,TSData& data);
+    ///\brief Read broadleaf and append petiole and leaf data
+    ///\param reader XML reader at *BroadLeaf* start element
+    ///\param[out] ct Petiole and leaf data appended
+    void readBroadLeaf(QXmlStreamReader& reader,CollectedTree& ct);
+    bool broadleaf;///< The tree is broadleaved
+  };
+}
+#endif
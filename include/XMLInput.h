@@ -0,0 +1,51 @@
+#ifndef XMLINPUT_H
+#define XMLINPUT_H
+#include <cstddef>
+#include <string>
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <MappedFile.h>
+///\file XMLInput.h
+/// \brief Lignum XML input for QXmlStreamReader without copies.
+///
+/// XML files are memory mapped and read in place, the operating system reads the pages ahead.
+/// The mapped region and XML strings in memory are read through QBuffer so that QXmlStreamReader
+/// decodes the input in small blocks. With a QByteArray as input QXmlStreamReader would
+/// decode the whole input to one QString, twice the size of the XML.
+namespace lignumvtk{
+
+  ///\brief XML input device for QXmlStreamReader
+  ///
+  ///The class is not copyable.
+  class XMLInput{
+  public:
+    ///\brief Map XML file
+    ///
+    ///If the file cannot be mapped or it is too large for QByteArray the file is read with QFile.
+    ///\param file_name XML file
+    XMLInput(const std::string& file_name);
+    ///\brief XML in memory, e.g. HDF5 tree string
+    ///\param data XML
+    ///\param n Length of \p data
+    ///\pre \p data remains valid during the lifetime of XMLInput
+    XMLInput(const char* data,std::size_t n);
+    XMLInput(const XMLInput&)=delete;
+    XMLInput& operator=(const XMLInput&)=delete;
+    ///\brief Query if the input is open for reading
+    bool isOpen()const{return device()->isOpen();}
+    ///\brief Input device for QXmlStreamReader
+    QIODevice* device(){return use_file ? static_cast<QIODevice*>(&file) : static_cast<QIODevice*>(&buffer);}
+    ///\brief Input device for QXmlStreamReader
+    const QIODevice* device()const{return use_file ? static_cast<const QIODevice*>(&file) : static_cast<const QIODevice*>(&buffer);}
+  private:
+    ///\brief Open \p buffer for \p data without copying
+    void openBuffer(const char* data,std::size_t n);
+    MappedFile mapped_file;///< Memory mapped XML file
+    QBuffer buffer;///< Device for the mapped file or XML in memory
+    QFile file;///< Device for the XML file if it is not mapped
+    bool use_file;///< Read with \p file instead of \p buffer
+  };
+}
+#endif
@@ -0,0 +1,153 @@
+#ifndef XMLSTREAMTREEREADER_H
+#define XMLSTREAMTREEREADER_H
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <QXmlStreamReader>
+#include <Lignum.h>
+#include <XMLTree.h>
+#include <XMLInput.h>
+///\file XMLStreamTreeReader.h
+/// \brief Streaming Lignum XML tree reader.
+///
+/// The XML is read with QXmlStreamReader one element at a time and the tree compartments
+/// are created and inserted into the tree as their elements end. No DOM is built, i.e. only
+/// the Lignum tree is in memory. The elements follow the layout of XMLDomTreeWriter:
+///
+///     <Tree SegmentType="Cf" ...>
+///       <TreeParameters/> <TreeFunctions/> <TreeAttributes/>
+///       <Axis>
+///         <TreeSegment> <CfTreeSegmentAttributes> <point>x y z</point> <LGAL>l</LGAL> ... </CfTreeSegmentAttributes> </TreeSegment>
+///         <BranchingPoint> <BranchingPointAttributes/> <Axis>...</Axis> </BranchingPoint>
+///         <Bud> <BudAttributes/> </Bud>
+///       </Axis>
+///     </Tree>
+///
+/// The reader is for visualisation: tree parameters, tree functions and tree attributes are skipped and
+/// only the compartment attributes collected by CollectTSData, CollectPetioleData and CollectLeafData are set.
+namespace lignumvtk{
+
+  ///\brief Tree reader for Lignum XML
+  ///
+  ///TREE_READER::DOM is XMLDomTreeReader, TREE_READER::STREAM is XMLStreamTreeReader and
+  ///TREE_READER::DIRECT is XMLDirectTreeReader that collects the tree data without Lignum tree.
+  ///\sa XML_TREE_READER
+  enum class TREE_READER{DOM,STREAM,DIRECT};
+  ///\brief Tree reader used for Lignum XML files and HDF5 tree datasets
+  ///\remark `inline` so that all translation units share the value set from command line.
+  inline TREE_READER XML_TREE_READER = TREE_READER::DOM;
+
+  ///\name Lignum XML element names read by XMLStreamTreeReader
+  ///@{
+  ///\brief Point element, text is "x y z"
+  const QLatin1String XML_POINT("point");
+  ///\brief Direction element, text is "x y z"
+  const QLatin1String XML_DIRECTION("direction");
+  ///\brief Broadleaf petiole start point
+  const QLatin1String XML_PETIOLE_START("PetioleStart");
+  ///\brief Broadleaf petiole end point
+  const QLatin1String XML_PETIOLE_END("PetioleEnd");
+  ///\brief Broadleaf leaf normal
+  const QLatin1String XML_LEAF_NORMAL("LeafNormal");
+  ///\brief Kite leaf corner points in the order of the Kite constructor
+  const QLatin1String XML_KITE_POINTS[4] = {QLatin1String("KiteBaseP"),QLatin1String("KiteLeftP"),
+					     QLatin1String("KiteRightP"),QLatin1String("KiteApexP")};
+  ///@}
+
+  ///\brief Read "x y z" element text
+  ///\param reader XML reader at the start element
+  inline Point ReadXMLPoint(QXmlStreamReader& reader)
+  {
+    const QByteArray text = reader.readElementText().toLatin1();
+    char* end = nullptr;
+    const double x = std::strtod(text.constData(),&end);
+    const double y = std::strtod(end,&end);
+    const double z = std::strtod(end,&end);
+    return Point(x,y,z);
+  }
+
+  ///\brief Read "x y z" element text as direction
+  ///\param reader XML reader at the start element
+  inline PositionVector ReadXMLDirection(QXmlStreamReader& reader)
+  {
+    const Point p = ReadXMLPoint(reader);
+    return PositionVector(p.getX(),p.getY(),p.getZ());
+  }
+
+  ///\brief Read number element text
+  ///\param reader XML reader at the start element
+  inline double ReadXMLValue(QXmlStreamReader& reader)
+  {
+    const QByteArray text = reader.readElementText().toLatin1();
+    return std::strtod(text.constData(),nullptr);
+  }
+
+  ///\brief Read Lignum XML to tree with QXmlStreamReader
+  ///
+  ///The interface is the same as in XMLDomTreeReader.
+  ///\tparam TS Tree segment
+  ///\tparam BUD Bud
+  ///\tparam S Leaf shape for broadleaved trees, currently cxxadt::Kite
+  template <class TS,class BUD,class S=cxxadt::Ellipse>
+  class XMLStreamTreeReader{
+  public:
+    ///\brief Read Lignum XML file to tree
+    ///\param t Lignum tree
+    ///\param file_name Lignum XML file
+    ///\retval t The tree
+    Tree<TS,BUD>& readXMLToTree(Tree<TS,BUD>& t,const std::string& file_name);
+    ///\brief Read Lignum XML string to tree, e.g. from HDF5 file
+    ///\param t Lignum tree
+    ///\param xml Lignum XML
+    ///\retval t The tree
+    ///\note The string is not copied
+    Tree<TS,BUD>& readXMLStringToTree(Tree<TS,BUD>& t,const std::string& xml);
+  private:
+    ///\brief Read the root element and the main axis
+    Tree<TS,BUD>& readTree(Tree<TS,BUD>& t,QXmlStreamReader& reader);
+    ///\brief Read the compartments of an axis
+    void readAxis(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t);
+    ///\brief Read tree segment and insert it into \p axis
+    void readTreeSegment(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t);
+    ///\brief Read branching point and its axes and insert it into \p axis
+    void readBranchingPoint(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t);
+    ///\brief Read bud and insert it into \p axis
+    void readBud(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t);
+    ///\brief Read broadleaf
+    ///\return The leaf, nullptr if the leaf has no shape
+    BroadLeaf<S>* readBroadLeaf(QXmlStreamReader& reader);
+  };
+
+  ///\brief Read Lignum XML file to tree with the reader chosen in XML_TREE_READER
+  ///\param t Lignum tree
+  ///\param file_name Lignum XML file
+  ///\retval t The tree
+  template <class TS,class BUD,class S=cxxadt::Ellipse>
+  Tree<TS,BUD>& ReadXMLToTree(Tree<TS,BUD>& t,const std::string& file_name)
+  {
+    if (XML_TREE_READER == TREE_READER::STREAM){
+      XMLStreamTreeReader<TS,BUD,S> reader;
+      return reader.readXMLToTree(t,file_name);
+    }
+    XMLDomTreeReader<TS,BUD,S> reader;
+    return reader.readXMLToTree(t,file_name);
+  }
+
+  ///\brief Read Lignum XML string to tree with the reader chosen in XML_TREE_READER
+  ///\param t Lignum tree
+  ///\param xml Lignum XML
+  ///\retval t The tree
+  template <class TS,class BUD,class S=cxxadt::Ellipse>
+  Tree<TS,BUD>& ReadXMLStringToTree(Tree<TS,BUD>& t,const std::string& xml)
+  {
+    if (XML_TREE_READER == TREE_READER::STREAM){
+      XMLStreamTreeReader<TS,BUD,S> reader;
+      return reader.readXMLStringToTree(t,xml);
+    }
+    XMLDomTreeReader<TS,BUD,S> reader;
+    return reader.readXMLStringToTree(t,xml);
+  }
+}
+#include <XMLStreamTreeReaderI.h>
+#endif
@@ -0,0 +1,304 @@
+#ifndef XMLSTREAMTREEREADER_I_H
+#define XMLSTREAMTREEREADER_I_H
+#include <iostream>
+///\file XMLStreamTreeReaderI.h
+/// \brief Implementation file
+
+namespace lignumvtk{
+
+  ///\brief Compartment attribute element names and their Lignum attributes
+  class XMLAttributeName{
+  public:
+    QLatin1String name;///< Element name
+    LGMAD attribute;///< Lignum attribute
+  };
+
+  ///\brief Tree segment attributes set in addition to the segment dimensions for conifers and broadleaves
+  const XMLAttributeName XML_SEGMENT_ATTRIBUTES[] = {{QLatin1String("LGAQin"),LGAQin},{QLatin1String("LGAQabs"),LGAQabs}};
+  ///\brief Conifer segment attributes, broadleaved segments have foliage and production in their leaves
+  const XMLAttributeName XML_CF_SEGMENT_ATTRIBUTES[] = {{QLatin1String("LGARf"),LGARf},{QLatin1String("LGAWf"),LGAWf},
+							{QLatin1String("LGAP"),LGAP}};
+  ///\brief Broadleaf attributes
+  const XMLAttributeName XML_LEAF_ATTRIBUTES[] = {{QLatin1String("LGAWf"),LGAWf},{QLatin1String("LGAQin"),LGAQin},
+						  {QLatin1String("LGAQabs"),LGAQabs},{QLatin1String("LGAP"),LGAP}};
+
+  template <class TS,class BUD,class S>
+  Tree<TS,BUD>& XMLStreamTreeReader<TS,BUD,S>::readXMLToTree(Tree<TS,BUD>& t,const std::string& file_name)
+  {
+    XMLInput input(file_name);
+    if (!input.isOpen()){
+      std::cout << "XMLStreamTreeReader::readXMLToTree: Cannot open file " << file_name << std::endl;
+      return t;
+    }
+    QXmlStreamReader reader(input.device());
+    return readTree(t,reader);
+  }
+
+  template <class TS,class BUD,class S>
+  Tree<TS,BUD>& XMLStreamTreeReader<TS,BUD,S>::readXMLStringToTree(Tree<TS,BUD>& t,const std::string& xml)
+  {
+    XMLInput input(xml.data(),xml.size());
+    QXmlStreamReader reader(input.device());
+    return readTree(t,reader);
+  }
+
+  template <class TS,class BUD,class S>
+  Tree<TS,BUD>& XMLStreamTreeReader<TS,BUD,S>::readTree(Tree<TS,BUD>& t,QXmlStreamReader& reader)
+  {
+    if (!reader.readNextStartElement() || reader.name() != QLatin1String("Tree")){
+      std::cout << "XMLStreamTreeReader: No Tree root element" << std::endl;
+      return t;
+    }
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("Axis")){
+	readAxis(reader,GetAxis(t),t);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    if (reader.hasError()){
+      std::cout << "XMLStreamTreeReader: " << reader.errorString().toStdString() << " at line "
+		<< reader.lineNumber() << std::endl;
+    }
+    return t;
+  }
+
+  template <class TS,class BUD,class S>
+  void XMLStreamTreeReader<TS,BUD,S>::readAxis(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t)
+  {
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("TreeSegment")){
+	readTreeSegment(reader,axis,t);
+      }
+      else if (reader.name() == QLatin1String("BranchingPoint")){
+	readBranchingPoint(reader,axis,t);
+      }
+      else if (reader.name() == QLatin1String("Bud")){
+	readBud(reader,axis,t);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+  }
+
+  template <class TS,class BUD,class S>
+  void XMLStreamTreeReader<TS,BUD,S>::readTreeSegment(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t)
+  {
+    Point p;
+    PositionVector d(0,0,1);
+    double go = 0.0;
+    double l = 0.0;
+    double r = 0.0;
+    double rh = 0.0;
+    std::vector<std::pair<LGMAD,double>> values;
+    std::vector<BroadLeaf<S>*> leaves;
+    while (reader.readNextStartElement()){
+      //TreeSegmentAttributes, CfTreeSegmentAttributes or HwTreeSegmentAttributes
+      if (reader.name().endsWith(QLatin1String("TreeSegmentAttributes"))){
+	while (reader.readNextStartElement()){
+	  if (reader.name() == XML_POINT){
+	    p = ReadXMLPoint(reader);
+	  }
+	  else if (reader.name() == XML_DIRECTION){
+	    d = ReadXMLDirection(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAomega")){
+	    go = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAL")){
+	    l = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAR")){
+	    r = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGARh")){
+	    rh = ReadXMLValue(reader);
+	  }
+	  else{
+	    bool found = false;
+	    for (const XMLAttributeName& a : XML_SEGMENT_ATTRIBUTES){
+	      if (reader.name() == a.name){
+		values.push_back(std::make_pair(a.attribute,ReadXMLValue(reader)));
+		found = true;
+		break;
+	      }
+	    }
+	    if constexpr (std::is_base_of_v<CfTreeSegment<TS,BUD>,TS>){
+	      for (const XMLAttributeName& a : XML_CF_SEGMENT_ATTRIBUTES){
+		if (!found && reader.name() == a.name){
+		  values.push_back(std::make_pair(a.attribute,ReadXMLValue(reader)));
+		  found = true;
+		  break;
+		}
+	      }
+	    }
+	    if (!found){
+	      reader.skipCurrentElement();
+	    }
+	  }
+	}
+      }
+      else if (reader.name() == QLatin1String("BroadLeaf")){
+	if constexpr (std::is_base_of_v<HwTreeSegment<TS,BUD,S>,TS>){
+	  if (BroadLeaf<S>* leaf = readBroadLeaf(reader)){
+	    leaves.push_back(leaf);
+	  }
+	}
+	else{
+	  reader.skipCurrentElement();
+	}
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    TS* ts = new TS(p,d,go,l,r,rh,&t);
+    for (const auto& [attribute,value] : values){
+      SetValue(*ts,attribute,value);
+    }
+    if constexpr (std::is_base_of_v<HwTreeSegment<TS,BUD,S>,TS>){
+      for (BroadLeaf<S>* leaf : leaves){
+	InsertLeaf(*ts,leaf);
+      }
+    }
+    InsertTreeCompartment(axis,ts);
+  }
+
+  template <class TS,class BUD,class S>
+  void XMLStreamTreeReader<TS,BUD,S>::readBranchingPoint(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t)
+  {
+    BranchingPoint<TS,BUD>* bp = new BranchingPoint<TS,BUD>(Point(),PositionVector(0,0,1),&t);
+    InsertTreeCompartment(axis,bp);
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("BranchingPointAttributes")){
+	while (reader.readNextStartElement()){
+	  if (reader.name() == XML_POINT){
+	    SetPoint(*bp,ReadXMLPoint(reader));
+	  }
+	  else if (reader.name() == XML_DIRECTION){
+	    SetDirection(*bp,ReadXMLDirection(reader));
+	  }
+	  else{
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+      else if (reader.name() == QLatin1String("Axis")){
+	//The attributes of the branching point precede its axes
+	Axis<TS,BUD>* branch = new Axis<TS,BUD>(GetPoint(*bp),GetDirection(*bp),&t);
+	InsertAxis(*bp,branch);
+	readAxis(reader,*branch,t);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+  }
+
+  template <class TS,class BUD,class S>
+  void XMLStreamTreeReader<TS,BUD,S>::readBud(QXmlStreamReader& reader,Axis<TS,BUD>& axis,Tree<TS,BUD>& t)
+  {
+    Point p;
+    PositionVector d(0,0,1);
+    double go = 0.0;
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("BudAttributes")){
+	while (reader.readNextStartElement()){
+	  if (reader.name() == XML_POINT){
+	    p = ReadXMLPoint(reader);
+	  }
+	  else if (reader.name() == XML_DIRECTION){
+	    d = ReadXMLDirection(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAomega")){
+	    go = ReadXMLValue(reader);
+	  }
+	  else{
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    InsertTreeCompartment(axis,new BUD(p,d,go,&t));
+  }
+
+  template <class TS,class BUD,class S>
+  BroadLeaf<S>* XMLStreamTreeReader<TS,BUD,S>::readBroadLeaf(QXmlStreamReader& reader)
+  {
+    Point petiole_start;
+    Point petiole_end;
+    PositionVector normal(0,0,1);
+    Point corners[4];
+    int ncorners = 0;
+    double sf = 0.0;
+    double tauL = 0.0;
+    double dof = 0.0;
+    std::vector<std::pair<LGMAD,double>> values;
+    while (reader.readNextStartElement()){
+      if (reader.name() != QLatin1String("BroadLeafAttributes")){
+	reader.skipCurrentElement();
+	continue;
+      }
+      while (reader.readNextStartElement()){
+	bool found = false;
+	if (reader.name() == XML_PETIOLE_START){
+	  petiole_start = ReadXMLPoint(reader);
+	  found = true;
+	}
+	else if (reader.name() == XML_PETIOLE_END){
+	  petiole_end = ReadXMLPoint(reader);
+	  found = true;
+	}
+	else if (reader.name() == XML_LEAF_NORMAL){
+	  normal = ReadXMLDirection(reader);
+	  found = true;
+	}
+	else if (reader.name() == QLatin1String("LGAsf")){
+	  sf = ReadXMLValue(reader);
+	  found = true;
+	}
+	else if (reader.name() == QLatin1String("LGAtauL")){
+	  tauL = ReadXMLValue(reader);
+	  found = true;
+	}
+	else if (reader.name() == QLatin1String("LGAdof")){
+	  dof = ReadXMLValue(reader);
+	  found = true;
+	}
+	for (int i = 0; !found && i < 4; i++){
+	  if (reader.name() == XML_KITE_POINTS[i]){
+	    corners[i] = ReadXMLPoint(reader);
+	    ncorners++;
+	    found = true;
+	  }
+	}
+	for (const XMLAttributeName& a : XML_LEAF_ATTRIBUTES){
+	  if (!found && reader.name() == a.name){
+	    values.push_back(std::make_pair(a.attribute,ReadXMLValue(reader)));
+	    found = true;
+	  }
+	}
+	if (!found){
+	  reader.skipCurrentElement();
+	}
+      }
+    }
+    if constexpr (std::is_same_v<S,cxxadt::Kite>){
+      if (ncorners == 4){
+	BroadLeaf<S>* leaf = new BroadLeaf<S>(sf,tauL,dof,1,Petiole(petiole_start,petiole_end),normal,
+					      S(corners[0],corners[1],corners[2],corners[3]));
+	for (const auto& [attribute,value] : values){
+	  SetValue(*leaf,attribute,value);
+	}
+	return leaf;
+      }
+    }
+    return nullptr;
+  }
+}
+#endif
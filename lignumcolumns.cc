@@ -0,0 +1,141 @@
+#include <cstdlib>
+#include <ParseCommandLine.h>
+#include <LGMHDF5File.h>
+#include <Lignum.h>
+#include <XMLTree.h>
+#include <HDF5ToLignum.h>
+#include <HDF5TreeColumns.h>
+#include <LignumVTKTree.h>
+#include <CreateVTPCFile.h>
+/// \file lignumcolumns.cc
+/// \brief Main program for `lignumcolumns`
+///
+/// Convert the Lignum XML trees in HDF5 file to the columnar layout in HDF5TreeColumns.h.
+
+///\brief `lignumcolumns` command line
+int Usage()
+{
+  cout << "Usage:" << endl;
+  cout << "./lignumcolumns [-h | -help]" << endl;
+  cout << "./lignumcolumns -input|-i file.h5 -output|-o columns.h5 [-year <number>] [-dataset <path_string>]" << endl
+       << "[-substring <path_string>] [-reader dom|stream|direct]" << endl;
+  cout << "Default values:" <<endl;
+  cout << "-reader dom" << endl;
+  cout << "All trees in all years are converted if -year, -dataset or -substring is not given" << endl;
+  cout << "Examples:" << endl;
+  cout << "Convert all trees" << endl;
+  cout << "./lignumcolumns -input File.h5 -output FileColumns.h5" << endl;
+  cout << "Convert trees in year 20 with the direct reader" << endl;
+  cout << "./lignumcolumns -input File.h5 -output FileColumns.h5 -year 20 -reader direct" << endl;
+  cout << "Create VTK/VTPC file from the columnar file, no XML parsing" << endl;
+  cout << "./lignumvtk -input FileColumns.h5 -output File.vtpc -year 20" << endl;
+  return EXIT_SUCCESS;
+}
+
+///\brief Split HDF5 tree path to year and tree name
+///\param path Tree dataset path, e.g. */TreeXML/20/Tree_8*
+///\param main_group Main group, e.g. */TreeXML/*
+///\param[out] year Simulation year
+///\param[out] tree_id Tree name in the year group
+///\return true if \p path is a tree in a year group, false otherwise
+bool SplitTreePath(const string& path,const string& main_group,int& year,string& tree_id)
+{
+  if (path.compare(0,main_group.size(),main_group) != 0){
+    return false;
+  }
+  const std::string::size_type slash = path.find('/',main_group.size());
+  if (slash == std::string::npos){
+    return false;
+  }
+  try{
+    year = std::stoi(path.substr(main_group.size(),slash-main_group.size()));
+  }
+  catch (const std::exception& e){
+    return false;
+  }
+  tree_id = path.substr(slash+1);
+  return !tree_id.empty();
+}
+
+///\brief Read Lignum HDF5 file and write the trees in the columnar layout
+///\sa Usage()
+int main(int argc,char* argv[])
+{
+  if (argc < 2||CheckCommandLine(argc,argv,"-help")||CheckCommandLine(argc,argv,"-h")){
+    return Usage();
+  }
+  std::string input_file;
+  if (!(ParseCommandLine(argc,argv,"-input",input_file)||ParseCommandLine(argc,argv,"-i",input_file))){
+    cout << "No input file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  std::string output_file;
+  if (!(ParseCommandLine(argc,argv,"-output",output_file)||ParseCommandLine(argc,argv,"-o",output_file))){
+    cout << "No output file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  if (output_file == input_file){
+    cout << "The output file must not be the input file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  std::string reader;
+  if (ParseCommandLine(argc,argv,"-reader",reader)){
+    if (!lignumvtk::ParseTreeReader(reader,lignumvtk::XML_TREE_READER)){
+      return EXIT_FAILURE;
+    }
+    cout << "Using " << reader << " tree reader" << endl;
+  }
+  std::string year;
+  int growth_year = -1;
+  if (ParseCommandLine(argc,argv,"-year",year)){
+    try{
+      growth_year = std::stoi(year);
+    }
+    catch (const std::exception& e){
+      growth_year = -1;
+    }
+    if (growth_year < 0){
+      cout << "Year " << year << " should be a non-negative number, exiting" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::string dataset;
+  ParseCommandLine(argc,argv,"-dataset",dataset);
+  std::string substring;
+  ParseCommandLine(argc,argv,"-substring",substring);
+
+  lignumvtk::HDF5ToLignum hdf5lignum;
+  hdf5lignum.openFile(input_file);
+  if (hdf5lignum.hasTreeColumns()){
+    cout << "The trees in " << input_file << " are already in the columnar layout" << endl;
+    return EXIT_FAILURE;
+  }
+  vector<string> v = lignumvtk::SelectTreeDataSets(hdf5lignum,growth_year,dataset,substring);
+  if (v.size() == 0){
+    cout << "No HDF5 datasets for trees" << endl;
+    return EXIT_FAILURE;
+  }
+  lignumvtk::TreeColumnsWriter writer;
+  if (!writer.open(output_file)){
+    return EXIT_FAILURE;
+  }
+  int ntrees = 0;
+  for (unsigned int i = 0; i < v.size(); i++){
+    int tree_year = 0;
+    string tree_id;
+    if (!SplitTreePath(v[i],hdf5lignum.getMainGroupName(),tree_year,tree_id)){
+      cout << "Tree " << v[i] << " is not in a year group, skipping" << endl;
+      continue;
+    }
+    cout << "Tree " << i << ": " << v[i] << endl;
+    lignumvtk::CollectedTree ct;
+    if (!lignumvtk::CollectTreeFromHDF5(hdf5lignum,v[i],ct) || !writer.addTree(tree_year,tree_id,ct)){
+      writer.close();
+      return EXIT_FAILURE;
+    }
+    ntrees++;
+  }
+  writer.close();
+  cout << "Columnar HDF5 file: " << output_file << " with " << ntrees << " trees" << endl;
+  return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <limits>
 #include <ParseCommandLine.h>
 #include <LGMHDF5File.h>
 #include <Lignum.h>
@@ -16,18 +17,33 @@ int Usage()
 {
   cout << "Usage:" << endl;
   cout << "./lignumvtk [-h | -help]" << endl;
+  cout << "./lignumvtk -input|-i file.h5 -index" << endl;
   cout << "./lignumvtk -input|-i file.h5 [-list] [-output|-o file.vtpc] [-year <number>] [-dataset <path_string>]" << endl
-       << "[-substring <path_string>] [-spline <number>] [-sides <number>] [-view 0|1]" << endl;
+       << "[-substring <path_string>] [-spline <number>] [-sides <number>] [-view 0|1] [-cache <directory>] [-snapshot file.lvs]" << endl
+       << "[-reader dom|stream|direct] [-prefetch <number>] [-chunk-cache <MB>] [-meta-cache <MB>] [-core]" << endl;
+  cout << "./lignumvtk -input|-i file.h5 -output|-o file.pvd -years <first:last:step> [-spline <number>] [-sides <number>] [-view 0|1]" << endl
+       << "[-cache <directory>] [-prefetch <number>] [-chunk-cache <MB>] [-meta-cache <MB>] [-core]" << endl;
+  cout << "./lignumvtk -input|-i file.h5 -output|-o file.pvd -follow <seconds> [-idle <seconds>] [-spline <number>] [-sides <number>]" << endl
+       << "[-view 0|1] [-cache <directory>] [-prefetch <number>]" << endl;
+  cout << "./lignumvtk -input|-i file.lvs -output|-o file.vtpc [-spline <number>] [-sides <number>] [-view 0|1]" << endl;
+  cout << "./lignumvtk -input|-i file.[h5|xml|lvs] -output|-o file.vtpc -sweep \"spline=<n,n,...>;sides=<n,n,...>\" [-year <number>]" << endl
+       << "[-dataset <path_string>] [-substring <path_string>] [-view 0|1]" << endl;
   cout << "Default values:" <<endl;
   cout << "-spline " << lignumvtk::SPLINE_SEGMENT_RESOLUTION << endl;
   cout << "-sides  " << lignumvtk::TUBE_NUMBER_OF_SIDES << endl;
   cout << "-view   " << 0 << endl;
+  cout << "-reader dom" << endl;
+  cout << "-prefetch 0, each HDF5 tree is read when needed" << endl;
+  cout << "-idle 0, follow until interrupted" << endl;
+  cout << "-chunk-cache and -meta-cache HDF5 library defaults" << endl;
   cout << "----------" << endl;
   cout << "Examples:" << endl;
   cout << "Read Lignum XML file and produce VTK/VTPC file" << endl; 
   cout << "  ./lignumvtk -input File.xml -output File.vtpc" << endl;
   cout << "Read Lignum HDF5 file and list tree dataset paths" << endl; 
   cout << "  ./lignumvtk -input File.h5 -list" << endl;
+  cout << "Save index of tree datasets to File.h5.idx, later runs use the index while File.h5 is unchanged" << endl; 
+  cout << "  ./lignumvtk -input File.h5 -index" << endl;
   cout << "Read Lignum HDF5 file and produce VTK/VTPC files for growth year 20" << endl;
   cout << "./lignumvtk -input File.h5 -output File.vtpc -year 20" << endl;
   cout << "Read Lignum HDF5 file and produce VTK/VTPC file for Tree_8 in year 60" << endl;
@@ -38,9 +54,58 @@ int Usage()
   cout << "./lignumvtk -input File.h5 -output File.vtpc -substring Tree_13 -spline 5 -sides 10" << endl;
   cout << "Create component view" << endl;
   cout << "./lignumvtk -input File.h5 -output File.vtpc -year 20 -view 1" <<endl; 
+  cout << "Create time series for years 10 to 80 with 5 year steps, one VTK/VTPC file for each year" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.pvd -years 10:80:5" <<endl; 
+  cout << "Reuse unchanged trees from the tree cache directory, only new or modified trees are created" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.pvd -years 10:80:5 -cache VTKCache" <<endl; 
+  cout << "Save the data collected from trees in year 20 to snapshot file, no VTK/VTPC file" << endl;
+  cout << "./lignumvtk -input File.h5 -year 20 -snapshot File.lvs" <<endl; 
+  cout << "Create VTK/VTPC file from snapshot file with different tube settings" << endl;
+  cout << "./lignumvtk -input File.lvs -output File.vtpc -spline 10 -sides 20" <<endl; 
+  cout << "Read the trees with the streaming XML reader, no DOM in memory" << endl;
+  cout << "./lignumvtk -input File.xml -output File.vtpc -reader stream" <<endl; 
+  cout << "Read the tree segment data directly from XML, no Lignum tree" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.vtpc -year 20 -reader direct" <<endl; 
+  cout << "Mixed stand of conifers and broadleaved trees in one VTK/VTPC file" << endl;
+  cout << "./lignumvtk -input MixedStand.h5 -output MixedStand.vtpc -year 20" <<endl; 
+  cout << "Read trees converted to the columnar layout with lignumcolumns, no XML parsing" << endl;
+  cout << "./lignumvtk -input FileColumns.h5 -output File.vtpc -year 20" <<endl; 
+  cout << "Read 4 trees ahead while trees are parsed, 64 MB chunk cache, whole HDF5 file in memory if it fits" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.pvd -years 10:80:5 -prefetch 4 -chunk-cache 64 -core" <<endl; 
+  cout << "Follow HDF5 file of a running simulation, poll every 30 seconds and convert each new year, stop after one hour without changes" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.pvd -follow 30 -idle 3600" <<endl; 
+  cout << "Parameter sweep, one VTK/VTPC file for each combination and timing and size results in File_sweep.csv" << endl;
+  cout << "./lignumvtk -input File.h5 -output File.vtpc -year 20 -sweep \"spline=5,10,20;sides=6,12,30\"" <<endl; 
   return EXIT_SUCCESS;
 }
   
+///\brief Parse HDF5 cache size in megabytes
+///\param option Command line option for the message
+///\param value Cache size in megabytes
+///\param[out] bytes Cache size in bytes
+///\return true if \p value is a non-negative number of megabytes, false otherwise
+bool ParseCacheSize(const string& option,const string& value,size_t& bytes)
+{
+  const size_t max_mb = std::numeric_limits<size_t>::max()/(1024*1024);
+  if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos){
+    cout << option << " " << value << " should be a non-negative number of megabytes" << endl;
+    return false;
+  }
+  try{
+    const unsigned long long mb = std::stoull(value);
+    if (mb > max_mb){
+      cout << option << " " << value << " megabytes is too large" << endl;
+      return false;
+    }
+    bytes = static_cast<size_t>(mb)*1024*1024;
+  }
+  catch (const std::exception& e){
+    cout << option << " " << value << " megabytes is too large" << endl;
+    return false;
+  }
+  return true;
+}
+
 ///\brief Read xml or HDF5 file and create VTK/VTPC files for ParaView
 ///\sa Usage()
 int main(int argc,char* argv[])
@@ -63,6 +128,48 @@ int main(int argc,char* argv[])
     cout << "Using " << lignumvtk::TUBE_NUMBER_OF_SIDES << " rectangular tube sides" << endl;
   }
 
+  std::string reader;
+  if (ParseCommandLine(argc,argv,"-reader",reader)){
+    if (!lignumvtk::ParseTreeReader(reader,lignumvtk::XML_TREE_READER)){
+      return EXIT_FAILURE;
+    }
+    cout << "Using " << reader << " tree reader" << endl;
+  }
+
+  std::string prefetch;
+  if (ParseCommandLine(argc,argv,"-prefetch",prefetch)){
+    int ntrees = -1;
+    try{
+      ntrees = std::stoi(prefetch);
+    }
+    catch (const std::exception& e){
+      ntrees = -1;
+    }
+    if (ntrees < 0){
+      cout << "Prefetch " << prefetch << " should be a non-negative number of trees, exiting" << endl;
+      return EXIT_FAILURE;
+    }
+    lignumvtk::HDF5_PREFETCH_TREES = ntrees;
+    cout << "Reading " << lignumvtk::HDF5_PREFETCH_TREES << " HDF5 trees ahead" << endl;
+  }
+  std::string chunk_cache;
+  if (ParseCommandLine(argc,argv,"-chunk-cache",chunk_cache)){
+    if (!ParseCacheSize("-chunk-cache",chunk_cache,lignumvtk::HDF5_ACCESS_OPTIONS.chunk_cache_bytes)){
+      return EXIT_FAILURE;
+    }
+    cout << "HDF5 chunk cache " << chunk_cache << " MB" << endl;
+  }
+  std::string meta_cache;
+  if (ParseCommandLine(argc,argv,"-meta-cache",meta_cache)){
+    if (!ParseCacheSize("-meta-cache",meta_cache,lignumvtk::HDF5_ACCESS_OPTIONS.meta_cache_bytes)){
+      return EXIT_FAILURE;
+    }
+    cout << "HDF5 metadata cache " << meta_cache << " MB" << endl;
+  }
+  if (CheckCommandLine(argc,argv,"-core")){
+    lignumvtk::HDF5_ACCESS_OPTIONS.core = true;
+  }
+
   bool list_content = false;
   if (CheckCommandLine(argc,argv,"-list")){
     list_content = true;
@@ -70,8 +177,13 @@ int main(int argc,char* argv[])
   std::string input_file;
   bool is_hdf5 = true;
   bool is_xml = true;
+  bool is_snapshot = true;
   if (ParseCommandLine(argc,argv,"-input",input_file)||ParseCommandLine(argc,argv,"-i",input_file)){
      std::string::size_type n;
+     n = input_file.find(lignumvtk::SNAPSHOT_EXTENSION);
+     if (n == std::string::npos){
+       is_snapshot = false;
+     }
      n = input_file.find(".h5");
      if (n == std::string::npos){
        is_hdf5 = false;
@@ -80,8 +192,8 @@ int main(int argc,char* argv[])
      if (n == std::string::npos){
        is_xml = false;
      }
-     if (!(is_xml || is_hdf5)){
-       cout << "Input file " << input_file << " should have suffix .xml or .h5, exiting" <<endl;
+     if (!(is_xml || is_hdf5 || is_snapshot)){
+       cout << "Input file " << input_file << " should have suffix .xml, .h5 or " << lignumvtk::SNAPSHOT_EXTENSION << ", exiting" <<endl;
        return EXIT_FAILURE;
      }
   }
@@ -101,6 +213,46 @@ int main(int argc,char* argv[])
     growth_year = std::stoi(year);
     use_year=true;
   }
+  std::string years;
+  vector<int> growth_years;
+  bool use_years = false;
+  if (ParseCommandLine(argc,argv,"-years",years)){
+    growth_years = lignumvtk::ParseYearRange(years);
+    if (growth_years.size() == 0){
+      return EXIT_FAILURE;
+    }
+    use_years = true;
+  }
+  std::string follow;
+  int poll_seconds = 0;
+  bool use_follow = false;
+  if (ParseCommandLine(argc,argv,"-follow",follow)){
+    try{
+      poll_seconds = std::stoi(follow);
+    }
+    catch (const std::exception& e){
+      poll_seconds = 0;
+    }
+    if (poll_seconds <= 0){
+      cout << "Poll interval " << follow << " should be positive seconds, exiting" <<endl;
+      return EXIT_FAILURE;
+    }
+    use_follow = true;
+  }
+  std::string idle;
+  int idle_seconds = 0;
+  if (ParseCommandLine(argc,argv,"-idle",idle)){
+    try{
+      idle_seconds = std::stoi(idle);
+    }
+    catch (const std::exception& e){
+      idle_seconds = -1;
+    }
+    if (idle_seconds < 0){
+      cout << "Idle time " << idle << " should be non-negative seconds, exiting" <<endl;
+      return EXIT_FAILURE;
+    }
+  }
   std::string dataset;
   bool use_dataset = false;
   if (ParseCommandLine(argc,argv,"-dataset",dataset)){
@@ -112,12 +264,59 @@ int main(int argc,char* argv[])
     use_substring = true;
   }
 
+  std::string cache_dir;
+  if (ParseCommandLine(argc,argv,"-cache",cache_dir)){
+    cout << "Using tree cache " << cache_dir << endl;
+  }
+
+  std::string snapshot_file;
+  if (ParseCommandLine(argc,argv,"-snapshot",snapshot_file)){
+    //Snapshot file holds the trees of one year only
+    if (use_years || use_follow){
+      cout << "Snapshot file is for a single year, -snapshot cannot be used with -years or -follow, exiting" <<endl;
+      return EXIT_FAILURE;
+    }
+    cout << "Writing snapshot file " << snapshot_file << endl;
+  }
+
+  std::string sweep;
+  lignumvtk::SweepParameters sweep_parameters;
+  bool use_sweep = false;
+  if (ParseCommandLine(argc,argv,"-sweep",sweep)){
+    //Sweep creates files for one set of trees
+    if (use_years || use_follow){
+      cout << "Parameter sweep is for a single year, -sweep cannot be used with -years or -follow, exiting" <<endl;
+      return EXIT_FAILURE;
+    }
+    if (!lignumvtk::ParseSweep(sweep,sweep_parameters,spline_resolution)){
+      return EXIT_FAILURE;
+    }
+    use_sweep = true;
+  }
+
   std::string view;
   int dataset_view = 0;
   if (ParseCommandLine(argc,argv,"-view",view)){
     dataset_view = std::stoi(view);
   }
   //Command line parsed, do the following:
+  //Save the tree dataset index next to the HDF5 file
+  if (CheckCommandLine(argc,argv,"-index")){
+    if (is_hdf5 == false){
+      cout << "The HDF5 input file " << input_file << ": to index datasets the input file should have the suffix \".h5\"" <<endl;
+      return EXIT_FAILURE;
+    }
+    lignumvtk::HDF5ToLignum hdf5lignum;
+    hdf5lignum.openFile(input_file);
+    if (!hdf5lignum.saveTreeIndex()){
+      return EXIT_FAILURE;
+    }
+    cout << "Index file " << lignumvtk::HDF5TreeIndex::indexFileName(input_file) << " with "
+	 << hdf5lignum.getTreeIndex().size() << " trees" << endl;
+    if (!list_content && !output_found && snapshot_file.empty()){
+      return EXIT_SUCCESS;
+    }
+  }
   //Case 1: List the content of the HDF5 tree files  
   if (list_content == true){
     if (is_hdf5 == false){
@@ -125,48 +324,82 @@ int main(int argc,char* argv[])
       return EXIT_FAILURE;
     }
     lignumvtk::HDF5ToLignum hdf5lignum;
-    vector<string> v;
     hdf5lignum.openFile(input_file);
-    if (use_year == true){
-      v = hdf5lignum.getDataSetNames(growth_year);
+    return lignumvtk::ListTreeDataSets(hdf5lignum,growth_year,dataset,substring,spline_resolution,
+				       lignumvtk::TUBE_NUMBER_OF_SIDES);
+  }
+  //At this point check the output file exists, snapshot file alone is also output
+  int retval=0;
+  if (!output_found && (snapshot_file.empty() || use_years || use_follow)){
+    cout << "No output file, exiting" <<endl;
+    return EXIT_FAILURE;
+  }
+  //Case 2: Parameter sweep, trees are read and collected once
+  if (use_sweep){
+    if (!output_found){
+      cout << "No output file for parameter sweep, exiting" <<endl;
+      return EXIT_FAILURE;
     }
-    else if (use_dataset == true){
-      vector<string> all_trees_v = hdf5lignum.getDataSetNames(hdf5lignum.getMainGroupName());
-      std::copy_if(all_trees_v.begin(),all_trees_v.end(), std::back_inserter(v),lignumvtk::FindExactMatch(dataset));
+    lignumvtk::CollectedStand stand;
+    if (is_snapshot){
+      if (!lignumvtk::ReadSnapshot(input_file,stand)){
+	return EXIT_FAILURE;
+      }
     }
-    else if (use_substring == true){
-      vector<string> all_trees_v = hdf5lignum.getDataSetNames(hdf5lignum.getMainGroupName());
-      std::copy_if(all_trees_v.begin(),all_trees_v.end(), std::back_inserter(v),lignumvtk::FindSubString(substring));
+    else if (is_xml){
+      if (lignumvtk::CollectStandFromXML(input_file,stand) == EXIT_FAILURE){
+	return EXIT_FAILURE;
+      }
     }
     else{
-      string tree_group=hdf5lignum.getMainGroupName();
-      v = hdf5lignum.getDataSetNames(tree_group);
+      lignumvtk::HDF5ToLignum hdf5lignum;
+      hdf5lignum.openFile(input_file);
+      vector<string> v = lignumvtk::SelectTreeDataSets(hdf5lignum,growth_year,dataset,substring);
+      if (lignumvtk::CollectStandFromHDF5(hdf5lignum,v,stand) == EXIT_FAILURE){
+	return EXIT_FAILURE;
+      }
     }
-    std::copy(v.begin(),v.end(),std::ostream_iterator<string>(std::cout, "\n"));
-    cout << "Total of " << v.size() << " trees" <<endl;
-    return EXIT_SUCCESS;
+    retval = lignumvtk::CreateVTPCFileSweep(stand,output_file,sweep_parameters,dataset_view);
   }
-  //At this point check the output file exists
-  int retval=0;
-  if (!output_found){
-    cout << "No output file, exiting" <<endl;
-    return EXIT_FAILURE;
+  //Case 3: The input file is a snapshot file
+  else if (is_snapshot){
+    if (!output_found){
+      cout << "No output file for snapshot input, exiting" <<endl;
+      return EXIT_FAILURE;
+    }
+    retval = lignumvtk::CreateVTPCFileFromSnapshot(input_file,output_file,spline_resolution,dataset_view);
+  }
+  //Case 4: The input file is a single xml file
+  else if (is_xml){
+    retval = lignumvtk::CreateVTPCFileFromXML(input_file,output_file,spline_resolution,dataset_view,snapshot_file);
+  }
+  //Case 5: Follow HDF5 file written by a running simulation
+  else if (use_follow == true){
+    if (is_hdf5 == false){
+      cout << "The input file " << input_file << ": to follow the input file should have the suffix \".h5\"" <<endl;
+      return EXIT_FAILURE;
+    }
+    retval = lignumvtk::CreatePVDFileFollowHDF5(input_file,output_file,poll_seconds,idle_seconds,spline_resolution,dataset_view,
+						cache_dir);
   }
-  //Case 2: The input file is a single xml file
-  if (is_xml){
-    retval = lignumvtk::CreateVTPCFileFromXML(input_file,output_file,spline_resolution,dataset_view);
+  //Case 6: The HDF5 datasets from a range of years are used
+  else if (use_years == true){
+    retval = lignumvtk::CreatePVDFileFromHDF5(input_file,output_file,growth_years,spline_resolution,dataset_view,cache_dir);
   }
-  //Case 3: The HDF5 datasets from a given year are used
+  //Case 7: The HDF5 datasets from a given year are used
   else if (use_year == true){
-    retval = lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,growth_year,spline_resolution,dataset_view);
+    retval = lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,growth_year,spline_resolution,dataset_view,cache_dir,
+					       snapshot_file);
   }
-  //Case 4: The HDF5 Dataset name or path is used
+  //Case 8: The HDF5 Dataset name or path is used
   else if (use_dataset == true){
-    retval = lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,dataset,true,spline_resolution,dataset_view);
+    retval = lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,dataset,true,spline_resolution,dataset_view,cache_dir,
+					       snapshot_file);
   }
-  //Case 5: The search substring is used to pick HDF5 datasets
+  //Case 9: The search substring is used to pick HDF5 datasets
   else if (use_substring ==true){
-    retval =  lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,substring,false,spline_resolution,dataset_view);
+    retval =  lignumvtk::CreateVTPCFileFromHDF5(input_file,output_file,substring,false,spline_resolution,dataset_view,cache_dir,
+						snapshot_file);
   }
   else{
     cout << "Define input XML file or define year or dataset name for HDF5 file" << endl;
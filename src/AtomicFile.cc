@@ -0,0 +1,28 @@
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <AtomicFile.h>
+
+namespace lignumvtk{
+
+  std::string TemporaryFileName(const std::string& file_name)
+  {
+    const std::filesystem::path path(file_name);
+    return (path.parent_path()/("tmp_"+path.filename().string())).string();
+  }
+
+  bool WriteFileAtomically(const std::string& file_name,const std::function<bool(const std::string&)>& write)
+  {
+    const std::string tmp_file = TemporaryFileName(file_name);
+    if (!write(tmp_file)){
+      std::remove(tmp_file.c_str());
+      return false;
+    }
+    if (std::rename(tmp_file.c_str(),file_name.c_str()) != 0){
+      std::cout << "Cannot rename " << tmp_file << " to " << file_name << std::endl;
+      std::remove(tmp_file.c_str());
+      return false;
+    }
+    return true;
+  }
+}
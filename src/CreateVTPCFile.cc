@@ -1,18 +1,51 @@
+#include <filesystem>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
 #include <CreateVTPCFile.h>
 
 namespace lignumvtk{
 
-  int CreateVTPCFileFromXML(const string& input_file,const string& output_file, int spline_resolution, int view)
+  bool CollectTreeFromXML(const string& input,bool is_file,const string& tree_type,const string& tree_id,CollectedTree& ct)
+  {
+    if (XML_TREE_READER == TREE_READER::DIRECT){
+      XMLDirectTreeReader direct_reader;
+      return is_file ? direct_reader.readXMLToCollectedTree(input,tree_id,ct) :
+	direct_reader.readXMLStringToCollectedTree(input,tree_id,ct);
+    }
+    if (tree_type == "Hw"){
+      Tree<VTKHwSegment,VTKBud> lignum_hwt(Point(0,0,0), PositionVector(0,0,1.0));
+      if (is_file){
+	ReadXMLToTree<VTKHwSegment,VTKBud,Kite>(lignum_hwt,input);
+      }
+      else{
+	ReadXMLStringToTree<VTKHwSegment,VTKBud,Kite>(lignum_hwt,input);
+      }
+      CollectBroadLeafTree(lignum_hwt,tree_id,ct);
+      return true;
+    }
+    Tree<VTKCfSegment,VTKCfBud> lignum_cft;
+    if (is_file){
+      ReadXMLToTree(lignum_cft,input);
+    }
+    else{
+      ReadXMLStringToTree(lignum_cft,input);
+    }
+    CollectConiferTree(lignum_cft,tree_id,ct);
+    return true;
+  }
+
+  int CollectStandFromXML(const string& input_file,CollectedStand& stand)
   {
-    XMLDomTreeReader<VTKHwSegment,VTKBud,Kite> tree_hwreader;
-    XMLDomTreeReader<VTKCfSegment,VTKCfBud> tree_cfreader;
     LignumVTKXML vtk_xml;
-    CfLignumToVTK cflignumvtk(spline_resolution);
-    HwLignumToVTK hwlignumvtk(spline_resolution);
-    Tree<VTKHwSegment,VTKBud> lignum_hwtree(Point(0,0,0), PositionVector(0,0,1.0));
-    Tree<VTKCfSegment,VTKCfBud> lignum_cftree;
+    CollectedTree ct;
 
-    //Peek the XML fiel and check for tree type and leaf type
+    //Peek the XML file and check for tree type and leaf type,
+    //only the root element and the first leaf are scanned
     vtk_xml.setFileName(input_file);
     vtk_xml.parse();
     const string tree_type = vtk_xml.treeType();
@@ -20,11 +53,10 @@ namespace lignumvtk{
     if (tree_type == "Cf"){
       cout << "Coniferous tree" <<endl;
       cout << "Reading tree: " <<  input_file <<endl;
-      tree_cfreader.readXMLToTree(lignum_cftree, input_file);
-      cout << "Create conifer VTK data sets" <<endl;
-      cflignumvtk.createConiferTreeVTKDataSets(lignum_cftree,LIGNUM_CONIFER_ID,false);
-      cout << "Write file" <<endl;
-      cflignumvtk.writePartitionedDataSetCollection(output_file,view);
+      if (!CollectTreeFromXML(input_file,true,tree_type,LIGNUM_CONIFER_ID,ct)){
+	return EXIT_FAILURE;
+      }
+      stand.push_back(std::move(ct));
       return EXIT_SUCCESS;
     }
     //Check for leaf  type
@@ -34,93 +66,701 @@ namespace lignumvtk{
     }
     cout << "Broadleaved tree" <<endl;
     cout << "Reading tree: " <<  input_file <<endl;
-    tree_hwreader.readXMLToTree(lignum_hwtree, input_file);
-    cout << "Create broadleaved VTK data sets" <<endl;
-    hwlignumvtk.createBroadLeafTreeVTKDataSets(lignum_hwtree,LIGNUM_BROADLEAF_ID,false);
-    cout << "Write file" <<endl;
-    hwlignumvtk.writePartitionedDataSetCollection(output_file,view);
+    if (!CollectTreeFromXML(input_file,true,tree_type,LIGNUM_BROADLEAF_ID,ct)){
+      return EXIT_FAILURE;
+    }
+    stand.push_back(std::move(ct));
     return EXIT_SUCCESS;
   }
 
-  int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file, int year, int spline_resolution,int view)
+  ///\brief Tree type of a Lignum XML string read from HDF5 file
+  ///
+  ///Only the root element and the first leaf are scanned with LignumVTKXML.
+  ///\param lignum_string Lignum XML
+  ///\param dataset HDF5 dataset path for messages
+  ///\return "Cf" or "Hw", empty string if there is no tree type or the leaf type is not supported
+  static string TreeTypeOfString(const string& lignum_string,const string& dataset)
   {
     LignumVTKXML vtk_xml;
-    CfLignumToVTK cflignumvtk(spline_resolution);
-    HDF5ToLignum hdf5lignum;
-    hdf5lignum.openFile(input_file);
-    vector<string> v = hdf5lignum.getDataSetNames(year);
+    vtk_xml.parse(lignum_string);
+    const string type = vtk_xml.treeType();
+    if (type.empty()){
+      cout << "No SegmentType in the root element of " << dataset <<endl;
+      return type;
+    }
+    //Broadleaved tree without leaves has no leaf type
+    if (type == "Hw" && !vtk_xml.leafType().empty() && vtk_xml.leafType() != "Kite"){
+      cout << "Leaf type " << vtk_xml.leafType() << " in " << dataset << " not yet supported" <<endl;
+      return string("");
+    }
+    return type;
+  }
+
+  bool CollectTreeFromHDF5(HDF5ToLignum& hdf5lignum,const string& tree_path,CollectedTree& ct)
+  {
+    //Columns feed the tree data directly without parsing
+    if (hdf5lignum.hasTreeColumns()){
+      return hdf5lignum.getCollectedTree(tree_path,ct);
+    }
+    const std::string lignum_string =  hdf5lignum.getLignumTreeString(tree_path);
+    //The stand can be mixed, tree type for each tree
+    const string type = TreeTypeOfString(lignum_string,tree_path);
+    if (type.empty()){
+      return false;
+    }
+    return CollectTreeFromXML(lignum_string,false,type,tree_path,ct);
+  }
+
+  ///\brief Collect tree data from a tree read by HDF5TreePrefetcher
+  ///\param tree Tree read from HDF5 file, the columnar tree data is moved to \p ct
+  ///\param[out] ct Collected tree data
+  ///\return true if the tree is collected, false otherwise
+  static bool CollectPrefetchedTree(PrefetchedTree& tree,CollectedTree& ct)
+  {
+    if (!tree.ok){
+      return false;
+    }
+    if (!tree.lignum_string.empty()){
+      const string type = TreeTypeOfString(tree.lignum_string,tree.path);
+      if (type.empty()){
+	return false;
+      }
+      return CollectTreeFromXML(tree.lignum_string,false,type,tree.path,ct);
+    }
+    ct = std::move(tree.ct);
+    return true;
+  }
+
+  int CollectStandFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& v,CollectedStand& stand)
+  {
     if (v.size() == 0){
-      cout << "No HDF5 datasets for trees for year " << year << endl;
+      cout << "No HDF5 datasets for trees" << endl;
       return EXIT_FAILURE;
     }
-    std::string lignum_string =  hdf5lignum.getLignumTreeString(v[0]);
-    QDomDocument qdoc("LMODEL");
-    QString qt_xmlstring(lignum_string.c_str());
-    if(!qdoc.setContent(qt_xmlstring)) {
-      cout << "CreateVTPCFileFromHDF5 XMLDomTreeReader::readXMLStringToTree: Cannot set XML Dom content" <<endl;
+    stand.reserve(stand.size()+v.size());
+    HDF5TreePrefetcher prefetcher(hdf5lignum,v,HDF5_PREFETCH_TREES);
+    PrefetchedTree tree;
+    for (unsigned int i=0; prefetcher.next(tree); i++){
+      cout << "Tree " << i << ": " << tree.path << endl;
+      CollectedTree ct;
+      if (!CollectPrefetchedTree(tree,ct)){
+	return EXIT_FAILURE;
+      }
+      stand.push_back(std::move(ct));
+    }
+    return EXIT_SUCCESS;
+  }
+
+  vector<string> SelectTreeDataSets(HDF5ToLignum& hdf5lignum,int year,const string& dataset,const string& substring)
+  {
+    return hdf5lignum.getTreeIndex().select(year,dataset,substring);
+  }
+
+  double EstimateVTPCFileSize(hsize_t segment_rows,hsize_t axes,hsize_t leaves,int spline_resolution,int nsides)
+  {
+    const double spline_points = static_cast<double>(spline_resolution)*segment_rows+axes;
+    const int tubes = (leaves > 0) ? 1 : 3;
+    const double points = tubes*spline_points*nsides + 6.0*leaves;
+    return points*VTP_POINT_BYTES;
+  }
+
+  ///\brief Number of rows in a dataset of a tree in the columnar layout
+  ///\param hdf5lignum Lignum HDF5 file reader
+  ///\param tree_path Tree group path
+  ///\param name Dataset name in the tree group
+  ///\return Number of rows, 0 if the dataset cannot be read
+  static hsize_t TreeColumnsRows(HDF5ToLignum& hdf5lignum,const string& tree_path,const string& name)
+  {
+    const DataSetInfo info = hdf5lignum.getDataSetInfo(tree_path+"/"+name);
+    return info.dims.empty() ? 0 : info.dims[0];
+  }
+
+  int ListTreeDataSets(HDF5ToLignum& hdf5lignum,int year,const string& dataset,const string& substring,
+		       int spline_resolution,int nsides)
+  {
+    const HDF5TreeIndex& index = hdf5lignum.getTreeIndex();
+    const bool columns = hdf5lignum.hasTreeColumns();
+    std::size_t ntrees = 0;
+    int nyears = 0;
+    double total_size = 0.0;
+    double total_vtpc = 0.0;
+    for (int y : index.getYears()){
+      if (year >= 0 && y != year){
+	continue;
+      }
+      std::size_t year_trees = 0;
+      double year_size = 0.0;
+      double year_vtpc = 0.0;
+      for (const string& path : index.getYear(y)){
+	if ((!dataset.empty() && !FindExactMatch(dataset)(path)) || (!substring.empty() && !FindSubString(substring)(path))){
+	  continue;
+	}
+	const hsize_t storage_size = hdf5lignum.getTreeStorageSize(path);
+	cout << path << " " << ByteSizeString(storage_size);
+	if (columns){
+	  const double vtpc_size = EstimateVTPCFileSize(TreeColumnsRows(hdf5lignum,path,TREE_COLUMNS_SEGMENTS),
+							TreeColumnsRows(hdf5lignum,path,TREE_COLUMNS_AXES),
+							TreeColumnsRows(hdf5lignum,path,TREE_COLUMNS_LEAVES),
+							spline_resolution,nsides);
+	  cout << " " << ByteSizeString(vtpc_size) << " estimated VTK/VTPC";
+	  year_vtpc += vtpc_size;
+	}
+	cout << endl;
+	year_trees++;
+	year_size += storage_size;
+      }
+      if (year_trees > 0){
+	cout << "Year " << y << ": " << year_trees << " trees, " << ByteSizeString(year_size);
+	if (columns){
+	  cout << ", " << ByteSizeString(year_vtpc) << " estimated VTK/VTPC";
+	}
+	cout << endl;
+	ntrees += year_trees;
+	total_size += year_size;
+	total_vtpc += year_vtpc;
+	nyears++;
+      }
+    }
+    cout << "Total of " << ntrees << " trees in " << nyears << " years, " << ByteSizeString(total_size)
+	 << (columns ? " columns" : " XML");
+    if (columns){
+      cout << ", " << ByteSizeString(total_vtpc) << " estimated VTK/VTPC";
+    }
+    cout << endl;
+    return EXIT_SUCCESS;
+  }
+
+  int CreateVTPCFileFromStand(CollectedStand& stand,const string& output_file,int spline_resolution,int view,int nsides)
+  {
+    if (stand.size() == 0){
+      cout << "No trees for VTK/VTPC file" <<endl;
       return EXIT_FAILURE;
     }
-    QString type = qdoc.firstChild().toElement().attribute("SegmentType");
-    if (type == "Hw"){
-      cout << "CreateVTPCFileFromHDF5  broadleaved trees are not yet supported" <<endl;
+    //Conifers and broadleaved trees in the same collection, mixed stands have subtrees for both
+    StandLignumToVTK standlignumvtk(spline_resolution,nsides);
+    cout << "Create VTK data sets" <<endl;
+    for (CollectedTree& ct : stand){
+      standlignumvtk.createTreeVTKDataSets(ct,false);
+    }
+    cout << "Write file" <<endl;
+    standlignumvtk.writePartitionedDataSetCollection(output_file,view);
+    return EXIT_SUCCESS;
+  }
+
+  int CreateVTPCFileFromXML(const string& input_file,const string& output_file, int spline_resolution, int view,
+			    const string& snapshot_file)
+  {
+    CollectedStand stand;
+    if (CollectStandFromXML(input_file,stand) == EXIT_FAILURE){
       return EXIT_FAILURE;
     }
-    for (unsigned int i=0; i < v.size(); i++){
-      cout << "Tree: " << i <<endl;
-      XMLDomTreeReader<VTKCfSegment,VTKCfBud> tree_string_reader;
-      Tree<VTKCfSegment,VTKCfBud> lignum_cft;
-      std::string lignum_string =  hdf5lignum.getLignumTreeString(v[i]);
-      tree_string_reader.readXMLStringToTree(lignum_cft,lignum_string);
-      cflignumvtk.createConiferTreeVTKDataSets(lignum_cft,v[i],false);
+    if (!snapshot_file.empty()){
+      TSDataSnapshotWriter snapshot;
+      if (!snapshot.open(snapshot_file) || !snapshot.addTree(stand[0]).close()){
+	cout << "Cannot write snapshot file " << snapshot_file <<endl;
+	return EXIT_FAILURE;
+      }
+      cout << "Snapshot file: " << snapshot_file <<endl;
+    }
+    if (output_file.empty()){
+      return EXIT_SUCCESS;
+    }
+    return CreateVTPCFileFromStand(stand,output_file,spline_resolution,view);
+  }
+
+  int CreateVTPCFileFromSnapshot(const string& snapshot_file,const string& output_file,int spline_resolution,int view)
+  {
+    CollectedStand stand;
+    if (!ReadSnapshot(snapshot_file,stand)){
+      cout << "Cannot read snapshot file " << snapshot_file <<endl;
+      return EXIT_FAILURE;
+    }
+    cout << "Snapshot file: " << snapshot_file << " with " << stand.size() << " trees" <<endl;
+    return CreateVTPCFileFromStand(stand,output_file,spline_resolution,view);
+  }
+
+  int CreateVTPCFileFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& v,const string& output_file,
+			     int spline_resolution,int view,TreeCache* cache,TSDataSnapshotWriter* snapshot)
+  {
+    if (v.size() == 0){
+      cout << "No HDF5 datasets for trees" << endl;
+      return EXIT_FAILURE;
+    }
+    StandLignumToVTK standlignumvtk(spline_resolution);
+    //Only the snapshot is written if there is no VTK/VTPC file
+    const bool create_vtk = !output_file.empty();
+    //The next trees are read while this tree is parsed and its VTK datasets created
+    HDF5TreePrefetcher prefetcher(hdf5lignum,v,HDF5_PREFETCH_TREES);
+    PrefetchedTree tree;
+    for (unsigned int i=0; prefetcher.next(tree); i++){
+      cout << "Tree " << i << ": " << tree.path << endl;
+      std::string cache_key;
+      TreeBlocks cached_blocks;
+      bool cached = false;
+      CollectedTree ct;
+      if (!tree.ok){
+	return EXIT_FAILURE;
+      }
+      //Columns feed the tree data directly, only XML trees are parsed and cached
+      if (hdf5lignum.hasTreeColumns()){
+	ct = std::move(tree.ct);
+      }
+      else{
+	const std::string& lignum_string = tree.lignum_string;
+	//Tree type for each tree, the stand can be mixed
+	const string type = TreeTypeOfString(lignum_string,tree.path);
+	if (type.empty()){
+	  return EXIT_FAILURE;
+	}
+	if (cache != nullptr && create_vtk){
+	  //Unchanged tree with the same geometry options is in the cache
+	  cache_key = cache->key(lignum_string,spline_resolution,TUBE_NUMBER_OF_SIDES,static_cast<int>(XML_TREE_READER));
+	  cached = cache->load(cache_key,cached_blocks);
+	}
+	if (cached){
+	  standlignumvtk.addTreeVTKDataSets(type,cached_blocks[0].second,cached_blocks[1].second,cached_blocks[2].second,tree.path);
+	  //Snapshot needs the collected data, the tree is still read 
+	  if (snapshot == nullptr){
+	    continue;
+	  }
+	}
+	if (!CollectTreeFromXML(lignum_string,false,type,tree.path,ct)){
+	  return EXIT_FAILURE;
+	}
+      }
+      if (snapshot != nullptr){
+	snapshot->addTree(ct);
+      }
+      if (cached || !create_vtk){
+	continue;
+      }
+      standlignumvtk.createTreeVTKDataSets(ct,false);
+      if (!cache_key.empty()){
+	//The last three datasets are foliage, heartwood and segments (Cf) or leaves, petioles and segments (Hw) of this tree
+	TreeBlocks blocks;
+	int n = standlignumvtk.getNumberOfPartitionedDataSets();
+	for (int b = n-3; b < n; b++){
+	  PolyDataVector pv;
+	  blocks.push_back(std::make_pair(standlignumvtk.getPartitionedDataSetName(b),standlignumvtk.getPartitionedDataSet(b,pv)));
+	}
+	cache->store(cache_key,blocks);
+      }
+    }
+    if (cache != nullptr && create_vtk){
+      cout << "Tree cache: " << cache->getHits() << " trees reused, " << cache->getMisses() << " trees created" << endl;
+    }
+    if (!create_vtk){
+      return EXIT_SUCCESS;
     }
     cout << "Write file" <<endl;
-    cflignumvtk.writePartitionedDataSetCollection(output_file,view);    
+    standlignumvtk.writePartitionedDataSetCollection(output_file,view);
     return EXIT_SUCCESS;
   }
 
+  int CreateVTPCFileFromHDF5(HDF5ToLignum& hdf5lignum,const vector<string>& v,const string& output_file,
+			     int spline_resolution,int view,const string& cache_dir,const string& snapshot_file)
+  {
+    std::unique_ptr<TreeCache> cache;
+    if (!cache_dir.empty()){
+      cache = std::make_unique<TreeCache>(cache_dir);
+    }
+    if (snapshot_file.empty()){
+      return CreateVTPCFileFromHDF5(hdf5lignum,v,output_file,spline_resolution,view,cache.get());
+    }
+    TSDataSnapshotWriter snapshot;
+    if (!snapshot.open(snapshot_file)){
+      return EXIT_FAILURE;
+    }
+    int status = CreateVTPCFileFromHDF5(hdf5lignum,v,output_file,spline_resolution,view,cache.get(),&snapshot);
+    if (!snapshot.close()){
+      cout << "Cannot write snapshot file " << snapshot_file <<endl;
+      return EXIT_FAILURE;
+    }
+    cout << "Snapshot file: " << snapshot_file << " with " << snapshot.getNumberOfTrees() << " trees" <<endl;
+    return status;
+  }
+  
+  int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file, int year, int spline_resolution,int view,
+			     const string& cache_dir,const string& snapshot_file)
+  {
+    HDF5ToLignum hdf5lignum;
+    hdf5lignum.openFile(input_file);
+    vector<string> v = hdf5lignum.getTreeIndex().getYear(year);
+    if (v.size() == 0){
+      cout << "No HDF5 datasets for trees for year " << year << endl;
+      return EXIT_FAILURE;
+    }
+    return CreateVTPCFileFromHDF5(hdf5lignum,v,output_file,spline_resolution,view,cache_dir,snapshot_file);
+  }
+
   int CreateVTPCFileFromHDF5(const string& input_file,const string& output_file, const string& dataset_path, bool exact_match,
-			     int spline_resolution,int view)
+			     int spline_resolution,int view,const string& cache_dir,const string& snapshot_file)
   {
-    LignumVTKXML vtk_xml;
-    CfLignumToVTK cflignumvtk(spline_resolution);
     HDF5ToLignum hdf5lignum;
     hdf5lignum.openFile(input_file);
-    string tree_group=hdf5lignum.getMainGroupName();
-    vector<string> v = hdf5lignum.getDataSetNames(tree_group);
     vector<string> valid_paths;
     if (exact_match == true){
-      std::copy_if(v.begin(),v.end(), std::back_inserter(valid_paths),FindExactMatch(dataset_path));
+      valid_paths = hdf5lignum.getTreeIndex().select(-1,dataset_path,"");
     }
     else{
-      std::copy_if(v.begin(),v.end(), std::back_inserter(valid_paths),FindSubString(dataset_path));
+      valid_paths = hdf5lignum.getTreeIndex().select(-1,"",dataset_path);
     }
     if (valid_paths.size() == 0){
       cout << "No HDF5 datasets for trees for path: " << dataset_path << endl;
       return EXIT_FAILURE;
     }
-    //Test for broadleaved trees
-    std::string lignum_string =  hdf5lignum.getLignumTreeString(valid_paths[0]);
-    QDomDocument qdoc("LMODEL");
-    QString qt_xmlstring(lignum_string.c_str());
-    if(!qdoc.setContent(qt_xmlstring)) {
-      cout << "CreateVTPCFileFromHDF5 XMLDomTreeReader::readXMLStringToTree: Cannot set XML Dom content" <<endl;
+    return CreateVTPCFileFromHDF5(hdf5lignum,valid_paths,output_file,spline_resolution,view,cache_dir,snapshot_file);
+  }
+
+  int CreatePVDFileFollowHDF5(const string& input_file,const string& output_file,int poll_seconds,int idle_seconds,
+			      int spline_resolution,int view,const string& cache_dir)
+  {
+    std::unique_ptr<TreeCache> cache;
+    if (!cache_dir.empty()){
+      cache = std::make_unique<TreeCache>(cache_dir);
+    }
+    //Restored at the end, the options are global
+    const HDF5AccessOptions saved_options = HDF5_ACCESS_OPTIONS;
+    HDF5_ACCESS_OPTIONS.swmr = true;
+    if (HDF5_ACCESS_OPTIONS.core){
+      //The file image in memory would not change
+      cout << "Following " << input_file << ", the file is not read into memory" << endl;
+      HDF5_ACCESS_OPTIONS.core = false;
+    }
+    PVDFile pvd;
+    std::set<int> converted;
+    //Failed attempts for years that are not the newest
+    std::map<int,int> failed;
+    bool pvd_written = true;
+    std::uintmax_t previous_size = 0;
+    std::int64_t previous_mtime = 0;
+    auto last_change = std::chrono::steady_clock::now();
+    cout << "Following " << input_file << " every " << poll_seconds << " seconds" << endl;
+    while (true){
+      std::uintmax_t size = 0;
+      std::int64_t mtime = 0;
+      const bool file_found = FileStamp(input_file,size,mtime);
+      //No writes since the previous poll, the last year is complete too
+      const bool unchanged = file_found && size == previous_size && mtime == previous_mtime;
+      if (file_found && !unchanged){
+	previous_size = size;
+	previous_mtime = mtime;
+	last_change = std::chrono::steady_clock::now();
+      }
+      if (file_found){
+	try{
+	  Exception::dontPrint();
+	  HDF5ToLignum hdf5lignum;
+	  hdf5lignum.openFile(input_file);
+	  const HDF5TreeIndex& index = hdf5lignum.getTreeIndex();
+	  const vector<int> years = index.getYears();
+	  for (int year : years){
+	    //The last year may still be written
+	    if (converted.count(year) > 0 || (year == years.back() && !unchanged)){
+	      continue;
+	    }
+	    const string year_file = YearVTPCFileName(output_file,year);
+	    int status = EXIT_FAILURE;
+	    try{
+	      vector<string> v = index.getYear(year);
+	      cout << "Year " << year << ": " << v.size() << " trees" << endl;
+	      status = CreateVTPCFileFromHDF5(hdf5lignum,v,year_file,spline_resolution,view,cache.get());
+	    }
+	    catch (H5::Exception e){
+	      cout << "Cannot read year " << year << ": " << e.getDetailMsg() << endl;
+	    }
+	    if (status == EXIT_FAILURE){
+	      //Older years are complete, skip a year that fails repeatedly
+	      if (year != years.back() && ++failed[year] >= FOLLOW_YEAR_RETRIES){
+		cout << "Year " << year << " failed " << failed[year] << " times, skipping it" << endl;
+		converted.insert(year);
+		continue;
+	      }
+	      //Keep the years in order, try again in the next poll
+	      cout << "Year " << year << " not complete, trying again" << endl;
+	      break;
+	    }
+	    converted.insert(year);
+	    pvd.addDataSet(year,std::filesystem::path(year_file).filename().string());
+	    //The next year writes the whole collection again
+	    pvd_written = pvd.write(output_file);
+	    if (!pvd_written){
+	      cout << "Cannot write PVD collection file " << output_file << ", trying again with the next year" << endl;
+	    }
+	    last_change = std::chrono::steady_clock::now();
+	  }
+	}
+	catch (H5::Exception e){
+	  cout << "Cannot read " << input_file << " now, trying again" << endl;
+	}
+      }
+      if (idle_seconds > 0 && std::chrono::steady_clock::now()-last_change >= std::chrono::seconds(idle_seconds)){
+	break;
+      }
+      std::this_thread::sleep_for(std::chrono::seconds(poll_seconds));
+    }
+    HDF5_ACCESS_OPTIONS = saved_options;
+    if (pvd.size() == 0){
+      cout << "No HDF5 datasets for trees in " << input_file << endl;
       return EXIT_FAILURE;
     }
-    QString type = qdoc.firstChild().toElement().attribute("SegmentType");
-    if (type == "Hw"){
-      cout << "CreateVTPCFileFromHDF5  broadleaved trees are not yet supported" <<endl;
+    if (!pvd_written && !pvd.write(output_file)){
+      cout << "Cannot write PVD collection file " << output_file << endl;
       return EXIT_FAILURE;
     }
-    for (unsigned int i=0; i < valid_paths.size(); i++){
-      cout << "Tree " << i << ": " << valid_paths[i] << endl;
-      XMLDomTreeReader<VTKCfSegment,VTKCfBud> tree_string_reader;
-      Tree<VTKCfSegment,VTKCfBud> lignum_cft;
-      std::string lignum_string =  hdf5lignum.getLignumTreeString(valid_paths[i]);
-      tree_string_reader.readXMLStringToTree(lignum_cft,lignum_string);
-      cflignumvtk.createConiferTreeVTKDataSets(lignum_cft,valid_paths[i],false);
+    cout << "PVD collection file: " << output_file << " with " << pvd.size() << " years" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  vector<int> ParseYearRange(const string& range)
+  {
+    vector<int> years;
+    vector<int> fields;
+    std::string::size_type begin = 0;
+    try{
+      while (begin <= range.size()){
+	std::string::size_type end = range.find(':',begin);
+	if (end == std::string::npos){
+	  end = range.size();
+	}
+	fields.push_back(std::stoi(range.substr(begin,end-begin)));
+	begin = end + 1;
+      }
+    }
+    catch (const std::exception& e){
+      cout << "Year range " << range << " should be first:last:step" << endl;
+      return years;
     }
-    cout << "Write file" <<endl;
-    cflignumvtk.writePartitionedDataSetCollection(output_file,view);
+    if (fields.size() > 3 || fields.size() == 0){
+      cout << "Year range " << range << " should be first:last:step" << endl;
+      return years;
+    }
+    int first = fields[0];
+    int last = fields.size() > 1 ? fields[1] : first;
+    int step = fields.size() > 2 ? fields[2] : 1;
+    if (step <= 0 || last < first){
+      cout << "Year range " << range << " should have first <= last and step > 0" << endl;
+      return years;
+    }
+    for (int year = first; year <= last; year += step){
+      years.push_back(year);
+    }
+    return years;
+  }
+
+  bool ParseTreeReader(const string& name,TREE_READER& reader)
+  {
+    if (name == "dom"){
+      reader = TREE_READER::DOM;
+      return true;
+    }
+    if (name == "stream"){
+      reader = TREE_READER::STREAM;
+      return true;
+    }
+    if (name == "direct"){
+      reader = TREE_READER::DIRECT;
+      return true;
+    }
+    cout << "Tree reader " << name << " should be dom, stream or direct" << endl;
+    return false;
+  }
+
+  string YearVTPCFileName(const string& pvd_file,int year)
+  {
+    std::filesystem::path p(pvd_file);
+    std::string stem = p.stem().string()+"_"+std::to_string(year)+VTPC_EXTENSION;
+    return p.replace_filename(stem).string();
+  }
+
+  int CreatePVDFileFromHDF5(const string& input_file,const string& output_file,const vector<int>& years,
+			    int spline_resolution,int view,const string& cache_dir)
+  {
+    //One cache for all years
+    std::unique_ptr<TreeCache> cache;
+    if (!cache_dir.empty()){
+      cache = std::make_unique<TreeCache>(cache_dir);
+    }
+    HDF5ToLignum hdf5lignum;
+    hdf5lignum.openFile(input_file);
+    //Index is built once, the years are then picked from the index
+    const HDF5TreeIndex& index = hdf5lignum.getTreeIndex();
+    PVDFile pvd;
+    for (int year : years){
+      vector<string> v = index.getYear(year);
+      if (v.size() == 0){
+	cout << "No HDF5 datasets for trees for year " << year << ", skipping" << endl;
+	continue;
+      }
+      cout << "Year " << year << ": " << v.size() << " trees" << endl;
+      const string year_file = YearVTPCFileName(output_file,year);
+      if (CreateVTPCFileFromHDF5(hdf5lignum,v,year_file,spline_resolution,view,cache.get()) == EXIT_FAILURE){
+	return EXIT_FAILURE;
+      }
+      //PVD refers to data files relative to its own location
+      pvd.addDataSet(year,std::filesystem::path(year_file).filename().string());
+      //Update the collection after each year to follow the progress in ParaView
+      if (!pvd.write(output_file)){
+	cout << "Cannot write PVD collection file " << output_file << endl;
+	return EXIT_FAILURE;
+      }
+    }
+    if (pvd.size() == 0){
+      cout << "No HDF5 datasets for trees for the years given" << endl;
+      return EXIT_FAILURE;
+    }
+    cout << "PVD collection file: " << output_file << " with " << pvd.size() << " years" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  bool ParseSweep(const string& sweep,SweepParameters& parameters,int spline_resolution)
+  {
+    parameters.spline.clear();
+    parameters.sides.clear();
+    std::string::size_type begin = 0;
+    while (begin < sweep.size()){
+      std::string::size_type end = sweep.find(';',begin);
+      if (end == std::string::npos){
+	end = sweep.size();
+      }
+      const string item = sweep.substr(begin,end-begin);
+      begin = end + 1;
+      std::string::size_type eq = item.find('=');
+      if (eq == std::string::npos){
+	cout << "Sweep parameter " << item << " should be name=value,value,..." << endl;
+	return false;
+      }
+      const string name = item.substr(0,eq);
+      vector<int>* values = nullptr;
+      if (name == "spline"){
+	values = &parameters.spline;
+      }
+      else if (name == "sides"){
+	values = &parameters.sides;
+      }
+      else{
+	cout << "Unknown sweep parameter " << name << ", use spline or sides" << endl;
+	return false;
+      }
+      std::string::size_type vbegin = eq + 1;
+      try{
+	while (vbegin <= item.size()){
+	  std::string::size_type vend = item.find(',',vbegin);
+	  if (vend == std::string::npos){
+	    vend = item.size();
+	  }
+	  int value = std::stoi(item.substr(vbegin,vend-vbegin));
+	  if (value <= 0){
+	    cout << "Sweep parameter " << name << " values should be positive" << endl;
+	    return false;
+	  }
+	  values->push_back(value);
+	  vbegin = vend + 1;
+	}
+      }
+      catch (const std::exception& e){
+	cout << "Sweep parameter " << item << " should be name=value,value,..." << endl;
+	return false;
+      }
+    }
+    //Parameters not in the sweep use the command line or default values
+    if (parameters.spline.empty()){
+      parameters.spline.push_back(spline_resolution);
+    }
+    if (parameters.sides.empty()){
+      parameters.sides.push_back(TUBE_NUMBER_OF_SIDES);
+    }
+    return true;
+  }
+
+  string SweepVTPCFileName(const string& output_file,int spline_resolution,int nsides)
+  {
+    std::filesystem::path p(output_file);
+    std::string stem = p.stem().string()+"_spline"+std::to_string(spline_resolution)
+      +"_sides"+std::to_string(nsides)+VTPC_EXTENSION;
+    return p.replace_filename(stem).string();
+  }
+
+  ///\brief Size of VTK/VTPC file and its directory of VTK/VTP files in bytes
+  ///\param vtpc_file VTK/VTPC file
+  static std::uintmax_t VTPCFileSize(const string& vtpc_file)
+  {
+    std::error_code error;
+    std::uintmax_t size = std::filesystem::file_size(vtpc_file,error);
+    if (error){
+      return 0;
+    }
+    std::filesystem::path dir(vtpc_file);
+    dir.replace_extension();
+    if (std::filesystem::is_directory(dir,error)){
+      for (const auto& entry : std::filesystem::recursive_directory_iterator(dir,error)){
+	if (entry.is_regular_file(error)){
+	  size += entry.file_size(error);
+	}
+      }
+    }
+    return size;
+  }
+
+  ///\brief Number of points and cells in a VTK/VTPC collection
+  ///\param lignumvtk Collection of trees
+  ///\param[out] npoints Number of points
+  ///\param[out] ncells Number of cells
+  static void CountPointsAndCells(LignumToVTK& lignumvtk,vtkIdType& npoints,vtkIdType& ncells)
+  {
+    npoints = 0;
+    ncells = 0;
+    for (int b = 0; b < lignumvtk.getNumberOfPartitionedDataSets(); b++){
+      PolyDataVector pv;
+      lignumvtk.getPartitionedDataSet(b,pv);
+      for (const auto& polydata : pv){
+	npoints += polydata->GetNumberOfPoints();
+	ncells += polydata->GetNumberOfCells();
+      }
+    }
+  }
+
+  int CreateVTPCFileSweep(CollectedStand& stand,const string& output_file,const SweepParameters& parameters,int view)
+  {
+    if (stand.size() == 0){
+      cout << "No trees for parameter sweep" <<endl;
+      return EXIT_FAILURE;
+    }
+    std::filesystem::path csv_path(output_file);
+    csv_path.replace_filename(csv_path.stem().string()+SWEEP_CSV_SUFFIX);
+    std::ofstream csv(csv_path);
+    if (!csv){
+      cout << "Cannot open sweep result file " << csv_path.string() <<endl;
+      return EXIT_FAILURE;
+    }
+    csv << "file,spline,sides,trees,points,cells,mesh_seconds,write_seconds,bytes" << endl;
+    for (int spline_resolution : parameters.spline){
+      for (int nsides : parameters.sides){
+	const string file_name = SweepVTPCFileName(output_file,spline_resolution,nsides);
+	cout << "Sweep spline " << spline_resolution << " sides " << nsides << ": " << file_name <<endl;
+	StandLignumToVTK lignumvtk(spline_resolution,nsides);
+	auto mesh_start = std::chrono::steady_clock::now();
+	for (CollectedTree& ct : stand){
+	  lignumvtk.createTreeVTKDataSets(ct,false);
+	}
+	auto write_start = std::chrono::steady_clock::now();
+	lignumvtk.writePartitionedDataSetCollection(file_name,view);
+	auto write_end = std::chrono::steady_clock::now();
+	if (!lignumvtk.isWritten()){
+	  cout << "Cannot write " << file_name << ", sweep stopped" <<endl;
+	  return EXIT_FAILURE;
+	}
+	vtkIdType npoints = 0;
+	vtkIdType ncells = 0;
+	CountPointsAndCells(lignumvtk,npoints,ncells);
+	const double mesh_seconds = std::chrono::duration<double>(write_start-mesh_start).count();
+	const double write_seconds = std::chrono::duration<double>(write_end-write_start).count();
+	csv << std::filesystem::path(file_name).filename().string() << "," << spline_resolution << "," << nsides << ","
+	    << stand.size() << "," << npoints << "," << ncells << ","
+	    << mesh_seconds << "," << write_seconds << "," << VTPCFileSize(file_name) << endl;
+      }
+    }
+    cout << "Sweep results: " << csv_path.string() <<endl;
     return EXIT_SUCCESS;
   }
 }
@@ -0,0 +1,903 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <AtomicFile.h>
+#include <LignumVTKTree.h>
+#include <CreateVTPCFile.h>
+#include <CreateVoxelSpaceFile.h>
+
+namespace lignumvtk{
+
+  VOXEL_GRID_TYPE VoxelGridType(const string& file_name)
+  {
+    const string extension = std::filesystem::path(file_name).extension().string();
+    if (extension == VTI_EXTENSION || extension == PVTI_EXTENSION){
+      return VOXEL_GRID_TYPE::IMAGE_DATA;
+    }
+    return VOXEL_GRID_TYPE::STRUCTURED_GRID;
+  }
+
+  bool IsParallelVoxelSpaceFile(const string& file_name)
+  {
+    const string extension = std::filesystem::path(file_name).extension().string();
+    return extension == PVTI_EXTENSION || extension == PVTS_EXTENSION;
+  }
+
+  bool IsSparseVoxelSpaceFile(const string& file_name)
+  {
+    return std::filesystem::path(file_name).extension().string() == VTU_EXTENSION;
+  }
+
+  bool IsIsosurfaceFile(const string& file_name)
+  {
+    return std::filesystem::path(file_name).extension().string() == VTP_EXTENSION;
+  }
+
+  string IsosurfaceFileName(const string& output_file)
+  {
+    std::filesystem::path p(output_file);
+    return p.replace_filename(p.stem().string()+"_iso"+VTP_EXTENSION).string();
+  }
+
+  bool IsPyramidVoxelSpaceFile(const string& file_name)
+  {
+    return std::filesystem::path(file_name).extension().string() == VTM_EXTENSION;
+  }
+
+  string VoxelSpacePieceFileName(const string& output_file,int piece)
+  {
+    std::filesystem::path p(output_file);
+    const string stem = p.stem().string();
+    const string extension = (VoxelGridType(output_file) == VOXEL_GRID_TYPE::IMAGE_DATA) ? VTI_EXTENSION : VTS_EXTENSION;
+    return (std::filesystem::path(stem)/(stem+"_"+std::to_string(piece)+extension)).string();
+  }
+
+  bool ParseVoxelRange(const string& range,GridExtent& voi)
+  {
+    int n = 0;
+    std::string::size_type begin = 0;
+    try{
+      while (begin <= range.size() && n < 3){
+	std::string::size_type end = range.find(',',begin);
+	if (end == std::string::npos){
+	  end = range.size();
+	}
+	const string item = range.substr(begin,end-begin);
+	std::string::size_type colon = item.find(':');
+	if (colon == std::string::npos){
+	  break;
+	}
+	voi[2*n] = std::stoi(item.substr(0,colon));
+	voi[2*n+1] = std::stoi(item.substr(colon+1));
+	if (voi[2*n+1] < voi[2*n]){
+	  break;
+	}
+	n++;
+	begin = end + 1;
+      }
+    }
+    catch (const std::exception& e){
+      n = 0;
+    }
+    if (n != 3 || begin <= range.size()){
+      cout << "Volume of interest " << range << " should be i0:i1,j0:j1,k0:k1" << endl;
+      return false;
+    }
+    return true;
+  }
+
+  vector<string> ParseNameList(const string& list)
+  {
+    vector<string> names;
+    std::string::size_type begin = 0;
+    while (begin <= list.size()){
+      std::string::size_type end = list.find(',',begin);
+      if (end == std::string::npos){
+	end = list.size();
+      }
+      if (end > begin){
+	names.push_back(list.substr(begin,end-begin));
+      }
+      begin = end + 1;
+    }
+    return names;
+  }
+
+  bool ParseDataAssociation(const string& name,VOXEL_DATA_ASSOCIATION& association)
+  {
+    if (name == "cell"){
+      association = VOXEL_DATA_ASSOCIATION::CELL;
+    }
+    else if (name == "point"){
+      association = VOXEL_DATA_ASSOCIATION::POINT;
+    }
+    else if (name == "both"){
+      association = VOXEL_DATA_ASSOCIATION::BOTH;
+    }
+    else{
+      cout << "Data association " << name << " should be cell, point or both" << endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool ParseAggregate(const string& list,std::map<string,VOXEL_AGGREGATE>& aggregate)
+  {
+    for (const string& item : ParseNameList(list)){
+      std::string::size_type colon = item.find(':');
+      const string method = (colon == std::string::npos) ? string() : item.substr(colon+1);
+      if (method == "sum"){
+	aggregate[item.substr(0,colon)] = VOXEL_AGGREGATE::SUM;
+      }
+      else if (method == "mean"){
+	aggregate[item.substr(0,colon)] = VOXEL_AGGREGATE::MEAN;
+      }
+      else{
+	cout << "Aggregation " << item << " should be name:sum or name:mean" << endl;
+	return false;
+      }
+    }
+    return true;
+  }
+
+  bool ParseIsoValues(const string& spec,string& attribute,vector<double>& values)
+  {
+    std::string::size_type colon = spec.find(':');
+    values.clear();
+    if (colon != std::string::npos && colon > 0){
+      attribute = spec.substr(0,colon);
+      try{
+	for (const string& value : ParseNameList(spec.substr(colon+1))){
+	  values.push_back(std::stod(value));
+	}
+      }
+      catch (const std::exception& e){
+	values.clear();
+      }
+    }
+    if (values.empty()){
+      cout << "Isosurface " << spec << " should be attribute:value[,value...]" << endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool SelectVoxelSpace(const GridData& gdata,const vector<string>& col_names,const VoxelSpaceOptions& options,
+			VoxelSpaceFrame& frame)
+  {
+    const int dims[3]={std::get<0>(gdata.first),std::get<1>(gdata.first),std::get<2>(gdata.first)};
+    const double edge[3]={std::get<0>(gdata.second),std::get<1>(gdata.second),std::get<2>(gdata.second)};
+    if (options.stride < 1){
+      cout << "Stride should be positive" << endl;
+      return false;
+    }
+    frame.stride = options.stride;
+    for (int i = 0; i < 3; i++){
+      //Empty range is the whole dimension
+      int first = options.voi[2*i];
+      int last = options.voi[2*i+1];
+      if (last < first){
+	first = 0;
+	last = dims[i]-1;
+      }
+      if (first < 0 || last >= dims[i]){
+	cout << "Volume of interest " << first << ":" << last << " outside voxel space 0:" << dims[i]-1
+	     << " in dimension " << i << endl;
+	return false;
+      }
+      frame.n[i] = (last-first)/frame.stride + 1;
+      frame.voi[2*i] = first;
+      frame.voi[2*i+1] = first + (frame.n[i]-1)*frame.stride;
+      const double voxel_edge = (options.voxel_edge == 0.0) ? edge[i] : options.voxel_edge;
+      frame.origin[i] = first*voxel_edge;
+      frame.spacing[i] = voxel_edge*frame.stride;
+    }
+    frame.columns.clear();
+    frame.attr_names = col_names;
+    for (const string& name : options.attributes){
+      auto it = std::find(col_names.begin(),col_names.end(),name);
+      if (it == col_names.end()){
+	cout << "Attribute " << name << " not in voxel space, the attributes are:" << endl;
+	std::copy(col_names.begin(),col_names.end(),std::ostream_iterator<string>(cout, " "));
+	cout << endl;
+	return false;
+      }
+      frame.columns.push_back(it-col_names.begin());
+    }
+    if (!frame.columns.empty()){
+      //HDF5 reads the columns in ascending order
+      std::sort(frame.columns.begin(),frame.columns.end());
+      frame.columns.erase(std::unique(frame.columns.begin(),frame.columns.end()),frame.columns.end());
+      frame.attr_names.clear();
+      for (hsize_t column : frame.columns){
+	frame.attr_names.push_back(col_names[column]);
+      }
+    }
+    //Derived fields are appended after the columns read
+    const double volume = frame.spacing[0]*frame.spacing[1]*frame.spacing[2];
+    frame.derive.setThreads(options.derive_threads);
+    if (!frame.derive.parse(options.derive,frame.attr_names,volume)){
+      return false;
+    }
+    const vector<string>& derived = frame.derive.getNames();
+    frame.attr_names.insert(frame.attr_names.end(),derived.begin(),derived.end());
+    return true;
+  }
+
+  int CreateVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+			   const VoxelSpaceOptions& options)
+  {
+    if (IsIsosurfaceFile(output_file)){
+      return CreateVoxelSpaceIsosurface(hdf5vs,dataset_name,output_file,options);
+    }
+    int status = EXIT_FAILURE;
+    //Isosurface attribute is collected while the voxel space is read
+    IsosurfaceGrid iso_grid;
+    IsosurfaceGrid* iso = options.iso_values.empty() ? nullptr : &iso_grid;
+    if (IsParallelVoxelSpaceFile(output_file)){
+      status = CreateParallelVoxelSpaceFile(hdf5vs,dataset_name,output_file,options,iso);
+    }
+    else if (IsSparseVoxelSpaceFile(output_file)){
+      status = CreateSparseVoxelSpaceFile(hdf5vs,dataset_name,output_file,options,iso);
+    }
+    else if (IsPyramidVoxelSpaceFile(output_file)){
+      status = CreatePyramidVoxelSpaceFile(hdf5vs,dataset_name,output_file,options,iso);
+    }
+    else{
+      status = CreateGridVoxelSpaceFile(hdf5vs,dataset_name,output_file,options,iso);
+    }
+    //Isosurfaces next to the voxel space
+    if (status == EXIT_SUCCESS && iso != nullptr){
+      if (iso->isValid()){
+	status = WriteIsosurfaceFile(*iso,IsosurfaceFileName(output_file),options);
+      }
+      else{
+	//The attribute is not in the voxel space file, read it separately
+	status = CreateVoxelSpaceIsosurface(hdf5vs,dataset_name,IsosurfaceFileName(output_file),options);
+      }
+    }
+    return status;
+  }
+
+  int CreateGridVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+			       const VoxelSpaceOptions& options,IsosurfaceGrid* iso)
+  {
+    VoxelSpaceFrame frame;
+    vector<string> col_names;
+    GridData gdata = hdf5vs.getVoxelSpaceGrid(dataset_name);
+    hdf5vs.readDataSetAttribute(dataset_name,VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    if (gdata == GRID_DATA_ERROR || !SelectVoxelSpace(gdata,col_names,options,frame)){
+      return EXIT_FAILURE;
+    }
+    if (iso != nullptr){
+      iso->init(frame,options.iso_attribute);
+    }
+    VoxelSelection selection;
+    for (int i = 0; i < 3; i++){
+      selection.start[i] = frame.voi[2*i];
+      selection.count[i] = frame.n[i];
+    }
+    selection.stride = frame.stride;
+    selection.columns = frame.columns;
+    vector<double> vsdset;
+    gdata = hdf5vs.getVoxelSpace(dataset_name,selection,vsdset);
+    if (gdata == GRID_DATA_ERROR){
+      return EXIT_FAILURE;
+    }
+    frame.derive.evaluate(vsdset,frame.n[0],frame.n[1],frame.n[2]);
+    if (iso != nullptr && iso->isValid()){
+      iso->insertVoxelSpaceData(vsdset.data(),frame.n[2],0);
+    }
+    const int nd = frame.attr_names.size();
+    const int extent[6]={0,frame.n[0]-1,0,frame.n[1]-1,0,frame.n[2]-1};
+    VoxelSpaceToVTK vsvtk(extent,frame.origin,frame.spacing,VoxelGridType(output_file));
+    //HDF5 buffer is transposed directly to VTK arrays
+    vsvtk.insertVoxelSpaceData(vsdset.data(),frame.n[0],frame.n[1],frame.n[2],nd,frame.attr_names,options.association);
+    //Release the HDF5 buffer before writing
+    vector<double>().swap(vsdset);
+    vsvtk.writeGrid(output_file);
+    return EXIT_SUCCESS;
+  }
+
+  int CreateParallelVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+				   const VoxelSpaceOptions& options,IsosurfaceGrid* iso)
+  {
+    VoxelSpaceFrame frame;
+    vector<string> col_names;
+    GridData gdata = hdf5vs.getVoxelSpaceGrid(dataset_name);
+    hdf5vs.readDataSetAttribute(dataset_name,VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    if (gdata == GRID_DATA_ERROR || !SelectVoxelSpace(gdata,col_names,options,frame)){
+      return EXIT_FAILURE;
+    }
+    if (iso != nullptr){
+      iso->init(frame,options.iso_attribute);
+    }
+    const int nx = frame.n[0];
+    const int ny = frame.n[1];
+    const int nz = frame.n[2];
+    const int nd = frame.attr_names.size();
+    const VOXEL_GRID_TYPE grid_type = VoxelGridType(output_file);
+    const int slab = (options.slab > 0) ? options.slab : VOXEL_SLAB_SIZE;
+    //Directory for the pieces next to the parallel file
+    const std::filesystem::path output_dir = std::filesystem::path(output_file).parent_path();
+    std::error_code error;
+    std::filesystem::create_directories(output_dir/std::filesystem::path(output_file).stem(),error);
+    if (error){
+      cout << "Cannot create directory for pieces: " << error.message() <<endl;
+      return EXIT_FAILURE;
+    }
+    vector<GridExtent> extents;
+    vector<string> piece_files;
+    int k0 = 0;
+    while (true){
+      //Pieces share the last point layer with the next piece
+      const int k1 = std::min(k0+slab,nz-1);
+      const int piece = extents.size();
+      cout << "Piece " << piece << ": voxel layers " << k0 << "-" << k1 << " of " << nz <<endl;
+      VoxelSelection selection;
+      selection.start[0] = frame.voi[0];
+      selection.start[1] = frame.voi[2];
+      selection.start[2] = frame.voi[4] + k0*frame.stride;
+      selection.count[0] = nx;
+      selection.count[1] = ny;
+      selection.count[2] = k1-k0+1;
+      selection.stride = frame.stride;
+      selection.columns = frame.columns;
+      vector<double> vsdset;
+      if (hdf5vs.getVoxelSpace(dataset_name,selection,vsdset) == GRID_DATA_ERROR){
+	return EXIT_FAILURE;
+      }
+      frame.derive.evaluate(vsdset,nx,ny,k1-k0+1,k0);
+      if (iso != nullptr && iso->isValid()){
+	iso->insertVoxelSpaceData(vsdset.data(),k1-k0+1,k0);
+      }
+      const GridExtent extent{0,nx-1,0,ny-1,k0,k1};
+      VoxelSpaceToVTK vsvtk(extent.data(),frame.origin,frame.spacing,grid_type);
+      vsvtk.insertVoxelSpaceData(vsdset.data(),nx,ny,k1-k0+1,nd,frame.attr_names,options.association);
+      vector<double>().swap(vsdset);
+      const string piece_file = VoxelSpacePieceFileName(output_file,piece);
+      vsvtk.writeGrid((output_dir/piece_file).string());
+      extents.push_back(extent);
+      piece_files.push_back(piece_file);
+      if (k1 >= nz-1){
+	break;
+      }
+      k0 = k1;
+    }
+    const GridExtent whole_extent{0,nx-1,0,ny-1,0,nz-1};
+    if (!WriteParallelVoxelSpaceFile(output_file,grid_type,whole_extent,frame.origin,frame.spacing,frame.attr_names,
+				     options.association,extents,piece_files)){
+      return EXIT_FAILURE;
+    }
+    cout << "Parallel VTK file: " << output_file << " with " << piece_files.size() << " pieces" <<endl;
+    return EXIT_SUCCESS;
+  }
+
+  int CreateSparseVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+				 const VoxelSpaceOptions& options,IsosurfaceGrid* iso)
+  {
+    VoxelSpaceFrame frame;
+    vector<string> col_names;
+    GridData gdata = hdf5vs.getVoxelSpaceGrid(dataset_name);
+    hdf5vs.readDataSetAttribute(dataset_name,VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    if (gdata == GRID_DATA_ERROR || !SelectVoxelSpace(gdata,col_names,options,frame)){
+      return EXIT_FAILURE;
+    }
+    if (iso != nullptr){
+      iso->init(frame,options.iso_attribute);
+    }
+    const int nx = frame.n[0];
+    const int ny = frame.n[1];
+    const int nz = frame.n[2];
+    const int nd = frame.attr_names.size();
+    const int slab = (options.slab > 0) ? options.slab : VOXEL_SLAB_SIZE;
+    SparseVoxelSpaceToVTK sparse(frame.origin,frame.spacing,frame.attr_names,options.sparse_threshold);
+    //Each voxel is one hexahedron, the slabs do not overlap
+    for (int k0 = 0; k0 < nz; k0 += slab){
+      const int k1 = std::min(k0+slab,nz);
+      VoxelSelection selection;
+      selection.start[0] = frame.voi[0];
+      selection.start[1] = frame.voi[2];
+      selection.start[2] = frame.voi[4] + k0*frame.stride;
+      selection.count[0] = nx;
+      selection.count[1] = ny;
+      selection.count[2] = k1-k0;
+      selection.stride = frame.stride;
+      selection.columns = frame.columns;
+      vector<double> vsdset;
+      if (hdf5vs.getVoxelSpace(dataset_name,selection,vsdset) == GRID_DATA_ERROR){
+	return EXIT_FAILURE;
+      }
+      frame.derive.evaluate(vsdset,nx,ny,k1-k0,k0);
+      if (iso != nullptr && iso->isValid()){
+	iso->insertVoxelSpaceData(vsdset.data(),k1-k0,k0);
+      }
+      std::size_t n = sparse.insertVoxelSpaceData(vsdset.data(),nx,ny,k1-k0,nd,k0);
+      cout << "Voxel layers " << k0 << "-" << k1-1 << " of " << nz << ": " << n << " occupied voxels" <<endl;
+    }
+    const double total = static_cast<double>(nx)*ny*nz;
+    cout << "Occupied voxels: " << sparse.getNumberOfVoxels() << " of " << total << " ("
+	 << (total > 0 ? 100.0*sparse.getNumberOfVoxels()/total : 0.0) << "%)" <<endl;
+    //ParaView never sees a partially written file
+    const bool written = WriteFileAtomically(output_file,[&sparse](const string& tmp_file){
+      sparse.writeUnstructuredGrid(tmp_file);
+      return true;
+    });
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  int CreatePyramidVoxelSpaceFile(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+				  const VoxelSpaceOptions& options,IsosurfaceGrid* iso)
+  {
+    if (options.pyramid < 1 || options.pyramid > VOXEL_PYRAMID_MAX_LEVELS){
+      cout << "Number of pyramid levels should be 1-" << VOXEL_PYRAMID_MAX_LEVELS << endl;
+      return EXIT_FAILURE;
+    }
+    VoxelSpaceFrame frame;
+    vector<string> col_names;
+    GridData gdata = hdf5vs.getVoxelSpaceGrid(dataset_name);
+    hdf5vs.readDataSetAttribute(dataset_name,VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    if (gdata == GRID_DATA_ERROR || !SelectVoxelSpace(gdata,col_names,options,frame)){
+      return EXIT_FAILURE;
+    }
+    if (iso != nullptr){
+      iso->init(frame,options.iso_attribute);
+    }
+    vector<VOXEL_AGGREGATE> aggregate(frame.attr_names.size(),VOXEL_AGGREGATE::MEAN);
+    for (const auto& [name,method] : options.aggregate){
+      auto it = std::find(frame.attr_names.begin(),frame.attr_names.end(),name);
+      if (it == frame.attr_names.end()){
+	cout << "Aggregated attribute " << name << " not in the selected attributes" << endl;
+	return EXIT_FAILURE;
+      }
+      aggregate[it-frame.attr_names.begin()] = method;
+    }
+    const int nx = frame.n[0];
+    const int ny = frame.n[1];
+    const int nz = frame.n[2];
+    const int nd = frame.attr_names.size();
+    //Slabs do not split the cells of the coarsest level
+    const int block = 1 << options.pyramid;
+    const int slab = (((options.slab > 0) ? options.slab : VOXEL_SLAB_SIZE) + block - 1)/block*block;
+    const std::filesystem::path output_path(output_file);
+    const string stem = output_path.stem().string();
+    const std::filesystem::path level_dir = output_path.parent_path()/stem;
+    std::error_code error;
+    std::filesystem::create_directories(level_dir,error);
+    if (error){
+      cout << "Cannot create directory for levels: " << error.message() <<endl;
+      return EXIT_FAILURE;
+    }
+    VoxelPyramid pyramid(nx,ny,nz,options.pyramid,aggregate);
+    const string level0 = stem + "_level0";
+    vector<GridExtent> extents;
+    vector<string> piece_files;
+    for (int k0 = 0; k0 < nz; k0 += slab){
+      const int k1 = std::min(k0+slab,nz);
+      const int piece = extents.size();
+      cout << "Piece " << piece << ": voxel layers " << k0 << "-" << k1-1 << " of " << nz <<endl;
+      VoxelSelection selection;
+      selection.start[0] = frame.voi[0];
+      selection.start[1] = frame.voi[2];
+      selection.start[2] = frame.voi[4] + k0*frame.stride;
+      selection.count[0] = nx;
+      selection.count[1] = ny;
+      selection.count[2] = k1-k0;
+      selection.stride = frame.stride;
+      selection.columns = frame.columns;
+      vector<double> vsdset;
+      if (hdf5vs.getVoxelSpace(dataset_name,selection,vsdset) == GRID_DATA_ERROR){
+	return EXIT_FAILURE;
+      }
+      frame.derive.evaluate(vsdset,nx,ny,k1-k0,k0);
+      if (iso != nullptr && iso->isValid()){
+	iso->insertVoxelSpaceData(vsdset.data(),k1-k0,k0);
+      }
+      pyramid.insertVoxelSpaceData(vsdset.data(),k1-k0,k0);
+      //Level 0 piece is cell centred, one cell for each voxel
+      const GridExtent extent{0,nx,0,ny,k0,k1};
+      vtkNew<vtkImageData> image;
+      image->SetExtent(extent[0],extent[1],extent[2],extent[3],extent[4],extent[5]);
+      image->SetOrigin(frame.origin);
+      image->SetSpacing(frame.spacing);
+      vector<double*> cell_data(nd);
+      for (int d = 0; d < nd; d++){
+	vtkNew<vtkDoubleArray> attr;
+	attr->SetName(frame.attr_names[d].c_str());
+	attr->SetNumberOfTuples(static_cast<vtkIdType>(nx)*ny*(k1-k0));
+	cell_data[d] = attr->GetPointer(0);
+	image->GetCellData()->AddArray(attr);
+      }
+      TransposeVoxelData(vsdset.data(),nx,ny,k1-k0,nd,cell_data);
+      vector<double>().swap(vsdset);
+      if (nd > 0){
+	image->GetCellData()->SetActiveScalars(frame.attr_names[0].c_str());
+      }
+      const string piece_file = level0 + "_" + std::to_string(piece) + VTI_EXTENSION;
+      WriteImageData(image,(level_dir/piece_file).string());
+      extents.push_back(extent);
+      piece_files.push_back(piece_file);
+    }
+    const GridExtent whole_extent{0,nx,0,ny,0,nz};
+    if (!WriteParallelVoxelSpaceFile((level_dir/(level0+PVTI_EXTENSION)).string(),VOXEL_GRID_TYPE::IMAGE_DATA,whole_extent,
+				     frame.origin,frame.spacing,frame.attr_names,VOXEL_DATA_ASSOCIATION::CELL,
+				     extents,piece_files)){
+      return EXIT_FAILURE;
+    }
+    vector<string> block_names{"Level0"};
+    vector<string> block_files{(std::filesystem::path(stem)/(level0+PVTI_EXTENSION)).string()};
+    for (int level = 1; level <= pyramid.getNumberOfLevels(); level++){
+      const string level_file = stem + "_level" + std::to_string(level) + VTI_EXTENSION;
+      cout << "Level " << level << ": " << pyramid.getNumberOfCells(level,0) << "x" << pyramid.getNumberOfCells(level,1)
+	   << "x" << pyramid.getNumberOfCells(level,2) << " cells" <<endl;
+      WriteImageData(pyramid.getLevel(level,frame.origin,frame.spacing,frame.attr_names),(level_dir/level_file).string());
+      block_names.push_back("Level" + std::to_string(level));
+      block_files.push_back((std::filesystem::path(stem)/level_file).string());
+    }
+    if (!WriteMultiBlockFile(output_file,block_names,block_files)){
+      return EXIT_FAILURE;
+    }
+    cout << "Voxel space pyramid: " << output_file << " with " << block_files.size() << " levels" <<endl;
+    return EXIT_SUCCESS;
+  }
+
+  int CreateVoxelSpaceIsosurface(HDF5ToVoxelSpace& hdf5vs,const string& dataset_name,const string& output_file,
+				 const VoxelSpaceOptions& options)
+  {
+    if (options.iso_values.empty()){
+      cout << "No isosurface values for " << output_file << endl;
+      return EXIT_FAILURE;
+    }
+    VoxelSpaceOptions iso_options = options;
+    //Read only the contoured attribute unless derived fields need other attributes
+    if (iso_options.derive.empty()){
+      iso_options.attributes = vector<string>{options.iso_attribute};
+    }
+    VoxelSpaceFrame frame;
+    vector<string> col_names;
+    GridData gdata = hdf5vs.getVoxelSpaceGrid(dataset_name);
+    hdf5vs.readDataSetAttribute(dataset_name,VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    if (gdata == GRID_DATA_ERROR || !SelectVoxelSpace(gdata,col_names,iso_options,frame)){
+      return EXIT_FAILURE;
+    }
+    IsosurfaceGrid iso;
+    if (!iso.init(frame,options.iso_attribute)){
+      cout << "Isosurface attribute " << options.iso_attribute << " not in the selected attributes" << endl;
+      return EXIT_FAILURE;
+    }
+    VoxelSelection selection;
+    for (int i = 0; i < 3; i++){
+      selection.start[i] = frame.voi[2*i];
+      selection.count[i] = frame.n[i];
+    }
+    selection.stride = frame.stride;
+    selection.columns = frame.columns;
+    vector<double> vsdset;
+    if (hdf5vs.getVoxelSpace(dataset_name,selection,vsdset) == GRID_DATA_ERROR){
+      return EXIT_FAILURE;
+    }
+    frame.derive.evaluate(vsdset,frame.n[0],frame.n[1],frame.n[2]);
+    iso.insertVoxelSpaceData(vsdset.data(),frame.n[2],0);
+    vector<double>().swap(vsdset);
+    return WriteIsosurfaceFile(iso,output_file,options);
+  }
+
+  bool IsosurfaceGrid::init(const VoxelSpaceFrame& frame,const string& iso_attribute)
+  {
+    auto it = std::find(frame.attr_names.begin(),frame.attr_names.end(),iso_attribute);
+    if (it == frame.attr_names.end()){
+      column = -1;
+      return false;
+    }
+    column = it-frame.attr_names.begin();
+    nd = frame.attr_names.size();
+    for (int i = 0; i < 3; i++){
+      n[i] = frame.n[i];
+      origin[i] = frame.origin[i];
+      spacing[i] = frame.spacing[i];
+    }
+    values.assign(static_cast<std::size_t>(n[0])*n[1]*n[2],0.0);
+    return true;
+  }
+
+  void IsosurfaceGrid::insertVoxelSpaceData(const double* data,int nk,int k0)
+  {
+    //Voxel values are the point values as in VoxelSpaceToVTK
+    const std::size_t nx = n[0];
+    const std::size_t ny = n[1];
+    const double* src = data + column;
+    for (std::size_t i = 0; i < nx; i++){
+      for (std::size_t j = 0; j < ny; j++){
+	for (int k = 0; k < nk; k++, src += nd){
+	  const double v = *src;
+	  values[i + nx*(j + ny*(k0+k))] = (v == v) ? v : 0.0;
+	}
+      }
+    }
+  }
+
+  int WriteIsosurfaceFile(const IsosurfaceGrid& iso,const string& output_file,const VoxelSpaceOptions& options)
+  {
+    vtkNew<vtkImageData> image;
+    image->SetDimensions(iso.n[0],iso.n[1],iso.n[2]);
+    image->SetOrigin(iso.origin);
+    image->SetSpacing(iso.spacing);
+    vtkNew<vtkDoubleArray> values;
+    values->SetName(options.iso_attribute.c_str());
+    //The contour filter only reads the values, no copy
+    values->SetArray(const_cast<double*>(iso.values.data()),static_cast<vtkIdType>(iso.values.size()),1);
+    image->GetPointData()->SetScalars(values);
+    //Flying edges runs in parallel with the VTK SMP backend
+    vtkNew<vtkFlyingEdges3D> contour;
+    contour->SetInputData(image);
+    contour->SetNumberOfContours(options.iso_values.size());
+    for (unsigned int i = 0; i < options.iso_values.size(); i++){
+      contour->SetValue(i,options.iso_values[i]);
+    }
+    contour->ComputeNormalsOn();
+    contour->ComputeScalarsOn();
+    contour->Update();
+    vtkPolyData* surface = contour->GetOutput();
+    cout << "Isosurfaces for " << options.iso_attribute << ": " << surface->GetNumberOfPolys() << " triangles" << endl;
+    //ParaView never sees a partially written file
+    const bool written = WriteFileAtomically(output_file,[surface](const string& tmp_file){
+      vtkNew<vtkXMLPolyDataWriter> writer;
+      writer->SetFileName(tmp_file.c_str());
+      writer->SetInputData(surface);
+      writer->SetDataModeToAppended();
+      writer->EncodeAppendedDataOff();
+      if (writer->Write() == 0){
+	cout << "Cannot write isosurface file " << tmp_file << endl;
+	return false;
+      }
+      return true;
+    });
+    if (!written){
+      return EXIT_FAILURE;
+    }
+    cout << "Isosurface file: " << output_file << endl;
+    return EXIT_SUCCESS;
+  }
+
+  double EstimateVoxelSpaceFileSize(int nx,int ny,int nz,int nd,VOXEL_DATA_ASSOCIATION association)
+  {
+    const double point_size = static_cast<double>(nx)*ny*nz*nd*sizeof(double);
+    const double cell_size = static_cast<double>(std::max(nx-1,0))*std::max(ny-1,0)*std::max(nz-1,0)*nd*sizeof(double);
+    switch (association){
+    case VOXEL_DATA_ASSOCIATION::CELL:
+      return cell_size;
+    case VOXEL_DATA_ASSOCIATION::POINT:
+      return point_size;
+    default:
+      return point_size + cell_size;
+    }
+  }
+
+  int ListVoxelSpaces(HDF5ToVoxelSpace& hdf5vs,const string& pattern)
+  {
+    vector<string> all_datasets = hdf5vs.getDataSetNames(hdf5vs.getRoot());
+    vector<string> datasets;
+    std::copy_if(all_datasets.begin(),all_datasets.end(),std::back_inserter(datasets),FindSubString(pattern));
+    if (datasets.empty()){
+      cout << "No voxel space datasets" << endl;
+      return EXIT_FAILURE;
+    }
+    vector<string> col_names;
+    hdf5vs.readDataSetAttribute(datasets[0],VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
+    cout << "Attribute names:" << endl;
+    std::copy(col_names.begin(),col_names.end(),std::ostream_iterator<string>(cout, " "));
+    cout << endl;
+    cout << "Dataset voxels(x,y,z) attributes voxel_size(x,y,z) stored estimated_vti" << endl;
+    double total_stored = 0.0;
+    double total_vti = 0.0;
+    int nlisted = 0;
+    for (const string& name : datasets){
+      const DataSetInfo info = hdf5vs.getDataSetInfo(name);
+      if (info.dims.size() != 4){
+	cout << name << " is not a voxel space" << endl;
+	continue;
+      }
+      const GridData gdata = hdf5vs.getVoxelSpaceGrid(name);
+      if (gdata == GRID_DATA_ERROR){
+	cout << name << " is not a voxel space" << endl;
+	continue;
+      }
+      const double vti_size = EstimateVoxelSpaceFileSize(info.dims[0],info.dims[1],info.dims[2],info.dims[3],
+							   VOXEL_DATA_ASSOCIATION::BOTH);
+      cout << name << " " << info.dims[0] << "," << info.dims[1] << "," << info.dims[2] << " " << info.dims[3] << " "
+	   << std::get<0>(gdata.second) << "," << std::get<1>(gdata.second) << "," << std::get<2>(gdata.second) << " "
+	   << ByteSizeString(info.storage_size) << " " << ByteSizeString(vti_size) << endl;
+      total_stored += info.storage_size;
+      total_vti += vti_size;
+      nlisted++;
+    }
+    cout << "Total of " << nlisted << " voxel spaces, " << ByteSizeString(total_stored) << " stored, "
+	 << ByteSizeString(total_vti) << " estimated VTK/VTI" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  int VoxelSpaceDataSetYear(const string& dataset_name)
+  {
+    const string name = std::filesystem::path(dataset_name).filename().string();
+    std::string::size_type begin = name.size();
+    while (begin > 0 && std::isdigit(static_cast<unsigned char>(name[begin-1]))){
+      begin--;
+    }
+    if (begin == name.size()){
+      return -1;
+    }
+    return std::stoi(name.substr(begin));
+  }
+
+  string VoxelSpaceDataSetFileName(const string& pvd_file,const string& dataset_name,const string& extension)
+  {
+    std::filesystem::path p(pvd_file);
+    //Dataset path without the leading slash, groups separated with underscores 
+    string name = dataset_name.substr(dataset_name.find_first_not_of('/'));
+    std::replace(name.begin(),name.end(),'/','_');
+    return p.replace_filename(p.stem().string()+"_"+name+extension).string();
+  }
+
+  int CreateVoxelSpaceCollection(HDF5ToVoxelSpace& hdf5vs,const vector<string>& datasets,const string& output_file,
+				 const string& extension,const VoxelSpaceOptions& options,unsigned int threads)
+  {
+    if (datasets.empty()){
+      cout << "No voxel space datasets to convert" << endl;
+      return EXIT_FAILURE;
+    }
+    if (threads == 0){
+      threads = std::max(1u,std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned int>(threads,datasets.size());
+    cout << "Converting " << datasets.size() << " voxel spaces with " << threads << " threads" << endl;
+    //The workers share the hardware threads for the derived fields
+    VoxelSpaceOptions worker_options = options;
+    if (worker_options.derive_threads == 0){
+      worker_options.derive_threads = std::max(1u,std::thread::hardware_concurrency()/threads);
+    }
+    vector<int> status(datasets.size(),EXIT_FAILURE);
+    //Workers take the next dataset until all are done
+    std::atomic<std::size_t> next(0);
+    auto worker = [&](){
+      for (std::size_t i = next++; i < datasets.size(); i = next++){
+	const string file_name = VoxelSpaceDataSetFileName(output_file,datasets[i],extension);
+	status[i] = CreateVoxelSpaceFile(hdf5vs,datasets[i],file_name,worker_options);
+      }
+    };
+    vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; t++){
+      pool.emplace_back(worker);
+    }
+    for (std::thread& t : pool){
+      t.join();
+    }
+    //Time series in the order of the years
+    vector<std::size_t> order(datasets.size());
+    for (std::size_t i = 0; i < order.size(); i++){
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(),order.end(),[&](std::size_t a,std::size_t b){
+      return VoxelSpaceDataSetYear(datasets[a]) < VoxelSpaceDataSetYear(datasets[b]);});
+    PVDFile pvd;
+    int failed = 0;
+    for (std::size_t i : order){
+      if (status[i] == EXIT_FAILURE){
+	cout << "Conversion failed for dataset " << datasets[i] << endl;
+	failed++;
+	continue;
+      }
+      const int year = VoxelSpaceDataSetYear(datasets[i]);
+      //Datasets without a year are numbered in the order they are listed
+      const double time_step = (year >= 0) ? year : static_cast<double>(i);
+      const string file_name = VoxelSpaceDataSetFileName(output_file,datasets[i],extension);
+      pvd.addDataSet(time_step,std::filesystem::path(file_name).filename().string(),0,datasets[i]);
+    }
+    if (pvd.size() > 0 && !pvd.write(output_file)){
+      return EXIT_FAILURE;
+    }
+    cout << "PVD file: " << output_file << " with " << pvd.size() << " voxel spaces" << endl;
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  bool WriteMultiBlockFile(const string& file_name,const vector<string>& block_names,const vector<string>& block_files)
+  {
+    const std::uint16_t byte_order_test = 1;
+    const bool little_endian = *reinterpret_cast<const unsigned char*>(&byte_order_test) == 1;
+    return WriteFileAtomically(file_name,[&](const string& tmp_file){
+      std::ofstream mfile(tmp_file);
+      if (!mfile){
+	cout << "Cannot open multiblock file " << tmp_file << " for writing" << endl;
+	return false;
+      }
+      mfile << "<?xml version=\"1.0\"?>" << endl;
+      mfile << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\" byte_order=\""
+	    << (little_endian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">" << endl;
+      mfile << "  <vtkMultiBlockDataSet>" << endl;
+      for (unsigned int i = 0; i < block_files.size(); i++){
+	mfile << "    <DataSet index=\"" << i << "\" name=\"" << block_names[i] << "\" file=\"" << block_files[i] << "\"/>" << endl;
+      }
+      mfile << "  </vtkMultiBlockDataSet>" << endl;
+      mfile << "</VTKFile>" << endl;
+      mfile.close();
+      return !mfile.fail();
+    });
+  }
+
+  ///\brief Extent as space separated string for VTK XML files
+  string ExtentString(const GridExtent& extent)
+  {
+    string s = std::to_string(extent[0]);
+    for (unsigned int i = 1; i < extent.size(); i++){
+      s += " " + std::to_string(extent[i]);
+    }
+    return s;
+  }
+
+  bool WriteParallelVoxelSpaceFile(const string& file_name,VOXEL_GRID_TYPE grid_type,const GridExtent& whole_extent,
+				   const double origin[3],const double spacing[3],const vector<string>& attr_names,
+				   VOXEL_DATA_ASSOCIATION association,
+				   const vector<GridExtent>& extents,const vector<string>& piece_files)
+  {
+    const std::uint16_t byte_order_test = 1;
+    const bool little_endian = *reinterpret_cast<const unsigned char*>(&byte_order_test) == 1;
+    const string type = (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA) ? "PImageData" : "PStructuredGrid";
+    //ParaView never sees a partially written file
+    return WriteFileAtomically(file_name,[&](const string& tmp_file){
+      std::ofstream pfile(tmp_file);
+      if (!pfile){
+	cout << "Cannot open parallel VTK file " << tmp_file << " for writing" << endl;
+	return false;
+      }
+      pfile << "<?xml version=\"1.0\"?>" << endl;
+      pfile << "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\""
+	    << (little_endian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">" << endl;
+      pfile << "  <" << type << " WholeExtent=\"" << ExtentString(whole_extent) << "\" GhostLevel=\"0\"";
+      if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+	pfile << " Origin=\"" << origin[0] << " " << origin[1] << " " << origin[2] << "\""
+	      << " Spacing=\"" << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\"";
+      }
+      pfile << ">" << endl;
+      if (association != VOXEL_DATA_ASSOCIATION::CELL){
+	pfile << "    <PPointData";
+	if (association == VOXEL_DATA_ASSOCIATION::POINT && attr_names.size() > 0){
+	  pfile << " Scalars=\"" << attr_names[0] << "\"";
+	}
+	pfile << ">" << endl;
+	for (const string& name : attr_names){
+	  pfile << "      <PDataArray type=\"Float64\" Name=\"" << name << "\"/>" << endl;
+	}
+	pfile << "    </PPointData>" << endl;
+      }
+      if (association != VOXEL_DATA_ASSOCIATION::POINT){
+	pfile << "    <PCellData";
+	if (attr_names.size() > 0){
+	  pfile << " Scalars=\"" << attr_names[0] << "\"";
+	}
+	pfile << ">" << endl;
+	for (const string& name : attr_names){
+	  pfile << "      <PDataArray type=\"Float64\" Name=\"" << name << "\"/>" << endl;
+	}
+	pfile << "    </PCellData>" << endl;
+      }
+      if (grid_type == VOXEL_GRID_TYPE::STRUCTURED_GRID){
+	//vtkPoints default data type is float
+	pfile << "    <PPoints>" << endl;
+	pfile << "      <PDataArray type=\"Float32\" NumberOfComponents=\"3\"/>" << endl;
+	pfile << "    </PPoints>" << endl;
+      }
+      for (unsigned int i = 0; i < piece_files.size(); i++){
+	pfile << "    <Piece Extent=\"" << ExtentString(extents[i]) << "\" Source=\"" << piece_files[i] << "\"/>" << endl;
+      }
+      pfile << "  </" << type << ">" << endl;
+      pfile << "</VTKFile>" << endl;
+      pfile.close();
+      return !pfile.fail();
+    });
+  }
+}
@@ -1,4 +1,9 @@
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <unistd.h>
 #include <HDF5ToLignum.h>
+#include <HDF5TreeColumns.h>
 
 namespace lignumvtk{
   herr_t InsertDataSet(hid_t loc_id, const char* name, const H5O_info_t* info, void* user_data)
@@ -17,9 +22,65 @@ namespace lignumvtk{
     attribute_names->push_back(attr_name);
   }
   
+  ///\brief Smallest prime not less than \p n, HDF5 recommends a prime number of chunk cache slots
+  static size_t NextPrime(size_t n)
+  {
+    for (;; n++){
+      bool prime = n > 1;
+      for (size_t d = 2; prime && d*d <= n; d++){
+	prime = n % d != 0;
+      }
+      if (prime){
+	return n;
+      }
+    }
+  }
+
+  H5::FileAccPropList CreateFileAccess(const string& file_name,const HDF5AccessOptions& options)
+  {
+    H5::FileAccPropList fapl;
+    if (options.chunk_cache_bytes > 0){
+      int mdc_nelmts = 0;
+      size_t rdcc_nslots = 0;
+      size_t rdcc_nbytes = 0;
+      double rdcc_w0 = 0.0;
+      fapl.getCache(mdc_nelmts,rdcc_nslots,rdcc_nbytes,rdcc_w0);
+      //One slot for each 4 KB in the cache keeps hash collisions rare for small chunks
+      rdcc_nslots = NextPrime(std::max(rdcc_nslots,options.chunk_cache_bytes/4096));
+      //Trees are read once, fully read chunks can be evicted first
+      fapl.setCache(mdc_nelmts,rdcc_nslots,options.chunk_cache_bytes,1.0);
+    }
+    if (options.meta_cache_bytes > 0){
+      H5AC_cache_config_t config;
+      config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+      H5Pget_mdc_config(fapl.getId(),&config);
+      config.set_initial_size = true;
+      config.initial_size = options.meta_cache_bytes;
+      config.min_size = std::min(config.min_size,options.meta_cache_bytes);
+      config.max_size = std::max(config.max_size,options.meta_cache_bytes);
+      H5Pset_mdc_config(fapl.getId(),&config);
+    }
+    if (options.core){
+      std::error_code ec;
+      const std::uintmax_t file_size = std::filesystem::file_size(file_name,ec);
+      const std::uintmax_t available = static_cast<std::uintmax_t>(sysconf(_SC_AVPHYS_PAGES))*sysconf(_SC_PAGE_SIZE);
+      //Leave half of the free memory for the VTK data
+      if (!ec && file_size < available/2){
+	cout << "Reading " << file_name << " " << ByteSizeString(file_size) << " into memory" <<endl;
+	//Read only, no backing store
+	fapl.setCore(1024*1024,false);
+      }
+      else{
+	cout << "File " << file_name << " does not fit in memory (" << ByteSizeString(available) << " available), reading from disk" <<endl;
+      }
+    }
+    return fapl;
+  }
+
   HDF5Base& HDF5Base::openFile(const string& name)
   {
-    hdf5_file.openFile(name,H5F_ACC_RDONLY);
+    const unsigned int flags = HDF5_ACCESS_OPTIONS.swmr ? H5F_ACC_RDONLY|H5F_ACC_SWMR_READ : H5F_ACC_RDONLY;
+    hdf5_file.openFile(name,flags,CreateFileAccess(name,HDF5_ACCESS_OPTIONS));
     return *this;
   }
 
@@ -30,6 +91,7 @@ namespace lignumvtk{
 
   vector<string>& HDF5Base::getDataSetNames(const string& name)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     dataset_names.names.clear();
     dataset_names.prefix=name;
     try{
@@ -56,6 +118,7 @@ namespace lignumvtk{
   
   vector<string>& HDF5Base::getDataSetNames(int year)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     dataset_names.names.clear();
     string group_name = getMainGroupName()+std::to_string(year)+std::string("/");
     dataset_names.prefix = group_name;
@@ -76,8 +139,60 @@ namespace lignumvtk{
     return dataset_names.names;
   }
   
+  vector<string> HDF5Base::getGroupMembers(const string& group_name)
+  {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    vector<string> members;
+    try{
+      Exception::dontPrint();
+      H5::Group g = hdf5_file.openGroup(group_name);
+      const hsize_t n = g.getNumObjs();
+      members.reserve(n);
+      for (hsize_t i = 0; i < n; i++){
+	members.push_back(g.getObjnameByIdx(i));
+      }
+    }
+    catch (H5::Exception e){
+      cout << group_name << " is not a group" <<endl;
+    }
+    return members;
+  }
+
+  DataSetInfo HDF5Base::getDataSetInfo(const string& dataset_name)
+  {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    DataSetInfo info;
+    try{
+      Exception::dontPrint();
+      DataSet dataset = hdf5_file.openDataSet(dataset_name);
+      DataSpace dataspace = dataset.getSpace();
+      info.dims.resize(dataspace.getSimpleExtentNdims());
+      dataspace.getSimpleExtentDims(info.dims.data(), NULL);
+      info.storage_size = dataset.getStorageSize();
+    }
+    catch (H5::Exception e){
+      cout << "Could not open dataset: " << dataset_name <<endl;
+    }
+    return info;
+  }
+
+  string ByteSizeString(double bytes)
+  {
+    const char* units[]={"B","KB","MB","GB","TB"};
+    int unit = 0;
+    while (bytes >= 1024.0 && unit < 4){
+      bytes /= 1024.0;
+      unit++;
+    }
+    std::ostringstream s;
+    s.precision((unit == 0) ? 0 : 1);
+    s << std::fixed << bytes << " " << units[unit];
+    return s.str();
+  }
+
   vector<string> HDF5Base::readAttributeNames()
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     vector<string> v;
     if (dataset_names.names.size() > 0){
       const std::string dset_name = dataset_names.names[0];
@@ -90,6 +205,7 @@ namespace lignumvtk{
   
   int HDF5Base::readDataSetAttribute(const string& dset_name, const string& attr_name,double& attr_value)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     try{
       DataSet dset = hdf5_file.openDataSet(dset_name);
       Attribute attr = dset.openAttribute(attr_name);
@@ -108,6 +224,7 @@ namespace lignumvtk{
 
   int HDF5Base::readDataSetAttribute(const string& dset_name, const string& attr_name,vector<double>& attr_values)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     try{
       DataSet dset = hdf5_file.openDataSet(dset_name);
       Attribute attr = dset.openAttribute(attr_name);
@@ -135,6 +252,7 @@ namespace lignumvtk{
 
   int HDF5Base::readDataSetAttribute(const string& dset_name, const string& attr_name,vector<string>& attr_values)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     try{
       DataSet dset = hdf5_file.openDataSet(dset_name);
       Attribute attr = dset.openAttribute(attr_name);
@@ -172,8 +290,66 @@ namespace lignumvtk{
     return 0;
   }
   
+  HDF5ToLignum& HDF5ToLignum::openFile(const string& name)
+  {
+    HDF5Base::openFile(name);
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    //Group path without the trailing slash
+    tree_columns = hdf5_file.nameExists(TREE_COLUMNS_GROUP.substr(0,TREE_COLUMNS_GROUP.size()-1));
+    tree_columns_supported = tree_columns && CheckTreeColumnsVersion(hdf5_file);
+    if (tree_columns){
+      cout << "Trees in columnar layout in " << name <<endl;
+    }
+    return *this;
+  }
+
+  bool HDF5ToLignum::getCollectedTree(const string& tree_path,CollectedTree& ct)
+  {
+    if (!tree_columns_supported){
+      cout << "Tree columns in unsupported format version, cannot read " << tree_path << endl;
+      return false;
+    }
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    return ReadTreeColumns(hdf5_file,tree_path,ct);
+  }
+
+  hsize_t HDF5ToLignum::getTreeStorageSize(const string& tree_path)
+  {
+    if (!tree_columns){
+      return getDataSetInfo(tree_path).storage_size;
+    }
+    hsize_t size = 0;
+    for (const string& name : {TREE_COLUMNS_SEGMENTS,TREE_COLUMNS_AXES,TREE_COLUMNS_LEAVES}){
+      size += getDataSetInfo(tree_path+"/"+name).storage_size;
+    }
+    return size;
+  }
+
+  const HDF5TreeIndex& HDF5ToLignum::getTreeIndex()
+  {
+    if (!tree_index){
+      tree_index = std::make_unique<HDF5TreeIndex>();
+      const string file_name = hdf5_file.getFileName();
+      if (!tree_index->load(HDF5TreeIndex::indexFileName(file_name),file_name,getMainGroupName())){
+	tree_index->build(*this,getMainGroupName());
+      }
+    }
+    return *tree_index;
+  }
+
+  bool HDF5ToLignum::saveTreeIndex()
+  {
+    const string file_name = hdf5_file.getFileName();
+    //Build from the file, not from a possibly stale sidecar
+    tree_index = std::make_unique<HDF5TreeIndex>();
+    tree_index->build(*this,getMainGroupName());
+    return tree_index->save(HDF5TreeIndex::indexFileName(file_name),file_name);
+  }
+
   const std::string HDF5ToLignum::getLignumTreeString(const std::string& dataset_name)const
   {
+    //Trees can be read ahead in HDF5TreePrefetcher thread
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     std::string lignum_string;
     try{
       Exception::dontPrint();
@@ -196,11 +372,16 @@ namespace lignumvtk{
 
   const GridData HDF5ToVoxelSpace::getVoxelSpace(const string& dataset_name, vector<double>& v)
   {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
     try{
       Exception::dontPrint();
       DataSet dataset = hdf5_file.openDataSet(dataset_name);
       DataSpace dataspace = dataset.getSpace();
       int rank = dataspace.getSimpleExtentNdims(); // Should be 4
+      if (rank != 4){
+	cout << "Dataset " << dataset_name << " is not a voxel space, rank " << rank <<endl;
+	return GRID_DATA_ERROR;
+      }
       vector<hsize_t> dims(rank);
       dataspace.getSimpleExtentDims(dims.data(), NULL);
       int x = dims[0];
@@ -211,6 +392,10 @@ namespace lignumvtk{
       dataset.read(v.data(), PredType::NATIVE_DOUBLE);
       vector<double> v_attr;
       readDataSetAttribute(dataset_name,VB_EDGE_SIZE_NAME,v_attr);
+      if (v_attr.size() < 3){
+	cout << "Dataset " << dataset_name << " has no voxel edge sizes " << VB_EDGE_SIZE_NAME <<endl;
+	return GRID_DATA_ERROR;
+      }
       std::tuple<int,int,int,int> data_dim(x,y,z,d);
       std::tuple<double,double,double> edge_dim(v_attr[0],v_attr[1],v_attr[2]);
       GridData grid_data(data_dim,edge_dim);
@@ -225,4 +410,122 @@ namespace lignumvtk{
     return GRID_DATA_ERROR;
   }
     
+  bool HDF5ToVoxelSpace::isVoxelSpace(const string& dataset_name)
+  {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    try{
+      Exception::dontPrint();
+      DataSet dataset = hdf5_file.openDataSet(dataset_name);
+      if (dataset.getSpace().getSimpleExtentNdims() != 4 || !dataset.attrExists(VB_EDGE_SIZE_NAME)){
+	return false;
+      }
+      Attribute attr = dataset.openAttribute(VB_EDGE_SIZE_NAME);
+      return attr.getSpace().getSimpleExtentNpoints() >= 3;
+    }
+    catch (H5::Exception e){
+      return false;
+    }
+  }
+
+  const GridData HDF5ToVoxelSpace::getVoxelSpaceGrid(const string& dataset_name)
+  {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    try{
+      Exception::dontPrint();
+      DataSet dataset = hdf5_file.openDataSet(dataset_name);
+      DataSpace dataspace = dataset.getSpace();
+      int rank = dataspace.getSimpleExtentNdims(); // Should be 4
+      if (rank != 4){
+	cout << "Dataset " << dataset_name << " is not a voxel space, rank " << rank <<endl;
+	return GRID_DATA_ERROR;
+      }
+      vector<hsize_t> dims(rank);
+      dataspace.getSimpleExtentDims(dims.data(), NULL);
+      vector<double> v_attr;
+      readDataSetAttribute(dataset_name,VB_EDGE_SIZE_NAME,v_attr);
+      if (v_attr.size() < 3){
+	cout << "Dataset " << dataset_name << " has no voxel edge sizes " << VB_EDGE_SIZE_NAME <<endl;
+	return GRID_DATA_ERROR;
+      }
+      std::tuple<int,int,int,int> data_dim(dims[0],dims[1],dims[2],dims[3]);
+      std::tuple<double,double,double> edge_dim(v_attr[0],v_attr[1],v_attr[2]);
+      return GridData(data_dim,edge_dim);
+    }
+    catch (H5::FileIException e){
+      cout << "Could not open dataset: " << dataset_name <<endl;
+    }
+    catch (H5::AttributeIException e){
+      cout << "Could not open attribute: " << VB_EDGE_SIZE_NAME << endl;
+    }
+    return GRID_DATA_ERROR;
+  }
+
+  const GridData HDF5ToVoxelSpace::getVoxelSpace(const string& dataset_name,const VoxelSelection& selection,vector<double>& v)
+  {
+    std::lock_guard<std::recursive_mutex> lock(hdf5_mutex);
+    try{
+      Exception::dontPrint();
+      DataSet dataset = hdf5_file.openDataSet(dataset_name);
+      DataSpace file_space = dataset.getSpace();
+      if (file_space.getSimpleExtentNdims() != 4){
+	cout << "Dataset " << dataset_name << " is not a voxel space" <<endl;
+	return GRID_DATA_ERROR;
+      }
+      vector<hsize_t> dims(4);
+      file_space.getSimpleExtentDims(dims.data(), NULL);
+      for (int i = 0; i < 3; i++){
+	if (selection.count[i] == 0 || selection.stride == 0 ||
+	    selection.start[i]+(selection.count[i]-1)*selection.stride >= dims[i]){
+	  cout << "Voxel selection outside dataset " << dataset_name << " in dimension " << i <<endl;
+	  return GRID_DATA_ERROR;
+	}
+      }
+      hsize_t start[4]={selection.start[0],selection.start[1],selection.start[2],0};
+      hsize_t count[4]={selection.count[0],selection.count[1],selection.count[2],dims[3]};
+      hsize_t stride[4]={selection.stride,selection.stride,selection.stride,1};
+      if (selection.columns.empty()){
+	//All data columns
+	file_space.selectHyperslab(H5S_SELECT_SET,count,start,stride);
+      }
+      else{
+	//Union of one column hyperslabs, ascending columns keep the order in memory
+	count[3] = 1;
+	file_space.selectNone();
+	for (hsize_t column : selection.columns){
+	  if (column >= dims[3]){
+	    cout << "Data column " << column << " outside dataset " << dataset_name <<endl;
+	    return GRID_DATA_ERROR;
+	  }
+	  start[3] = column;
+	  file_space.selectHyperslab(H5S_SELECT_OR,count,start,stride);
+	}
+	count[3] = selection.columns.size();
+      }
+      DataSpace mem_space(4,count);
+      v.resize(count[0]*count[1]*count[2]*count[3]);
+      dataset.read(v.data(),PredType::NATIVE_DOUBLE,mem_space,file_space);
+      vector<double> v_attr;
+      readDataSetAttribute(dataset_name,VB_EDGE_SIZE_NAME,v_attr);
+      if (v_attr.size() < 3){
+	cout << "Dataset " << dataset_name << " has no voxel edge sizes " << VB_EDGE_SIZE_NAME <<endl;
+	return GRID_DATA_ERROR;
+      }
+      std::tuple<int,int,int,int> data_dim(count[0],count[1],count[2],count[3]);
+      std::tuple<double,double,double> edge_dim(v_attr[0],v_attr[1],v_attr[2]);
+      return GridData(data_dim,edge_dim);
+    }
+    catch (H5::FileIException e){
+      cout << "Could not open dataset: " << dataset_name <<endl;
+    }
+    catch (H5::DataSpaceIException e){
+      cout << "Could not select voxels in dataset: " << dataset_name <<endl;
+    }
+    catch (H5::DataSetIException e){
+      cout << "Could not read voxels from dataset: " << dataset_name <<endl;
+    }
+    catch (H5::AttributeIException e){
+      cout << "Could not open attribute: " << VB_EDGE_SIZE_NAME << endl;
+    }
+    return GRID_DATA_ERROR;
+  }
 }
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <HDF5TreeColumns.h>
+
+namespace lignumvtk{
+
+  ///\brief HDF5 compound type for SegmentRow
+  static H5::CompType SegmentRowType()
+  {
+    H5::CompType type(sizeof(SegmentRow));
+    type.insertMember("axis",HOFFSET(SegmentRow,axis),H5::PredType::NATIVE_INT32);
+    type.insertMember("parent",HOFFSET(SegmentRow,parent),H5::PredType::NATIVE_INT32);
+    type.insertMember("x",HOFFSET(SegmentRow,x),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("y",HOFFSET(SegmentRow,y),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("z",HOFFSET(SegmentRow,z),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("dx",HOFFSET(SegmentRow,dx),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("dy",HOFFSET(SegmentRow,dy),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("dz",HOFFSET(SegmentRow,dz),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("L",HOFFSET(SegmentRow,L),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("R",HOFFSET(SegmentRow,R),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Rh",HOFFSET(SegmentRow,Rh),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Rf",HOFFSET(SegmentRow,Rf),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Wf",HOFFSET(SegmentRow,Wf),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Qin",HOFFSET(SegmentRow,Qin),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Qabs",HOFFSET(SegmentRow,Qabs),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("P",HOFFSET(SegmentRow,P),H5::PredType::NATIVE_DOUBLE);
+    return type;
+  }
+
+  ///\brief HDF5 compound type for AxisRow
+  static H5::CompType AxisRowType()
+  {
+    H5::CompType type(sizeof(AxisRow));
+    type.insertMember("first",HOFFSET(AxisRow,first),H5::PredType::NATIVE_INT32);
+    type.insertMember("count",HOFFSET(AxisRow,count),H5::PredType::NATIVE_INT32);
+    type.insertMember("from_bud",HOFFSET(AxisRow,from_bud),H5::PredType::NATIVE_INT32);
+    type.insertMember("total_length",HOFFSET(AxisRow,total_length),H5::PredType::NATIVE_DOUBLE);
+    return type;
+  }
+
+  ///\brief HDF5 compound type for LeafRow
+  static H5::CompType LeafRowType()
+  {
+    const hsize_t point_dims[1] = {3};
+    const hsize_t vertex_dims[2] = {TREE_COLUMNS_LEAF_VERTICES,3};
+    H5::ArrayType point_type(H5::PredType::NATIVE_DOUBLE,1,point_dims);
+    H5::ArrayType vertex_type(H5::PredType::NATIVE_DOUBLE,2,vertex_dims);
+    H5::CompType type(sizeof(LeafRow));
+    type.insertMember("petiole_start",HOFFSET(LeafRow,petiole_start),point_type);
+    type.insertMember("petiole_end",HOFFSET(LeafRow,petiole_end),point_type);
+    type.insertMember("vertices",HOFFSET(LeafRow,vertices),vertex_type);
+    type.insertMember("A",HOFFSET(LeafRow,A),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Qin",HOFFSET(LeafRow,Qin),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("Qabs",HOFFSET(LeafRow,Qabs),H5::PredType::NATIVE_DOUBLE);
+    type.insertMember("P",HOFFSET(LeafRow,P),H5::PredType::NATIVE_DOUBLE);
+    return type;
+  }
+
+  ///\brief Write rows as chunked and compressed one dimensional dataset
+  template <class ROW>
+  static void WriteRows(H5::Group& group,const std::string& name,const H5::CompType& type,const std::vector<ROW>& rows)
+  {
+    const hsize_t dims[1] = {rows.size()};
+    H5::DataSpace space(1,dims);
+    H5::DSetCreatPropList plist;
+    //Empty datasets cannot be chunked
+    if (!rows.empty()){
+      const hsize_t chunk[1] = {std::min<hsize_t>(rows.size(),TREE_COLUMNS_CHUNK_ROWS)};
+      plist.setChunk(1,chunk);
+      plist.setShuffle();
+      plist.setDeflate(TREE_COLUMNS_DEFLATE_LEVEL);
+    }
+    H5::DataSet dataset = group.createDataSet(name,type,space,plist);
+    if (!rows.empty()){
+      dataset.write(rows.data(),type);
+    }
+  }
+
+  ///\brief Read one dimensional dataset of rows
+  ///\return true if the rows are read, false if the dataset is not one dimensional or the stored rows are not \p type
+  template <class ROW>
+  static bool ReadRows(const H5::Group& group,const std::string& name,const H5::CompType& type,std::vector<ROW>& rows)
+  {
+    H5::DataSet dataset = group.openDataSet(name);
+    H5::DataSpace space = dataset.getSpace();
+    if (space.getSimpleExtentNdims() != 1){
+      std::cout << "Dataset " << name << " rank " << space.getSimpleExtentNdims() << ", expected 1" << std::endl;
+      return false;
+    }
+    if (dataset.getTypeClass() != H5T_COMPOUND){
+      std::cout << "Dataset " << name << " is not a compound dataset" << std::endl;
+      return false;
+    }
+    if (dataset.getCompType().getSize() != type.getSize()){
+      std::cout << "Dataset " << name << " row size " << dataset.getCompType().getSize() << ", expected "
+		<< type.getSize() << std::endl;
+      return false;
+    }
+    hsize_t dims[1] = {0};
+    space.getSimpleExtentDims(dims,NULL);
+    rows.resize(dims[0]);
+    if (!rows.empty()){
+      dataset.read(rows.data(),type);
+    }
+    return true;
+  }
+
+  bool TreeColumnsWriter::open(const std::string& file_name)
+  {
+    try{
+      H5::Exception::dontPrint();
+      file = H5::H5File(file_name,H5F_ACC_TRUNC);
+      //Group path without the trailing slash
+      H5::Group main_group = file.createGroup(TREE_COLUMNS_GROUP.substr(0,TREE_COLUMNS_GROUP.size()-1));
+      H5::DataSpace scalar(H5S_SCALAR);
+      H5::Attribute version = main_group.createAttribute(TREE_COLUMNS_VERSION_ATTRIBUTE,H5::PredType::NATIVE_INT,scalar);
+      version.write(H5::PredType::NATIVE_INT,&TREE_COLUMNS_VERSION);
+    }
+    catch (H5::Exception e){
+      std::cout << "TreeColumnsWriter: Cannot create HDF5 file " << file_name << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool TreeColumnsWriter::addTree(int year,const std::string& tree_id,const CollectedTree& ct)
+  {
+    if (ct.leaves.size() != ct.petioles.size()){
+      std::cout << "TreeColumnsWriter: " << ct.leaves.size() << " leaves and " << ct.petioles.size()
+		<< " petioles in " << tree_id << std::endl;
+      return false;
+    }
+    std::vector<AxisRow> axes;
+    std::vector<SegmentRow> segments;
+    axes.reserve(ct.segments.size());
+    //Points of the axes written so far, a branch starts from a point in its mother axis
+    std::map<std::tuple<double,double,double>,std::int32_t> point_rows;
+    for (const TSData& data : ct.segments){
+      AxisRow axis;
+      axis.first = segments.size();
+      axis.count = data.vpoints.size();
+      axis.from_bud = data.from_bud ? 1 : 0;
+      axis.total_length = data.total_length;
+      for (unsigned int j = 0; j < data.vpoints.size(); j++){
+	const Point& p = data.vpoints[j];
+	SegmentRow row;
+	row.axis = axes.size();
+	row.parent = -1;
+	if (j > 0){
+	  row.parent = segments.size() - 1;
+	}
+	else{
+	  auto it = point_rows.find(std::make_tuple(p.getX(),p.getY(),p.getZ()));
+	  if (it != point_rows.end()){
+	    row.parent = it->second;
+	  }
+	}
+	row.x = p.getX();
+	row.y = p.getY();
+	row.z = p.getZ();
+	//Direction to the next point, the tip point has the direction of the segment below
+	row.dx = 0.0;
+	row.dy = 0.0;
+	row.dz = 1.0;
+	if (j + 1 < data.vpoints.size()){
+	  const Point& next = data.vpoints[j+1];
+	  const double d[3] = {next.getX()-p.getX(),next.getY()-p.getY(),next.getZ()-p.getZ()};
+	  const double length = std::sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]);
+	  if (length > 0.0){
+	    row.dx = d[0]/length;
+	    row.dy = d[1]/length;
+	    row.dz = d[2]/length;
+	  }
+	}
+	else if (j > 0){
+	  row.dx = segments.back().dx;
+	  row.dy = segments.back().dy;
+	  row.dz = segments.back().dz;
+	}
+	row.L = data.vL[j];
+	row.R = data.vR[j];
+	row.Rh = data.vRh[j];
+	row.Rf = data.vRf[j];
+	row.Wf = data.vWf[j];
+	row.Qin = data.vQin[j];
+	row.Qabs = data.vQabs[j];
+	row.P = data.vP[j];
+	segments.push_back(row);
+      }
+      const std::size_t last = static_cast<std::size_t>(axis.first) + static_cast<std::size_t>(axis.count);
+      for (std::size_t r = static_cast<std::size_t>(axis.first); r < last; r++){
+	point_rows.emplace(std::make_tuple(segments[r].x,segments[r].y,segments[r].z),r);
+      }
+      axes.push_back(axis);
+    }
+    std::vector<LeafRow> leaves;
+    leaves.reserve(ct.leaves.size());
+    for (unsigned int i = 0; i < ct.leaves.size(); i++){
+      const TSData& petiole = ct.petioles[i];
+      const TSData& leaf = ct.leaves[i];
+      if (leaf.vpoints.size() != TREE_COLUMNS_LEAF_VERTICES || petiole.vpoints.size() != 2){
+	std::cout << "TreeColumnsWriter: Only kite leaves are supported, " << tree_id << " not written" << std::endl;
+	return false;
+      }
+      LeafRow row;
+      const Point& ps = petiole.vpoints[0];
+      const Point& pe = petiole.vpoints[1];
+      row.petiole_start[0] = ps.getX();
+      row.petiole_start[1] = ps.getY();
+      row.petiole_start[2] = ps.getZ();
+      row.petiole_end[0] = pe.getX();
+      row.petiole_end[1] = pe.getY();
+      row.petiole_end[2] = pe.getZ();
+      for (int k = 0; k < TREE_COLUMNS_LEAF_VERTICES; k++){
+	row.vertices[k][0] = leaf.vpoints[k].getX();
+	row.vertices[k][1] = leaf.vpoints[k].getY();
+	row.vertices[k][2] = leaf.vpoints[k].getZ();
+      }
+      //The leaf values are the same for all corner points
+      row.A = leaf.vA[0];
+      row.Qin = leaf.vQin[0];
+      row.Qabs = leaf.vQabs[0];
+      row.P = leaf.vP[0];
+      leaves.push_back(row);
+    }
+    try{
+      H5::Exception::dontPrint();
+      const std::string year_group = TREE_COLUMNS_GROUP+std::to_string(year);
+      if (!file.nameExists(year_group)){
+	file.createGroup(year_group);
+      }
+      H5::Group group = file.createGroup(year_group+"/"+tree_id);
+      H5::StrType str_type(H5::PredType::C_S1,H5T_VARIABLE);
+      H5::DataSpace scalar(H5S_SCALAR);
+      H5::Attribute type = group.createAttribute(TREE_COLUMNS_SEGMENT_TYPE,str_type,scalar);
+      type.write(str_type,ct.tree_type);
+      WriteRows(group,TREE_COLUMNS_AXES,AxisRowType(),axes);
+      WriteRows(group,TREE_COLUMNS_SEGMENTS,SegmentRowType(),segments);
+      WriteRows(group,TREE_COLUMNS_LEAVES,LeafRowType(),leaves);
+    }
+    catch (H5::Exception e){
+      std::cout << "TreeColumnsWriter: Cannot write tree " << tree_id << " for year " << year << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void TreeColumnsWriter::close()
+  {
+    file.close();
+  }
+
+  bool CheckTreeColumnsVersion(const H5::H5File& file)
+  {
+    int version = 0;
+    try{
+      H5::Exception::dontPrint();
+      //Group path without the trailing slash
+      H5::Group main_group = file.openGroup(TREE_COLUMNS_GROUP.substr(0,TREE_COLUMNS_GROUP.size()-1));
+      H5::Attribute attribute = main_group.openAttribute(TREE_COLUMNS_VERSION_ATTRIBUTE);
+      attribute.read(H5::PredType::NATIVE_INT,&version);
+    }
+    catch (H5::Exception e){
+      std::cout << "Could not read " << TREE_COLUMNS_VERSION_ATTRIBUTE << " in " << file.getFileName() << std::endl;
+      return false;
+    }
+    if (version > TREE_COLUMNS_VERSION){
+      std::cout << TREE_COLUMNS_VERSION_ATTRIBUTE << " " << version << " in " << file.getFileName()
+		<< " is newer than the supported version " << TREE_COLUMNS_VERSION << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool ReadTreeColumns(const H5::H5File& file,const std::string& tree_path,CollectedTree& ct)
+  {
+    std::vector<AxisRow> axes;
+    std::vector<SegmentRow> segments;
+    std::vector<LeafRow> leaves;
+    try{
+      H5::Exception::dontPrint();
+      H5::Group group = file.openGroup(tree_path);
+      H5::Attribute type = group.openAttribute(TREE_COLUMNS_SEGMENT_TYPE);
+      H5::StrType str_type(H5::PredType::C_S1,H5T_VARIABLE);
+      type.read(str_type,ct.tree_type);
+      if (ct.tree_type != "Cf" && ct.tree_type != "Hw"){
+	std::cout << "Tree columns " << tree_path << ": " << TREE_COLUMNS_SEGMENT_TYPE << " " << ct.tree_type
+		  << ", expected Cf or Hw" << std::endl;
+	return false;
+      }
+      if (!(ReadRows(group,TREE_COLUMNS_AXES,AxisRowType(),axes) &&
+	    ReadRows(group,TREE_COLUMNS_SEGMENTS,SegmentRowType(),segments) &&
+	    ReadRows(group,TREE_COLUMNS_LEAVES,LeafRowType(),leaves))){
+	std::cout << "Could not read tree columns: " << tree_path << std::endl;
+	return false;
+      }
+    }
+    catch (H5::Exception e){
+      std::cout << "Could not read tree columns: " << tree_path << std::endl;
+      return false;
+    }
+    ct.tree_id = tree_path;
+    ct.segments.clear();
+    ct.petioles.clear();
+    ct.leaves.clear();
+    ct.segments.reserve(axes.size());
+    for (const AxisRow& axis : axes){
+      if (axis.first < 0 || axis.count < 0 ||
+	  static_cast<std::size_t>(axis.first) + static_cast<std::size_t>(axis.count) > segments.size()){
+	std::cout << "Axis rows outside Segments in " << tree_path << std::endl;
+	return false;
+      }
+      TSData data;
+      data.from_bud = axis.from_bud != 0;
+      data.total_length = axis.total_length;
+      data.vpoints.reserve(axis.count);
+      const std::size_t last = static_cast<std::size_t>(axis.first) + static_cast<std::size_t>(axis.count);
+      for (std::size_t r = static_cast<std::size_t>(axis.first); r < last; r++){
+	const SegmentRow& row = segments[r];
+	data.vpoints.push_back(Point(row.x,row.y,row.z));
+	data.vL.push_back(row.L);
+	data.vR.push_back(row.R);
+	data.vRh.push_back(row.Rh);
+	data.vRf.push_back(row.Rf);
+	data.vWf.push_back(row.Wf);
+	data.vQin.push_back(row.Qin);
+	data.vQabs.push_back(row.Qabs);
+	data.vP.push_back(row.P);
+	data.vname.push_back(TUBE_RADIUS_SCALAR);
+      }
+      ct.segments.push_back(std::move(data));
+    }
+    //Petioles and leaves as in CollectPetioleData and CollectLeafData
+    ct.petioles.reserve(leaves.size());
+    ct.leaves.reserve(leaves.size());
+    for (const LeafRow& row : leaves){
+      TSData petiole;
+      petiole.vpoints.push_back(Point(row.petiole_start[0],row.petiole_start[1],row.petiole_start[2]));
+      petiole.vpoints.push_back(Point(row.petiole_end[0],row.petiole_end[1],row.petiole_end[2]));
+      petiole.vR.push_back(LINE_WIDTH);
+      petiole.vR.push_back(LINE_WIDTH);
+      petiole.vname.push_back(LINE_WIDTH_SCALAR);
+      petiole.vname.push_back(LINE_WIDTH_SCALAR);
+      ct.petioles.push_back(std::move(petiole));
+      TSData leaf;
+      for (int k = 0; k < TREE_COLUMNS_LEAF_VERTICES; k++){
+	leaf.vpoints.push_back(Point(row.vertices[k][0],row.vertices[k][1],row.vertices[k][2]));
+	leaf.vA.push_back(row.A);
+	leaf.vQin.push_back(row.Qin);
+	leaf.vQabs.push_back(row.Qabs);
+	leaf.vP.push_back(row.P);
+	leaf.vname.push_back(LEAF_AREA_SCALAR);
+      }
+      ct.leaves.push_back(std::move(leaf));
+    }
+    return true;
+  }
+}
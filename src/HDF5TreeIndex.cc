@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <AtomicFile.h>
+#include <HDF5ToLignum.h>
+#include <HDF5TreeIndex.h>
+
+namespace lignumvtk{
+
+  bool FileStamp(const std::string& file_name,std::uintmax_t& size,std::int64_t& mtime)
+  {
+    std::error_code error;
+    size = std::filesystem::file_size(file_name,error);
+    if (error){
+      return false;
+    }
+    mtime = std::filesystem::last_write_time(file_name,error).time_since_epoch().count();
+    return !error;
+  }
+
+  void HDF5TreeIndex::insert(int year,const std::string& tree_id,const std::string& main_group)
+  {
+    const std::size_t i = datasets.size();
+    datasets.push_back(TreeDataSet{year,tree_id,main_group+std::to_string(year)+"/"+tree_id});
+    by_year_tree[key(year,tree_id)] = i;
+    by_tree[tree_id].push_back(i);
+    by_year[year].push_back(i);
+  }
+
+  std::size_t HDF5TreeIndex::build(HDF5Base& hdf5,const std::string& main_group)
+  {
+    datasets.clear();
+    by_year_tree.clear();
+    by_tree.clear();
+    by_year.clear();
+    std::vector<std::pair<int,std::string>> years;
+    for (const std::string& name : hdf5.getGroupMembers(main_group)){
+      char* end = nullptr;
+      const long year = std::strtol(name.c_str(),&end,10);
+      //Year groups only
+      if (end != name.c_str() && *end == '\0'){
+	years.push_back(std::make_pair(static_cast<int>(year),name));
+      }
+    }
+    std::sort(years.begin(),years.end());
+    for (const auto& [year,name] : years){
+      for (const std::string& tree_id : hdf5.getGroupMembers(main_group+name+"/")){
+	insert(year,tree_id,main_group);
+      }
+    }
+    return datasets.size();
+  }
+
+  bool HDF5TreeIndex::load(const std::string& index_file,const std::string& hdf5_file,const std::string& main_group)
+  {
+    std::ifstream in(index_file);
+    if (!in){
+      return false;
+    }
+    std::string header;
+    std::getline(in,header);
+    std::uintmax_t size = 0;
+    std::int64_t mtime = 0;
+    std::uintmax_t index_size = 0;
+    std::int64_t index_mtime = 0;
+    std::size_t n = 0;
+    if (header != TREE_INDEX_HEADER || !(in >> index_size >> index_mtime >> n)){
+      std::cout << "Index file " << index_file << " not valid, ignored" << std::endl;
+      return false;
+    }
+    if (!FileStamp(hdf5_file,size,mtime) || size != index_size || mtime != index_mtime){
+      std::cout << "Index file " << index_file << " is older than " << hdf5_file << ", ignored" << std::endl;
+      return false;
+    }
+    datasets.clear();
+    by_year_tree.clear();
+    by_tree.clear();
+    by_year.clear();
+    datasets.reserve(n);
+    int year = 0;
+    std::string tree_id;
+    for (std::size_t i = 0; i < n; i++){
+      if (!(in >> year) || !(in >> std::ws) || !std::getline(in,tree_id)){
+	std::cout << "Index file " << index_file << " truncated, ignored" << std::endl;
+	return false;
+      }
+      insert(year,tree_id,main_group);
+    }
+    return true;
+  }
+
+  bool HDF5TreeIndex::save(const std::string& index_file,const std::string& hdf5_file)const
+  {
+    std::uintmax_t size = 0;
+    std::int64_t mtime = 0;
+    if (!FileStamp(hdf5_file,size,mtime)){
+      std::cout << "Cannot read file size and time of " << hdf5_file << std::endl;
+      return false;
+    }
+    //Readers never see a partially written index
+    const bool written = WriteFileAtomically(index_file,[&](const std::string& tmp_file){
+      std::ofstream out(tmp_file);
+      if (!out){
+	std::cout << "Cannot open index file " << tmp_file << " for writing" << std::endl;
+	return false;
+      }
+      out << TREE_INDEX_HEADER << "\n" << size << " " << mtime << "\n" << datasets.size() << "\n";
+      for (const TreeDataSet& dataset : datasets){
+	out << dataset.year << " " << dataset.tree_id << "\n";
+      }
+      out.close();
+      return !out.fail();
+    });
+    if (!written){
+      std::cout << "Cannot write index file " << index_file << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  const TreeDataSet* HDF5TreeIndex::find(int year,const std::string& tree_id)const
+  {
+    auto it = by_year_tree.find(key(year,tree_id));
+    if (it == by_year_tree.end()){
+      return nullptr;
+    }
+    return &datasets[it->second];
+  }
+
+  std::vector<int> HDF5TreeIndex::getYears()const
+  {
+    std::vector<int> years;
+    for (const auto& item : by_year){
+      years.push_back(item.first);
+    }
+    return years;
+  }
+
+  std::vector<std::string> HDF5TreeIndex::getYear(int year)const
+  {
+    std::vector<std::string> v;
+    auto it = by_year.find(year);
+    if (it != by_year.end()){
+      for (std::size_t i : it->second){
+	v.push_back(datasets[i].path);
+      }
+    }
+    return v;
+  }
+
+  std::vector<std::string> HDF5TreeIndex::getTree(const std::string& tree_id)const
+  {
+    std::vector<std::string> v;
+    auto it = by_tree.find(tree_id);
+    if (it != by_tree.end()){
+      for (std::size_t i : it->second){
+	v.push_back(datasets[i].path);
+      }
+    }
+    return v;
+  }
+
+  std::vector<std::string> HDF5TreeIndex::getAll()const
+  {
+    std::vector<std::string> v;
+    v.reserve(datasets.size());
+    for (const TreeDataSet& dataset : datasets){
+      v.push_back(dataset.path);
+    }
+    return v;
+  }
+
+  std::vector<std::string> HDF5TreeIndex::select(int year,const std::string& dataset,const std::string& substring)const
+  {
+    if (year >= 0){
+      return getYear(year);
+    }
+    std::vector<std::string> v;
+    if (!dataset.empty()){
+      std::string::size_type slash = dataset.rfind('/');
+      if (slash == std::string::npos){
+	//Tree in all years
+	return getTree(dataset);
+      }
+      //Path ending with year/tree, e.g. /TreeXML/60/Tree_8
+      const std::string tree_id = dataset.substr(slash+1);
+      std::string::size_type year_begin = (slash == 0) ? std::string::npos : dataset.rfind('/',slash-1);
+      year_begin = (year_begin == std::string::npos) ? 0 : year_begin+1;
+      char* end = nullptr;
+      const std::string year_name = dataset.substr(year_begin,slash-year_begin);
+      const long y = std::strtol(year_name.c_str(),&end,10);
+      if (!year_name.empty() && *end == '\0'){
+	const TreeDataSet* d = find(static_cast<int>(y),tree_id);
+	if (d != nullptr && d->path.size() >= dataset.size()
+	    && d->path.compare(d->path.size()-dataset.size(),dataset.size(),dataset) == 0){
+	  v.push_back(d->path);
+	}
+      }
+      return v;
+    }
+    for (const TreeDataSet& d : datasets){
+      if (substring.empty() || d.path.find(substring) != std::string::npos){
+	v.push_back(d.path);
+      }
+    }
+    return v;
+  }
+}
@@ -0,0 +1,78 @@
+#include <utility>
+#include <HDF5TreePrefetch.h>
+namespace lignumvtk{
+
+  HDF5TreePrefetcher::HDF5TreePrefetcher(HDF5ToLignum& h5lignum,const std::vector<std::string>& v,unsigned int n)
+    :hdf5lignum(h5lignum),paths(v),depth(n),consumed(0),stop(false)
+  {
+    if (depth > 0 && paths.size() > 1){
+      reader = std::thread(&HDF5TreePrefetcher::run,this);
+    }
+  }
+
+  HDF5TreePrefetcher::~HDF5TreePrefetcher()
+  {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      stop = true;
+    }
+    not_full.notify_all();
+    if (reader.joinable()){
+      reader.join();
+    }
+  }
+
+  void HDF5TreePrefetcher::read(const std::string& path,PrefetchedTree& tree)
+  {
+    tree.path = path;
+    if (hdf5lignum.hasTreeColumns()){
+      tree.ok = hdf5lignum.getCollectedTree(path,tree.ct);
+    }
+    else{
+      tree.lignum_string = hdf5lignum.getLignumTreeString(path);
+      tree.ok = !tree.lignum_string.empty();
+    }
+  }
+
+  void HDF5TreePrefetcher::run()
+  {
+    for (const std::string& path : paths){
+      {
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	not_full.wait(lock,[this](){return stop || queue.size() < depth;});
+	if (stop){
+	  return;
+	}
+      }
+      //Read outside the queue lock so that the consumer can take the trees already read
+      PrefetchedTree tree;
+      read(path,tree);
+      {
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	queue.push_back(std::move(tree));
+      }
+      not_empty.notify_one();
+    }
+  }
+
+  bool HDF5TreePrefetcher::next(PrefetchedTree& tree)
+  {
+    if (consumed >= paths.size()){
+      return false;
+    }
+    if (!reader.joinable()){
+      tree = PrefetchedTree();
+      read(paths[consumed++],tree);
+      return true;
+    }
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      not_empty.wait(lock,[this](){return !queue.empty();});
+      tree = std::move(queue.front());
+      queue.pop_front();
+    }
+    consumed++;
+    not_full.notify_one();
+    return true;
+  }
+}
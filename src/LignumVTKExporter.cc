@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <filesystem>
+#include <CreateVTPCFile.h>
+#include <LignumVTKExporter.h>
+namespace lignumvtk{
+
+  LignumVTKExporter::LignumVTKExporter(const std::string& file_name,int resolution,int v,std::size_t n,int sides)
+    :pvd_file(file_name),spline_resolution(resolution),view(v),nsides(sides),max_pending(std::max<std::size_t>(n,1)),
+     nyears(0),failed(0),stop(false)
+  {
+    writer = std::thread(&LignumVTKExporter::run,this);
+  }
+
+  LignumVTKExporter::~LignumVTKExporter()
+  {
+    finish();
+  }
+
+  LignumVTKExporter& LignumVTKExporter::addTree(CollectedTree& ct)
+  {
+    stand.push_back(std::move(ct));
+    return *this;
+  }
+
+  bool LignumVTKExporter::writeYear(int year)
+  {
+    if (stand.empty()){
+      cout << "LignumVTKExporter: no trees for year " << year <<endl;
+      return false;
+    }
+    {
+      //The simulation waits only if the writer is max_pending years behind
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      not_full.wait(lock,[this](){return stop || queue.size() < max_pending;});
+      if (stop){
+	cout << "LignumVTKExporter: finished, year " << year << " not written" <<endl;
+	return false;
+      }
+      queue.emplace_back(year,std::move(stand));
+    }
+    stand = CollectedStand();
+    not_empty.notify_one();
+    return true;
+  }
+
+  bool LignumVTKExporter::finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      stop = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+    if (writer.joinable()){
+      writer.join();
+    }
+    return failed == 0;
+  }
+
+  std::size_t LignumVTKExporter::getNumberOfYears()
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return nyears;
+  }
+
+  bool LignumVTKExporter::write(int year,CollectedStand& year_stand)
+  {
+    const string year_file = YearVTPCFileName(pvd_file,year);
+    if (CreateVTPCFileFromStand(year_stand,year_file,spline_resolution,view,nsides) == EXIT_FAILURE){
+      return false;
+    }
+    //PVD refers to data files relative to its own location
+    pvd.addDataSet(year,std::filesystem::path(year_file).filename().string());
+    return pvd.write(pvd_file);
+  }
+
+  void LignumVTKExporter::run()
+  {
+    while (true){
+      std::pair<int,CollectedStand> year_stand;
+      {
+	//Queued years are written before stopping
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	not_empty.wait(lock,[this](){return stop || !queue.empty();});
+	if (queue.empty()){
+	  return;
+	}
+	year_stand = std::move(queue.front());
+	queue.pop_front();
+      }
+      not_full.notify_one();
+      const bool ok = write(year_stand.first,year_stand.second);
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      if (ok){
+	nyears++;
+      }
+      else{
+	cout << "LignumVTKExporter: cannot write year " << year_stand.first <<endl;
+	failed++;
+      }
+    }
+  }
+}
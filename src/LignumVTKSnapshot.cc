@@ -0,0 +1,256 @@
+#include <cstring>
+#include <iostream>
+#include <LignumVTKSnapshot.h>
+
+namespace lignumvtk{
+
+  ///\brief Padding to the next 8 byte boundary
+  inline std::size_t SnapshotPadding(std::size_t n)
+  {
+    return (8 - n % 8) % 8;
+  }
+
+  TSDataSnapshotWriter::~TSDataSnapshotWriter()
+  {
+    if (out.is_open()){
+      close();
+    }
+  }
+
+  bool TSDataSnapshotWriter::open(const std::string& file_name)
+  {
+    out.open(file_name,std::ios::binary|std::ios::trunc);
+    if (!out){
+      std::cout << "Cannot open snapshot file " << file_name << std::endl;
+      return false;
+    }
+    ntrees = 0;
+    out.write(SNAPSHOT_MAGIC.data(),8);
+    writeUInt(SNAPSHOT_BYTE_ORDER);
+    writeUInt(SNAPSHOT_VERSION);
+    //Number of trees, updated in close()
+    writeUInt(ntrees);
+    return true;
+  }
+
+  TSDataSnapshotWriter& TSDataSnapshotWriter::addTree(const CollectedTree& ct)
+  {
+    writeString(ct.tree_id);
+    writeString(ct.tree_type);
+    writeTSDataVector(ct.segments);
+    writeTSDataVector(ct.petioles);
+    writeTSDataVector(ct.leaves);
+    ntrees++;
+    return *this;
+  }
+
+  bool TSDataSnapshotWriter::close()
+  {
+    //Number of trees follows the magic string, byte order marker and version
+    out.seekp(3*sizeof(std::uint64_t));
+    writeUInt(ntrees);
+    out.close();
+    return !out.fail();
+  }
+
+  void TSDataSnapshotWriter::writeUInt(std::uint64_t i)
+  {
+    out.write(reinterpret_cast<const char*>(&i),sizeof(i));
+  }
+
+  void TSDataSnapshotWriter::writeDouble(double d)
+  {
+    out.write(reinterpret_cast<const char*>(&d),sizeof(d));
+  }
+
+  void TSDataSnapshotWriter::writeString(const std::string& s)
+  {
+    const char zeros[8]={0,0,0,0,0,0,0,0};
+    writeUInt(s.size());
+    out.write(s.data(),s.size());
+    out.write(zeros,SnapshotPadding(s.size()));
+  }
+
+  void TSDataSnapshotWriter::writeDoubles(const std::vector<double>& v)
+  {
+    writeUInt(v.size());
+    out.write(reinterpret_cast<const char*>(v.data()),v.size()*sizeof(double));
+  }
+
+  void TSDataSnapshotWriter::writePoints(const std::vector<cxxadt::Point>& v)
+  {
+    writeUInt(v.size());
+    for (const cxxadt::Point& p : v){
+      writeDouble(p.getX());
+      writeDouble(p.getY());
+      writeDouble(p.getZ());
+    }
+  }
+
+  void TSDataSnapshotWriter::writeTSDataVector(const TSDataVector& v)
+  {
+    writeUInt(v.size());
+    for (const TSData& data : v){
+      writeUInt(data.from_bud ? 1 : 0);
+      writeDouble(data.total_length);
+      writePoints(data.vpoints);
+      writeDoubles(data.vL);
+      writeDoubles(data.vR);
+      writeDoubles(data.vRh);
+      writeDoubles(data.vRf);
+      writeDoubles(data.vWf);
+      writeDoubles(data.vA);
+      writeDoubles(data.vQin);
+      writeDoubles(data.vQabs);
+      writeDoubles(data.vP);
+      //Scalar names are the same for all items in one TSData
+      writeString(data.vname.empty() ? std::string() : data.vname[0]);
+      writeUInt(data.vname.size());
+    }
+  }
+
+  bool TSDataSnapshotReader::open(const std::string& file_name)
+  {
+    offset = 0;
+    ntrees = 0;
+    nread = 0;
+    if (!file.open(file_name)){
+      return false;
+    }
+    if (file.size() < 4*sizeof(std::uint64_t) || std::memcmp(file.data(),SNAPSHOT_MAGIC.data(),8) != 0){
+      std::cout << file_name << " is not a snapshot file" << std::endl;
+      return false;
+    }
+    offset = 8;
+    std::uint64_t byte_order = 0;
+    std::uint64_t version = 0;
+    readUInt(byte_order);
+    readUInt(version);
+    if (byte_order != SNAPSHOT_BYTE_ORDER){
+      std::cout << "Snapshot file " << file_name << " has different byte order" << std::endl;
+      return false;
+    }
+    if (version != SNAPSHOT_VERSION){
+      std::cout << "Snapshot file " << file_name << " version " << version
+		<< " not supported, expected version " << SNAPSHOT_VERSION << std::endl;
+      return false;
+    }
+    return readUInt(ntrees);
+  }
+
+  bool TSDataSnapshotReader::nextTree(CollectedTree& ct)
+  {
+    if (nread >= ntrees){
+      return false;
+    }
+    ct = CollectedTree();
+    bool ok = readString(ct.tree_id) && readString(ct.tree_type) && readTSDataVector(ct.segments)
+      && readTSDataVector(ct.petioles) && readTSDataVector(ct.leaves);
+    if (!ok){
+      std::cout << "Snapshot file truncated at tree " << nread << std::endl;
+      return false;
+    }
+    nread++;
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readUInt(std::uint64_t& i)
+  {
+    if (remaining() < sizeof(i)){
+      return false;
+    }
+    std::memcpy(&i,file.data()+offset,sizeof(i));
+    offset += sizeof(i);
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readDouble(double& d)
+  {
+    if (remaining() < sizeof(d)){
+      return false;
+    }
+    std::memcpy(&d,file.data()+offset,sizeof(d));
+    offset += sizeof(d);
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readString(std::string& s)
+  {
+    std::uint64_t n = 0;
+    if (!readUInt(n) || n > remaining()){
+      return false;
+    }
+    s.assign(file.data()+offset,n);
+    offset += n + SnapshotPadding(n);
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readDoubles(std::vector<double>& v)
+  {
+    std::uint64_t n = 0;
+    if (!readUInt(n) || n > remaining()/sizeof(double)){
+      return false;
+    }
+    //Data is 8 byte aligned in the mapped region
+    const double* begin = reinterpret_cast<const double*>(file.data()+offset);
+    v.assign(begin,begin+n);
+    offset += n*sizeof(double);
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readPoints(std::vector<cxxadt::Point>& v)
+  {
+    std::uint64_t n = 0;
+    if (!readUInt(n) || n > remaining()/(3*sizeof(double))){
+      return false;
+    }
+    const double* xyz = reinterpret_cast<const double*>(file.data()+offset);
+    v.reserve(n);
+    for (std::uint64_t i = 0; i < n; i++){
+      v.push_back(cxxadt::Point(xyz[3*i],xyz[3*i+1],xyz[3*i+2]));
+    }
+    offset += 3*n*sizeof(double);
+    return true;
+  }
+
+  bool TSDataSnapshotReader::readTSDataVector(TSDataVector& v)
+  {
+    std::uint64_t n = 0;
+    //Each TSData takes at least 14 8 byte words: from_bud, total_length, 11 sizes and nnames
+    if (!readUInt(n) || n > remaining()/(14*sizeof(std::uint64_t))){
+      return false;
+    }
+    v.resize(n);
+    for (TSData& data : v){
+      std::uint64_t from_bud = 0;
+      std::string name;
+      std::uint64_t nnames = 0;
+      bool ok = readUInt(from_bud) && readDouble(data.total_length) && readPoints(data.vpoints)
+	&& readDoubles(data.vL) && readDoubles(data.vR) && readDoubles(data.vRh) && readDoubles(data.vRf)
+	&& readDoubles(data.vWf) && readDoubles(data.vA) && readDoubles(data.vQin) && readDoubles(data.vQabs)
+	&& readDoubles(data.vP) && readString(name) && readUInt(nnames);
+      if (!ok){
+	return false;
+      }
+      data.from_bud = (from_bud != 0);
+      data.vname.assign(nnames,name);
+    }
+    return true;
+  }
+
+  bool ReadSnapshot(const std::string& file_name,CollectedStand& stand)
+  {
+    TSDataSnapshotReader reader;
+    if (!reader.open(file_name)){
+      return false;
+    }
+    stand.reserve(stand.size()+reader.getNumberOfTrees());
+    std::uint64_t n = 0;
+    CollectedTree ct;
+    while (reader.nextTree(ct)){
+      stand.push_back(std::move(ct));
+      n++;
+    }
+    return n == reader.getNumberOfTrees();
+  }
+}
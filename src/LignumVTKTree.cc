@@ -30,7 +30,7 @@ namespace lignumvtk{
     vtkPolyData* polydata = fs->GetOutput();
     tf->AddInputData(polydata);
     tf->SetVaryRadiusToVaryRadiusByAbsoluteScalar();
-    tf->SetNumberOfSides(TUBE_NUMBER_OF_SIDES);
+    tf->SetNumberOfSides(nsides);
     tf->CappingOn();
     tf->Update();
     v.push_back(tf);
@@ -175,8 +175,18 @@ namespace lignumvtk{
     return v;
   }
 
-  LignumToVTK::LignumToVTK(int res)
-    :resolution(res)
+  CollectedTree& CollectConiferTree(LignumVTKCfTree& t,const string& tree_id,CollectedTree& ct)
+  {
+    return CollectConiferTree<VTKCfSegment,VTKCfBud>(t,tree_id,ct);
+  }
+
+  CollectedTree& CollectBroadLeafTree(LignumVTKTree& t,const string& tree_id,CollectedTree& ct)
+  {
+    return CollectBroadLeafTree<VTKHwSegment,VTKBud,Kite>(t,tree_id,ct);
+  }
+
+  LignumToVTK::LignumToVTK(int res,int sides)
+    :resolution(res),nsides(sides),written(false)
   {
   }
   
@@ -313,7 +323,7 @@ namespace lignumvtk{
    
   TubeFilterVector& LignumToVTK::createTubeFilters(PFSVector& pfsv, TubeFilterVector& v)const
   {
-    v = accumulate(pfsv.begin(),pfsv.end(),v,CreateVTKTubeFilter());
+    v = accumulate(pfsv.begin(),pfsv.end(),v,CreateVTKTubeFilter(nsides));
     return v;
   }
 
@@ -374,6 +384,35 @@ namespace lignumvtk{
     return partitions;
   }
 
+  int LignumToVTK::addPartitionedDataSet(PolyDataVector& v,const string& block_name)
+  {
+    vtkNew<vtkPartitionedDataSet> dataset_new;
+    int new_partitions = v.size();
+    dataset_new->SetNumberOfPartitions(new_partitions);
+    for (unsigned int i=0; i < new_partitions; i++){
+      dataset_new->SetPartition(i,v[i]);
+    }
+    int partitions = this->dataset_collection->GetNumberOfPartitionedDataSets();    
+    this->dataset_collection->SetPartitionedDataSet(partitions,dataset_new);
+    this->dataset_collection->GetMetaData(static_cast<unsigned int>(partitions))->Set(vtkPartitionedDataSet::NAME(),block_name);
+    return partitions;
+  }
+
+  const string LignumToVTK::getPartitionedDataSetName(int index)const
+  {
+    return string(this->dataset_collection->GetMetaData(static_cast<unsigned int>(index))->Get(vtkPartitionedDataSet::NAME()));
+  }
+
+  PolyDataVector& LignumToVTK::getPartitionedDataSet(int index,PolyDataVector& v)const
+  {
+    vtkPartitionedDataSet* dataset = this->dataset_collection->GetPartitionedDataSet(static_cast<unsigned int>(index));
+    for (unsigned int i=0; i < dataset->GetNumberOfPartitions(); i++){
+      vtkPolyData* polydata = vtkPolyData::SafeDownCast(dataset->GetPartition(i));
+      v.push_back(polydata);
+    }
+    return v;
+  }
+
   LignumToVTK& LignumToVTK::writePartitionedDataSetCollection(const string& file_name,int component_view)
   {
     cout << "PartitionedDataSetCollection file: " << file_name.c_str() << endl;
@@ -384,6 +423,7 @@ namespace lignumvtk{
     if (std::string::npos == n){
       cout << "File name extension should be: " << std::string(ext) <<endl;
     }
+    updateDataAssembly();
     if (component_view){
       dataset_collection->SetDataAssembly(dataset_assembly_component_view);
     }
@@ -392,8 +432,8 @@ namespace lignumvtk{
     cout << "Updating writer" <<endl;
     this->collection_writer->Update();
     cout << "Writing data" <<endl;
-    this->collection_writer->Write();
-    cout << "Write file done" <<endl;
+    written = this->collection_writer->Write() != 0;
+    cout << (written ? "Write file done" : "Write file failed") <<endl;
     return *this;
   }
   
@@ -448,6 +488,133 @@ namespace lignumvtk{
     dataset_assembly_component_view->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),0);
   }
 
+  void CfLignumToVTK::addConiferTreeAssembly(const string& tree_id,int foliage_dataset_index,int ts_rh_dataset_index,int ts_r_dataset_index)
+  {
+    //Update vtkDataAssembly view on the datasets for hierarchy information
+    //Create the tree hierarchy
+    const string valid_tree_id = dataset_assembly->MakeValidNodeName(tree_id.c_str());
+    //Create data assembly view where a tree is a collection of its segments and foliage 
+    //Zero (0) is the root of the tree and the tree becomes next node base on its id tag
+    int tree_node_id = dataset_assembly->AddNode(valid_tree_id.c_str(),0);
+    //Three nodes for foliage and segments of the tree
+    int foliage_node_id = dataset_assembly->AddNode(TREE_SEGMENT_FOLIAGE_BLOCK.c_str(),tree_node_id);
+    int ts_rh_node_id = dataset_assembly->AddNode(TREE_SEGMENT_RH_BLOCK.c_str(),tree_node_id);
+    int ts_r_node_id = dataset_assembly->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),tree_node_id);
+    //Set data assembly node indices to point to foliage and segment dataset indices 
+    dataset_assembly->AddDataSetIndex(foliage_node_id,foliage_dataset_index);
+    dataset_assembly->AddDataSetIndex(ts_rh_node_id,ts_rh_dataset_index);
+    dataset_assembly->AddDataSetIndex(ts_r_node_id,ts_r_dataset_index);
+    ///Three part view to foliage, segments and heartwood 
+    int fol_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_FOLIAGE_BLOCK.c_str());
+    int rh_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_RH_BLOCK.c_str());
+    int r_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_R_BLOCK.c_str());
+    dataset_assembly_component_view->AddDataSetIndex(fol_id,foliage_dataset_index);
+    dataset_assembly_component_view->AddDataSetIndex(rh_id,ts_rh_dataset_index);
+    dataset_assembly_component_view->AddDataSetIndex(r_id,ts_r_dataset_index);
+  }
+
+  TreeDataSetIndices LignumToVTK::createConiferTreeDataSets(CollectedTree& ct,bool add_to_renderer)
+  {
+    //Data collected from the tree
+    TSDataVector& tsv = ct.segments;
+    TubeMapperVector tm_radius_v;
+    tm_radius_v = createTubeMappers(tsv,tm_radius_v,TUBE_RADIUS_SCALAR);
+    TubeMapperVector tm_radius_rh_v;
+    tm_radius_rh_v = createTubeMappers(tsv,tm_radius_rh_v,TUBE_HW_RADIUS_SCALAR);
+    TubeMapperVector tm_foliage_radius_v;
+    tm_foliage_radius_v = createTubeMappers(tsv,tm_foliage_radius_v,TUBE_FOLIAGE_RADIUS_SCALAR);
+    TubeActorVector ta_radius_v;
+    ta_radius_v= createTubeActors(tm_radius_v,ta_radius_v);
+    TubeActorVector ta_radius_rh_v;
+    ta_radius_rh_v = createTubeActors(tm_radius_rh_v,ta_radius_rh_v);
+    TubeActorVector ta_foliage_radius_v;
+    ta_foliage_radius_v = createTubeActors(tm_foliage_radius_v,ta_foliage_radius_v);
+
+    TreeDataSetIndices indices;
+    indices[0] = addPartitionedDataSet(ta_foliage_radius_v,TREE_SEGMENT_FOLIAGE_BLOCK);
+    indices[1] = addPartitionedDataSet(ta_radius_rh_v,TREE_SEGMENT_RH_BLOCK);
+    indices[2] = addPartitionedDataSet(ta_radius_v,TREE_SEGMENT_R_BLOCK);
+    //Deprecated
+    if (add_to_renderer == true){
+      addActorsToRenderer(ta_radius_v);
+      addActorsToRenderer(ta_radius_rh_v);
+      addActorsToRenderer(ta_foliage_radius_v);
+    }
+    return indices;
+  }
+
+  TreeDataSetIndices LignumToVTK::createBroadLeafTreeDataSets(CollectedTree& ct,bool add_to_renderer)
+  {
+    //Data collected from the tree
+    TSDataVector& tsv = ct.segments;
+    TSDataVector& pv = ct.petioles;
+    TSDataVector& lv = ct.leaves;
+
+    //Create geometric obtects for tree segments
+    TubeMapperVector tmv;
+    tmv = createTubeMappers(tsv,tmv,TUBE_RADIUS_SCALAR);
+
+    //VTK actors for tree segments, leaves an petioles.
+    //Leaf and petiole actor construction creates also
+    //corresponding geometric objects
+    TubeActorVector tav;
+    tav = createTubeActors(tmv,tav);
+    LeafActorVector lav;
+    lav = createKiteLeafActors(lv,lav);
+    LineActorVector lineav;
+    lineav = createLineActors(pv,lineav);
+
+    //Add datasets to dataset collection
+    TreeDataSetIndices indices;
+    indices[0] = addPartitionedDataSet(lav,TREE_SEGMENT_LEAF_BLOCK);
+    indices[1] = addPartitionedDataSet(lineav,TREE_SEGMENT_PETIOLE_BLOCK);
+    indices[2] = addPartitionedDataSet(tav,TREE_SEGMENT_R_BLOCK);
+    if (add_to_renderer == true){
+      addActorsToRenderer(tav);
+      addActorsToRenderer(lav);
+      addActorsToRenderer(lineav);
+    }
+    return indices;
+  }
+
+  CfLignumToVTK& CfLignumToVTK::createConiferTreeVTKDataSets(CollectedTree& ct,bool add_to_renderer)
+  {
+    TreeDataSetIndices indices = createConiferTreeDataSets(ct,add_to_renderer);
+    addConiferTreeAssembly(ct.tree_id,indices[0],indices[1],indices[2]);
+    return *this;
+  }
+
+  HwLignumToVTK& HwLignumToVTK::createBroadLeafTreeVTKDataSets(CollectedTree& ct, bool add_to_renderer)
+  {
+    addBroadLeafTreeAssembly(ct.tree_id,createBroadLeafTreeDataSets(ct,add_to_renderer));
+    return *this;
+  }
+
+  void HwLignumToVTK::addBroadLeafTreeAssembly(const string& tree_id,const TreeDataSetIndices& indices)
+  {
+    //Update vtkDataAssembly views on the datasets for hierarchy information
+    //Create the tree hierarchy
+    const string valid_tree_id = dataset_assembly->MakeValidNodeName(tree_id.c_str());
+    //Create data assembly view where a tree is a collection of its segments and foliage 
+    //Zero (0) is the root of the tree and the tree becomes next node base on its id tag
+    int tree_node_id = dataset_assembly->AddNode(valid_tree_id.c_str(),0);
+    //Three nodes for foliage, segments and petioles of the tree
+    int foliage_node_id = dataset_assembly->AddNode(TREE_SEGMENT_LEAF_BLOCK.c_str(),tree_node_id);
+    int petiole_node_id = dataset_assembly->AddNode(TREE_SEGMENT_PETIOLE_BLOCK.c_str(),tree_node_id);
+    int ts_r_node_id = dataset_assembly->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),tree_node_id);
+    //Set data assembly node indices to point to foliage, segment and petiole dataset indices 
+    dataset_assembly->AddDataSetIndex(foliage_node_id,indices[0]);
+    dataset_assembly->AddDataSetIndex(petiole_node_id,indices[1]);
+    dataset_assembly->AddDataSetIndex(ts_r_node_id,indices[2]);
+    ///Create three part view to foliage, segments and petiole
+    int fol_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_LEAF_BLOCK.c_str());
+    int petiole_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_PETIOLE_BLOCK.c_str());
+    int r_id = dataset_assembly_component_view->FindFirstNodeWithName(TREE_SEGMENT_R_BLOCK.c_str());
+    dataset_assembly_component_view->AddDataSetIndex(fol_id,indices[0]);
+    dataset_assembly_component_view->AddDataSetIndex(petiole_id,indices[1]);
+    dataset_assembly_component_view->AddDataSetIndex(r_id,indices[2]);
+  }
+
   HwLignumToVTK::HwLignumToVTK(double resolution)
     :LignumToVTK(resolution)
   {
@@ -461,4 +628,90 @@ namespace lignumvtk{
     dataset_assembly_component_view->AddNode(TREE_SEGMENT_PETIOLE_BLOCK.c_str(),0);
     dataset_assembly_component_view->AddNode(TREE_SEGMENT_R_BLOCK.c_str(),0);
   }
-}				     
+
+
+  StandLignumToVTK::StandLignumToVTK(double resolution,int sides)
+    :LignumToVTK(resolution,sides)
+  {
+    //The assemblies are made in updateDataAssembly when the tree types are known
+    dataset_assembly->SetRootNodeName(ROOT_TREE_NODE.c_str());
+    dataset_collection->SetDataAssembly(dataset_assembly);
+    dataset_assembly_component_view->SetRootNodeName(ROOT_TREE_NODE.c_str());
+  }
+
+  StandLignumToVTK& StandLignumToVTK::createTreeVTKDataSets(CollectedTree& ct,bool add_to_renderer)
+  {
+    StandTree st;
+    st.tree_id = ct.tree_id;
+    st.tree_type = ct.tree_type;
+    if (ct.tree_type == "Hw"){
+      st.indices = createBroadLeafTreeDataSets(ct,add_to_renderer);
+    }
+    else{
+      st.indices = createConiferTreeDataSets(ct,add_to_renderer);
+    }
+    trees.push_back(st);
+    return *this;
+  }
+
+  StandLignumToVTK& StandLignumToVTK::addTreeVTKDataSets(const string& tree_type,PolyDataVector& b0,PolyDataVector& b1,PolyDataVector& b2,
+							  const string& tree_id)
+  {
+    const bool hw = tree_type == "Hw";
+    StandTree st;
+    st.tree_id = tree_id;
+    st.tree_type = tree_type;
+    st.indices[0] = addPartitionedDataSet(b0,hw ? TREE_SEGMENT_LEAF_BLOCK : TREE_SEGMENT_FOLIAGE_BLOCK);
+    st.indices[1] = addPartitionedDataSet(b1,hw ? TREE_SEGMENT_PETIOLE_BLOCK : TREE_SEGMENT_RH_BLOCK);
+    st.indices[2] = addPartitionedDataSet(b2,TREE_SEGMENT_R_BLOCK);
+    trees.push_back(st);
+    return *this;
+  }
+
+  void StandLignumToVTK::updateDataAssembly()
+  {
+    const string cf_blocks[3] = {TREE_SEGMENT_FOLIAGE_BLOCK,TREE_SEGMENT_RH_BLOCK,TREE_SEGMENT_R_BLOCK};
+    const string hw_blocks[3] = {TREE_SEGMENT_LEAF_BLOCK,TREE_SEGMENT_PETIOLE_BLOCK,TREE_SEGMENT_R_BLOCK};
+    const int nhw = std::count_if(trees.begin(),trees.end(),[](const StandTree& st){return st.tree_type == "Hw";});
+    const bool mixed = nhw > 0 && nhw < static_cast<int>(trees.size());
+    //Make the views anew, the trees may have been added after the previous write
+    dataset_assembly->Initialize();
+    dataset_assembly->SetRootNodeName(ROOT_TREE_NODE.c_str());
+    dataset_assembly_component_view->Initialize();
+    dataset_assembly_component_view->SetRootNodeName(ROOT_TREE_NODE.c_str());
+    //Parent nodes for conifers and broadleaves, the root unless the stand is mixed
+    int cf_parent = 0;
+    int hw_parent = 0;
+    int cf_component_parent = 0;
+    int hw_component_parent = 0;
+    if (mixed){
+      cf_parent = dataset_assembly->AddNode(CONIFER_TREES_NODE.c_str(),0);
+      hw_parent = dataset_assembly->AddNode(BROADLEAF_TREES_NODE.c_str(),0);
+      cf_component_parent = dataset_assembly_component_view->AddNode(CONIFER_TREES_NODE.c_str(),0);
+      hw_component_parent = dataset_assembly_component_view->AddNode(BROADLEAF_TREES_NODE.c_str(),0);
+    }
+    //Component nodes for the tree types present
+    int cf_component_nodes[3] = {-1,-1,-1};
+    int hw_component_nodes[3] = {-1,-1,-1};
+    for (int i = 0; i < 3; i++){
+      if (nhw < static_cast<int>(trees.size())){
+	cf_component_nodes[i] = dataset_assembly_component_view->AddNode(cf_blocks[i].c_str(),cf_component_parent);
+      }
+      if (nhw > 0){
+	hw_component_nodes[i] = dataset_assembly_component_view->AddNode(hw_blocks[i].c_str(),hw_component_parent);
+      }
+    }
+    for (const StandTree& st : trees){
+      const bool hw = st.tree_type == "Hw";
+      const string* blocks = hw ? hw_blocks : cf_blocks;
+      const int* component_nodes = hw ? hw_component_nodes : cf_component_nodes;
+      const string valid_tree_id = dataset_assembly->MakeValidNodeName(st.tree_id.c_str());
+      int tree_node_id = dataset_assembly->AddNode(valid_tree_id.c_str(),hw ? hw_parent : cf_parent);
+      for (int i = 0; i < 3; i++){
+	int node_id = dataset_assembly->AddNode(blocks[i].c_str(),tree_node_id);
+	dataset_assembly->AddDataSetIndex(node_id,st.indices[i]);
+	dataset_assembly_component_view->AddDataSetIndex(component_nodes[i],st.indices[i]);
+      }
+    }
+  }
+}
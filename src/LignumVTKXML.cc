@@ -1,36 +1,193 @@
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <MappedFile.h>
 #include <LignumVTKXML.h>
 namespace lignumvtk{
+  ///\brief End of XML start tag at or after \p begin, skips '>' in quoted attribute values
+  ///\return Position of '>' or std::string::npos
+  static std::size_t TagEnd(const char* data,std::size_t begin,std::size_t n)
+  {
+    char quote = 0;
+    for (std::size_t i = begin; i < n; i++){
+      if (quote != 0){
+	if (data[i] == quote){
+	  quote = 0;
+	}
+      }
+      else if (data[i] == '"' || data[i] == '\''){
+	quote = data[i];
+      }
+      else if (data[i] == '>'){
+	return i;
+      }
+    }
+    return std::string::npos;
+  }
+
+  ///\brief Find \p s in \p data from \p begin
+  ///\return Position of \p s or std::string::npos
+  static std::size_t Find(const char* data,std::size_t begin,std::size_t n,const char* s)
+  {
+    const std::size_t len = std::strlen(s);
+    std::size_t i = begin;
+    while (i + len <= n){
+      const char* c = static_cast<const char*>(std::memchr(data+i,s[0],n-len+1-i));
+      if (c == nullptr){
+	break;
+      }
+      i = c - data;
+      if (std::memcmp(c,s,len) == 0){
+	return i;
+      }
+      i++;
+    }
+    return std::string::npos;
+  }
+
+  std::string XMLAttribute(const std::string& tag,const std::string& name)
+  {
+    std::size_t i = 0;
+    //Skip element name
+    while (i < tag.size() && !std::isspace(static_cast<unsigned char>(tag[i]))){
+      i++;
+    }
+    while (i < tag.size()){
+      while (i < tag.size() && std::isspace(static_cast<unsigned char>(tag[i]))){
+	i++;
+      }
+      const std::size_t name_begin = i;
+      while (i < tag.size() && tag[i] != '=' && !std::isspace(static_cast<unsigned char>(tag[i]))){
+	i++;
+      }
+      const std::string attr_name = tag.substr(name_begin,i-name_begin);
+      while (i < tag.size() && (tag[i] == '=' || std::isspace(static_cast<unsigned char>(tag[i])))){
+	i++;
+      }
+      if (i >= tag.size() || (tag[i] != '"' && tag[i] != '\'')){
+	return std::string("");
+      }
+      const std::size_t value_end = tag.find(tag[i],i+1);
+      if (value_end == std::string::npos){
+	return std::string("");
+      }
+      if (attr_name == name){
+	return tag.substr(i+1,value_end-i-1);
+      }
+      i = value_end + 1;
+    }
+    return std::string("");
+  }
+
   LignumVTKXML& LignumVTKXML::setFileName(const std::string& fname)
   {
-    parser->SetFileName(fname.c_str());
-    file_name = fname; 
+    file_name = fname;
     return *this;
   }
-  
+
+  void LignumVTKXML::reset()
+  {
+    state = SCAN_STATE::ROOT;
+    tree_type.clear();
+    leaf_type.clear();
+    bytes_read = 0;
+  }
+
   LignumVTKXML& LignumVTKXML::parse()
   {
-    parser->Parse();
+    reset();
+    //Scan the mapped file in place, only the pages up to the first leaf are read
+    MappedFile mapped_file;
+    if (mapped_file.open(file_name)){
+      const std::size_t n = scan(mapped_file.data(),mapped_file.size());
+      bytes_read = state == SCAN_STATE::DONE ? n : mapped_file.size();
+      return *this;
+    }
+    std::ifstream in(file_name,std::ios::binary);
+    std::vector<char> chunk(LIGNUM_XML_CHUNK_SIZE);
+    std::string buffer;
+    while (in && state != SCAN_STATE::DONE){
+      in.read(chunk.data(),chunk.size());
+      const std::size_t n = static_cast<std::size_t>(in.gcount());
+      bytes_read += n;
+      buffer.append(chunk.data(),n);
+      buffer.erase(0,scan(buffer.data(),buffer.size()));
+    }
     return *this;
   }
 
-  const std::string LignumVTKXML::treeType()const
+  LignumVTKXML& LignumVTKXML::parse(const char* data,std::size_t n)
   {
-    vtkXMLElementPtr root = parser->GetRootElement();
-    const std::string segment_type = root->GetAttribute("SegmentType");
-    return segment_type;
+    reset();
+    scan(data,n);
+    return *this;
   }
 
-  const std::string LignumVTKXML::leafType()const
+  std::size_t LignumVTKXML::scan(const char* data,std::size_t n)
   {
-    vtkXMLElementPtr root = parser->GetRootElement();
-    const std::string segment_type = root->GetAttribute("SegmentType");
-    if (segment_type == "Hw"){
-      vtkXMLElementPtr leaf = root->LookupElementWithName("BroadLeaf");
-      std::string leaf_shape = leaf->GetAttribute("Shape");
-      return leaf_shape;
+    std::size_t pos = 0;
+    while (state == SCAN_STATE::ROOT){
+      const char* lt = static_cast<const char*>(std::memchr(data+pos,'<',n-pos));
+      if (lt == nullptr){
+	return n;
+      }
+      pos = lt - data;
+      if (n - pos < 4){
+	return pos;
+      }
+      //Skip XML declaration, comments and DOCTYPE before the root element
+      std::size_t end = std::string::npos;
+      if (data[pos+1] == '?'){
+	end = Find(data,pos+2,n,"?>");
+      }
+      else if (std::memcmp(data+pos,"<!--",4) == 0){
+	end = Find(data,pos+4,n,"-->");
+      }
+      else if (data[pos+1] == '!'){
+	end = TagEnd(data,pos+2,n);
+      }
+      else{
+	end = TagEnd(data,pos+1,n);
+	if (end == std::string::npos){
+	  return pos;
+	}
+	const std::string tag(data+pos+1,end-pos-1);
+	tree_type = XMLAttribute(tag,"SegmentType");
+	state = tree_type == "Hw" ? SCAN_STATE::LEAF : SCAN_STATE::DONE;
+	pos = end + 1;
+	break;
+      }
+      if (end == std::string::npos){
+	return pos;
+      }
+      pos = end + 1;
     }
-    else{
-      return std::string("");
+    const char* leaf_tag = "<BroadLeaf";
+    const std::size_t leaf_tag_len = std::strlen(leaf_tag);
+    while (state == SCAN_STATE::LEAF){
+      const std::size_t begin = Find(data,pos,n,leaf_tag);
+      if (begin == std::string::npos){
+	//Keep the tail that may be the beginning of the next BroadLeaf
+	return n > pos + leaf_tag_len ? n - leaf_tag_len : pos;
+      }
+      if (begin + leaf_tag_len >= n){
+	return begin;
+      }
+      const char c = data[begin+leaf_tag_len];
+      if (!std::isspace(static_cast<unsigned char>(c)) && c != '>' && c != '/'){
+	//Other element name beginning with BroadLeaf
+	pos = begin + leaf_tag_len;
+	continue;
+      }
+      const std::size_t end = TagEnd(data,begin+1,n);
+      if (end == std::string::npos){
+	return begin;
+      }
+      leaf_type = XMLAttribute(std::string(data+begin+1,end-begin-1),"Shape");
+      state = SCAN_STATE::DONE;
+      pos = end + 1;
     }
+    return pos;
   }
 }
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <MappedFile.h>
+
+namespace lignumvtk{
+
+  MappedFile::MappedFile(const std::string& file_name)
+    :mapped_data(nullptr),mapped_size(0)
+  {
+    open(file_name);
+  }
+
+  MappedFile::~MappedFile()
+  {
+    close();
+  }
+
+  bool MappedFile::open(const std::string& file_name,bool sequential)
+  {
+    close();
+    int fd = ::open(file_name.c_str(),O_RDONLY);
+    if (fd < 0){
+      std::cout << "Cannot open file " << file_name << std::endl;
+      return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd,&file_stat) != 0 || file_stat.st_size == 0){
+      std::cout << "Cannot map empty file " << file_name << std::endl;
+      ::close(fd);
+      return false;
+    }
+    std::size_t n = static_cast<std::size_t>(file_stat.st_size);
+    void* p = mmap(nullptr,n,PROT_READ,MAP_PRIVATE,fd,0);
+    //The mapping remains valid after the file descriptor is closed
+    ::close(fd);
+    if (p == MAP_FAILED){
+      std::cout << "Cannot map file " << file_name << std::endl;
+      return false;
+    }
+    if (sequential){
+      madvise(p,n,MADV_SEQUENTIAL);
+    }
+    mapped_data = static_cast<const char*>(p);
+    mapped_size = n;
+    return true;
+  }
+
+  void MappedFile::close()
+  {
+    if (mapped_data != nullptr){
+      munmap(const_cast<char*>(mapped_data),mapped_size);
+      mapped_data = nullptr;
+      mapped_size = 0;
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#include <fstream>
+#include <iostream>
+#include <AtomicFile.h>
+#include <PVDFile.h>
+
+namespace lignumvtk{
+
+  PVDFile& PVDFile::addDataSet(double time_step, const std::string& file_name, int part, const std::string& name)
+  {
+    PVDDataSet dataset;
+    dataset.time_step = time_step;
+    dataset.part = part;
+    dataset.name = name;
+    dataset.file_name = file_name;
+    datasets.push_back(dataset);
+    return *this;
+  }
+
+  bool PVDFile::write(const std::string& file_name)const
+  {
+    //ParaView never sees a partially written collection
+    return WriteFileAtomically(file_name,[this](const std::string& tmp_file){
+      std::ofstream pvd(tmp_file);
+      if (!pvd){
+	std::cout << "Cannot open PVD file " << tmp_file << " for writing" << std::endl;
+	return false;
+      }
+      pvd << "<?xml version=\"1.0\"?>" << std::endl;
+      pvd << "<VTKFile type=\"Collection\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
+      pvd << "  <Collection>" << std::endl;
+      for (const PVDDataSet& dataset : datasets){
+	pvd << "    <DataSet timestep=\"" << dataset.time_step << "\" group=\"\" part=\"" << dataset.part << "\"";
+	if (!dataset.name.empty()){
+	  pvd << " name=\"" << dataset.name << "\"";
+	}
+	pvd << " file=\"" << dataset.file_name << "\"/>" << std::endl;
+      }
+      pvd << "  </Collection>" << std::endl;
+      pvd << "</VTKFile>" << std::endl;
+      pvd.close();
+      return !pvd.fail();
+    });
+  }
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <AtomicFile.h>
+#include <TreeCache.h>
+
+namespace lignumvtk{
+
+  ContentHash& ContentHash::add(const void* data,std::size_t n)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; i++){
+      hash ^= static_cast<std::uint64_t>(bytes[i]);
+      hash *= 1099511628211ULL;
+    }
+    return *this;
+  }
+
+  ContentHash& ContentHash::add(int i)
+  {
+    //The same bytes on all platforms
+    const std::uint32_t u = static_cast<std::uint32_t>(i);
+    const unsigned char bytes[4] = {static_cast<unsigned char>(u),static_cast<unsigned char>(u >> 8),
+				    static_cast<unsigned char>(u >> 16),static_cast<unsigned char>(u >> 24)};
+    return add(bytes,sizeof(bytes));
+  }
+
+  const std::string ContentHash::hex()const
+  {
+    char buffer[17];
+    std::snprintf(buffer,sizeof(buffer),"%016llx",static_cast<unsigned long long>(hash));
+    return std::string(buffer);
+  }
+
+  TreeCache::TreeCache(const std::string& dir)
+    :cache_dir(dir),hits(0),misses(0)
+  {
+    std::error_code error;
+    std::filesystem::create_directories(cache_dir,error);
+    if (error){
+      std::cout << "Cannot create cache directory " << cache_dir << ": " << error.message() << std::endl;
+    }
+  }
+
+  const std::string TreeCache::key(const std::string& tree_string,int spline_resolution,int nsides,int reader)const
+  {
+    ContentHash h;
+    h.add(TREE_CACHE_VERSION).add(spline_resolution).add(nsides).add(reader).add(tree_string);
+    return h.hex();
+  }
+
+  bool TreeCache::load(const std::string& key,TreeBlocks& blocks)
+  {
+    const std::filesystem::path entry = std::filesystem::path(cache_dir)/key;
+    std::ifstream manifest(entry/TREE_CACHE_MANIFEST);
+    if (!manifest){
+      misses++;
+      return false;
+    }
+    blocks.clear();
+    std::string block_name;
+    int npartitions = 0;
+    while (manifest >> block_name >> npartitions){
+      PolyDataVector v;
+      for (int i = 0; i < npartitions; i++){
+	const std::filesystem::path file = entry/(std::to_string(blocks.size())+"_"+std::to_string(i)+VTP_EXTENSION);
+	vtkNew<vtkXMLPolyDataReader> reader;
+	reader->SetFileName(file.string().c_str());
+	reader->Update();
+	vtkSmartPointer<vtkPolyData> polydata = reader->GetOutput();
+	if (polydata == nullptr || reader->GetErrorCode() != 0){
+	  std::cout << "Cache entry " << key << " is not valid" << std::endl;
+	  misses++;
+	  return false;
+	}
+	v.push_back(polydata);
+      }
+      blocks.push_back(std::make_pair(block_name,v));
+    }
+    if (blocks.size() != TREE_CACHE_BLOCKS){
+      std::cout << "Cache entry " << key << " is not valid" << std::endl;
+      misses++;
+      return false;
+    }
+    hits++;
+    return true;
+  }
+
+  bool TreeCache::store(const std::string& key,const TreeBlocks& blocks)const
+  {
+    const std::filesystem::path entry = std::filesystem::path(cache_dir)/key;
+    std::error_code error;
+    std::filesystem::create_directories(entry,error);
+    if (error){
+      std::cout << "Cannot create cache entry " << entry << ": " << error.message() << std::endl;
+      return false;
+    }
+    for (unsigned int b = 0; b < blocks.size(); b++){
+      const PolyDataVector& v = blocks[b].second;
+      for (unsigned int i = 0; i < v.size(); i++){
+	const std::filesystem::path file = entry/(std::to_string(b)+"_"+std::to_string(i)+VTP_EXTENSION);
+	vtkNew<vtkXMLPolyDataWriter> writer;
+	writer->SetFileName(file.string().c_str());
+	writer->SetInputData(v[i]);
+	if (writer->Write() == 0){
+	  std::cout << "Cannot write cache file " << file << std::endl;
+	  return false;
+	}
+      }
+    }
+    //Manifest last, the entry is valid only after it exists
+    const std::filesystem::path manifest_file = entry/TREE_CACHE_MANIFEST;
+    return WriteFileAtomically(manifest_file.string(),[&blocks](const std::string& tmp_file){
+      std::ofstream manifest(tmp_file);
+      for (const auto& block : blocks){
+	manifest << block.first << " " << block.second.size() << std::endl;
+      }
+      manifest.close();
+      return !manifest.fail();
+    });
+  }
+}
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <VoxelExpression.h>
+
+namespace lignumvtk{
+
+  ///\brief Minimum number of array elements for one thread
+  const std::size_t VOXEL_EXPRESSION_GRAIN=1<<16;
+
+  ///\brief Run \p f(begin,end) for ranges of [0,n) in parallel
+  ///\param threads Maximum number of threads, the calling thread included
+  template <class F>
+  static void ParallelFor(unsigned int threads,std::size_t n,F f)
+  {
+    const std::size_t nthreads = std::min<std::size_t>(std::max(1u,threads),
+						       (n+VOXEL_EXPRESSION_GRAIN-1)/VOXEL_EXPRESSION_GRAIN);
+    if (nthreads <= 1){
+      f(std::size_t(0),n);
+      return;
+    }
+    const std::size_t chunk = (n+nthreads-1)/nthreads;
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < nthreads; t++){
+      pool.emplace_back(f,std::min(t*chunk,n),std::min((t+1)*chunk,n));
+    }
+    f(std::size_t(0),std::min(chunk,n));
+    for (std::thread& t : pool){
+      t.join();
+    }
+  }
+
+  ///\brief Recursive descent parser for one expression
+  ///
+  ///expression: term {(+|-) term}, term: factor {(*|/) factor},
+  ///factor: number | name | cumz(expression) | (expression) | -factor
+  class VoxelExpressionParser{
+  public:
+    VoxelExpressionParser(const std::string& t,const std::vector<std::string>& c,double v)
+      :text(t),pos(0),column_names(c),volume(v){}
+    ///\brief Parse the whole text
+    ///\return Expression tree, nullptr if syntax error
+    std::unique_ptr<VoxelExpressionNode> parse()
+    {
+      std::unique_ptr<VoxelExpressionNode> node = expression();
+      skipSpace();
+      if (node && pos < text.size()){
+	return error("unexpected character");
+      }
+      return node;
+    }
+  private:
+    typedef VoxelExpressionNode::OPERATION OPERATION;
+    std::unique_ptr<VoxelExpressionNode> error(const std::string& message)
+    {
+      std::cout << "Expression " << text << ": " << message << " at position " << pos << std::endl;
+      return nullptr;
+    }
+    void skipSpace()
+    {
+      while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))){
+	pos++;
+      }
+    }
+    bool accept(char c)
+    {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c){
+	pos++;
+	return true;
+      }
+      return false;
+    }
+    std::unique_ptr<VoxelExpressionNode> binary(OPERATION op,std::unique_ptr<VoxelExpressionNode> left,
+						std::unique_ptr<VoxelExpressionNode> right)
+    {
+      if (!left || !right){
+	return nullptr;
+      }
+      auto node = std::make_unique<VoxelExpressionNode>(op);
+      node->left = std::move(left);
+      node->right = std::move(right);
+      return node;
+    }
+    std::unique_ptr<VoxelExpressionNode> expression()
+    {
+      std::unique_ptr<VoxelExpressionNode> node = term();
+      while (node){
+	if (accept('+')){
+	  node = binary(OPERATION::ADD,std::move(node),term());
+	}
+	else if (accept('-')){
+	  node = binary(OPERATION::SUBTRACT,std::move(node),term());
+	}
+	else{
+	  break;
+	}
+      }
+      return node;
+    }
+    std::unique_ptr<VoxelExpressionNode> term()
+    {
+      std::unique_ptr<VoxelExpressionNode> node = factor();
+      while (node){
+	if (accept('*')){
+	  node = binary(OPERATION::MULTIPLY,std::move(node),factor());
+	}
+	else if (accept('/')){
+	  node = binary(OPERATION::DIVIDE,std::move(node),factor());
+	}
+	else{
+	  break;
+	}
+      }
+      return node;
+    }
+    std::unique_ptr<VoxelExpressionNode> factor()
+    {
+      if (accept('-')){
+	std::unique_ptr<VoxelExpressionNode> operand = factor();
+	if (!operand){
+	  return nullptr;
+	}
+	auto node = std::make_unique<VoxelExpressionNode>(OPERATION::NEGATE);
+	node->left = std::move(operand);
+	return node;
+      }
+      if (accept('(')){
+	std::unique_ptr<VoxelExpressionNode> node = expression();
+	if (node && !accept(')')){
+	  return error("missing )");
+	}
+	return node;
+      }
+      skipSpace();
+      if (pos >= text.size()){
+	return error("unexpected end");
+      }
+      if (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.'){
+	const char* begin = text.c_str()+pos;
+	char* end = nullptr;
+	auto node = std::make_unique<VoxelExpressionNode>(OPERATION::NUMBER);
+	node->value = std::strtod(begin,&end);
+	pos += end-begin;
+	return node;
+      }
+      if (!(std::isalpha(static_cast<unsigned char>(text[pos])) || text[pos] == '_')){
+	return error("unexpected character");
+      }
+      std::string::size_type begin = pos;
+      while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')){
+	pos++;
+      }
+      const std::string name = text.substr(begin,pos-begin);
+      if (name == "cumz"){
+	if (!accept('(')){
+	  return error("missing ( after cumz");
+	}
+	std::unique_ptr<VoxelExpressionNode> operand = expression();
+	if (operand && !accept(')')){
+	  return error("missing )");
+	}
+	if (!operand){
+	  return nullptr;
+	}
+	auto node = std::make_unique<VoxelExpressionNode>(OPERATION::CUMZ);
+	node->left = std::move(operand);
+	return node;
+      }
+      if (name == "volume"){
+	auto node = std::make_unique<VoxelExpressionNode>(OPERATION::NUMBER);
+	node->value = volume;
+	return node;
+      }
+      auto it = std::find(column_names.begin(),column_names.end(),name);
+      if (it == column_names.end()){
+	return error("unknown name " + name);
+      }
+      auto node = std::make_unique<VoxelExpressionNode>(OPERATION::COLUMN);
+      node->column = it-column_names.begin();
+      return node;
+    }
+    const std::string& text;///< Expression
+    std::string::size_type pos;///< Parse position
+    const std::vector<std::string>& column_names;///< Input and derived column names
+    double volume;///< Voxel volume
+  };
+
+  ///\brief Mark input columns used in an expression
+  static void MarkColumns(const VoxelExpressionNode* node,int nd,std::vector<bool>& used)
+  {
+    if (node == nullptr){
+      return;
+    }
+    if (node->op == VoxelExpressionNode::OPERATION::COLUMN && node->column < nd){
+      used[node->column] = true;
+    }
+    MarkColumns(node->left.get(),nd,used);
+    MarkColumns(node->right.get(),nd,used);
+  }
+
+  bool VoxelExpressions::parse(const std::string& text,const std::vector<std::string>& attr_names,double voxel_volume)
+  {
+    nd = attr_names.size();
+    volume = voxel_volume;
+    names.clear();
+    expressions.clear();
+    used.assign(nd,false);
+    std::vector<std::string> column_names = attr_names;
+    std::string::size_type begin = 0;
+    while (begin < text.size()){
+      std::string::size_type end = text.find(';',begin);
+      if (end == std::string::npos){
+	end = text.size();
+      }
+      const std::string assignment = text.substr(begin,end-begin);
+      begin = end + 1;
+      if (assignment.find_first_not_of(" \t") == std::string::npos){
+	continue;
+      }
+      std::string::size_type equal = assignment.find('=');
+      if (equal == std::string::npos){
+	std::cout << "Derived field " << assignment << " should be name=expression" << std::endl;
+	return false;
+      }
+      std::string name = assignment.substr(0,equal);
+      name.erase(0,name.find_first_not_of(" \t"));
+      name.erase(name.find_last_not_of(" \t")+1);
+      if (name.empty() || std::find(column_names.begin(),column_names.end(),name) != column_names.end()){
+	std::cout << "Derived field name " << name << " is empty or already in use" << std::endl;
+	return false;
+      }
+      const std::string expression = assignment.substr(equal+1);
+      VoxelExpressionParser parser(expression,column_names,volume);
+      std::unique_ptr<VoxelExpressionNode> node = parser.parse();
+      if (!node){
+	return false;
+      }
+      MarkColumns(node.get(),nd,used);
+      expressions.push_back(std::move(node));
+      names.push_back(name);
+      //Later fields can refer to this one
+      column_names.push_back(name);
+    }
+    return true;
+  }
+
+  const double* VoxelExpressions::operand(VoxelExpressionNode& node,std::size_t n,int nz,int k_offset,
+					  std::vector<double>& tmp)
+  {
+    if (node.op == VoxelExpressionNode::OPERATION::COLUMN){
+      return columns[node.column].data();
+    }
+    evaluate(node,n,nz,k_offset,tmp);
+    return tmp.data();
+  }
+
+  void VoxelExpressions::evaluate(VoxelExpressionNode& node,std::size_t n,int nz,int k_offset,std::vector<double>& out)
+  {
+    typedef VoxelExpressionNode::OPERATION OPERATION;
+    out.resize(n);
+    double* o = out.data();
+    switch (node.op){
+    case OPERATION::NUMBER:{
+      const double v = node.value;
+      ParallelFor(threads,n,[o,v](std::size_t b,std::size_t e){std::fill(o+b,o+e,v);});
+      break;
+    }
+    case OPERATION::COLUMN:{
+      const double* c = columns[node.column].data();
+      ParallelFor(threads,n,[o,c](std::size_t b,std::size_t e){std::copy(c+b,c+e,o+b);});
+      break;
+    }
+    case OPERATION::NEGATE:{
+      evaluate(*node.left,n,nz,k_offset,out);
+      ParallelFor(threads,n,[o](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] = -o[i];});
+      break;
+    }
+    case OPERATION::CUMZ:{
+      std::vector<double> tmp;
+      const double* a = operand(*node.left,n,nz,k_offset,tmp);
+      const std::size_t ncolumns = n/nz;
+      if (node.carry.size() != ncolumns){
+	node.carry.assign(ncolumns,0.0);
+	node.carry_k = 0;
+      }
+      //Layers of this slab already summed to carry in the previous slab
+      const int overlap = std::max(0,std::min(node.carry_k-k_offset,nz));
+      double* carry = node.carry.data();
+      //Voxel layers of one column are contiguous in the HDF5 order
+      ParallelFor(threads,ncolumns,[a,o,nz,overlap,carry](std::size_t b,std::size_t e){
+	  for (std::size_t c = b; c < e; c++){
+	    const double* in = a + c*nz;
+	    double* sum = o + c*nz;
+	    double s = carry[c];
+	    for (int k = 0; k < overlap; k++){
+	      s -= in[k];
+	    }
+	    for (int k = 0; k < nz; k++){
+	      s += in[k];
+	      sum[k] = s;
+	    }
+	    carry[c] = s;
+	  }
+	});
+      node.carry_k = k_offset+nz;
+      break;
+    }
+    default:{
+      //Binary operations
+      evaluate(*node.left,n,nz,k_offset,out);
+      if (node.right->op == OPERATION::NUMBER){
+	const double v = node.right->value;
+	switch (node.op){
+	case OPERATION::ADD:
+	  ParallelFor(threads,n,[o,v](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] += v;});
+	  break;
+	case OPERATION::SUBTRACT:
+	  ParallelFor(threads,n,[o,v](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] -= v;});
+	  break;
+	case OPERATION::MULTIPLY:
+	  ParallelFor(threads,n,[o,v](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] *= v;});
+	  break;
+	default:
+	  ParallelFor(threads,n,[o,v](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] /= v;});
+	  break;
+	}
+	break;
+      }
+      std::vector<double> tmp;
+      const double* r = operand(*node.right,n,nz,k_offset,tmp);
+      switch (node.op){
+      case OPERATION::ADD:
+	ParallelFor(threads,n,[o,r](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] += r[i];});
+	break;
+      case OPERATION::SUBTRACT:
+	ParallelFor(threads,n,[o,r](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] -= r[i];});
+	break;
+      case OPERATION::MULTIPLY:
+	ParallelFor(threads,n,[o,r](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] *= r[i];});
+	break;
+      default:
+	ParallelFor(threads,n,[o,r](std::size_t b,std::size_t e){for (std::size_t i = b; i < e; i++) o[i] /= r[i];});
+	break;
+      }
+    }
+    }
+  }
+
+  void VoxelExpressions::evaluate(std::vector<double>& data,int nx,int ny,int nz,int k_offset)
+  {
+    const std::size_t m = expressions.size();
+    if (m == 0){
+      return;
+    }
+    const std::size_t n = static_cast<std::size_t>(nx)*ny*nz;
+    const std::size_t d0 = nd;
+    const std::size_t d1 = nd + m;
+    columns.resize(d1);
+    //Input columns used in the expressions, in the HDF5 voxel order
+    for (int d = 0; d < nd; d++){
+      if (used[d]){
+	columns[d].resize(n);
+	double* c = columns[d].data();
+	const double* src = data.data();
+	ParallelFor(threads,n,[c,src,d,d0](std::size_t b,std::size_t e){
+	    for (std::size_t i = b; i < e; i++) c[i] = src[i*d0+d];});
+      }
+    }
+    for (std::size_t j = 0; j < m; j++){
+      evaluate(*expressions[j],n,nz,k_offset,columns[nd+j]);
+    }
+    //Interleave the derived columns after the input columns
+    std::vector<double> result(n*d1);
+    double* dst = result.data();
+    const double* src = data.data();
+    std::vector<const double*> derived(m);
+    for (std::size_t j = 0; j < m; j++){
+      derived[j] = columns[nd+j].data();
+    }
+    ParallelFor(threads,n,[&derived,dst,src,d0,d1,m](std::size_t b,std::size_t e){
+	for (std::size_t i = b; i < e; i++){
+	  std::copy(src+i*d0,src+(i+1)*d0,dst+i*d1);
+	  for (std::size_t j = 0; j < m; j++){
+	    dst[i*d1+d0+j] = derived[j][i];
+	  }
+	}
+      });
+    data.swap(result);
+  }
+}
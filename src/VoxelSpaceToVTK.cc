@@ -1,8 +1,69 @@
+#include <algorithm>
 #include <VoxelSpaceToVTK.h>
 
 namespace lignumvtk{
 
+  std::size_t TransposeVoxelData(const double* src,int nx,int ny,int nz,int nd,const vector<double*>& dst)
+  {
+    const std::size_t sx = static_cast<std::size_t>(ny)*nz*nd;
+    const std::size_t sy = static_cast<std::size_t>(nz)*nd;
+    const std::size_t dy = static_cast<std::size_t>(nx);
+    const std::size_t dz = static_cast<std::size_t>(nx)*ny;
+    std::size_t nnan = 0;
+    for (int j = 0; j < ny; j++){
+      for (int k0 = 0; k0 < nz; k0 += VOXEL_TRANSPOSE_BLOCK){
+	const int k1 = std::min(k0+VOXEL_TRANSPOSE_BLOCK,nz);
+	for (int i0 = 0; i0 < nx; i0 += VOXEL_TRANSPOSE_BLOCK){
+	  const int i1 = std::min(i0+VOXEL_TRANSPOSE_BLOCK,nx);
+	  for (int i = i0; i < i1; i++){
+	    //Values for k0..k1 and all columns are contiguous in src
+	    const double* row = src + i*sx + j*sy;
+	    for (int k = k0; k < k1; k++){
+	      const std::size_t point_id = i + j*dy + k*dz;
+	      const double* value = row + static_cast<std::size_t>(k)*nd;
+	      for (int d = 0; d < nd; d++){
+		const double v = value[d];
+		//NaN is the only value not equal to itself, no branches
+		nnan += (v != v);
+		dst[d][point_id] = (v == v) ? v : 0.0;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+    return nnan;
+  }
+
+  void WriteImageData(vtkImageData* image,const string& file_name)
+  {
+    vtkNew<vtkXMLImageDataWriter> image_writer;
+    std::cout << "Writing image data to: " << file_name << endl;
+    image_writer->SetFileName(file_name.c_str());
+    image_writer->SetInputDataObject(image);
+    //Raw binary data after the XML header
+    image_writer->SetDataModeToAppended();
+    image_writer->EncodeAppendedDataOff();
+    image_writer->Write();
+  }
+
+  void CopyPointToCellData(const double* point,int nx,int ny,int nz,double* cell)
+  {
+    const std::size_t row = static_cast<std::size_t>(nx-1);
+    for (int k = 0; k < nz-1; k++){
+      for (int j = 0; j < ny-1; j++){
+	const double* begin = point + static_cast<std::size_t>(k)*nx*ny + static_cast<std::size_t>(j)*nx;
+	//In place copy moves the rows towards the beginning
+	if (begin != cell){
+	  std::copy(begin,begin+row,cell);
+	}
+	cell += row;
+      }
+    }
+  }
+
   VoxelSpaceToVTK::VoxelSpaceToVTK(int nx, int ny, int nz)
+    :grid_type(VOXEL_GRID_TYPE::STRUCTURED_GRID)
   {
     sgrid->SetDimensions(nx,ny,nz);
     vtkNew<vtkPoints> points;
@@ -21,8 +82,17 @@ namespace lignumvtk{
     sgrid->SetPoints(points);
   }
 	
-  VoxelSpaceToVTK::VoxelSpaceToVTK(int nx, int ny, int nz, double x_edge, double y_edge, double z_edge)
+  VoxelSpaceToVTK::VoxelSpaceToVTK(int nx, int ny, int nz, double x_edge, double y_edge, double z_edge,
+				   VOXEL_GRID_TYPE type)
+    :grid_type(type)
   {
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      //Regular grid, no point coordinates
+      igrid->SetDimensions(nx,ny,nz);
+      igrid->SetOrigin(0.0,0.0,0.0);
+      igrid->SetSpacing(x_edge,y_edge,z_edge);
+      return;
+    }
     sgrid->SetDimensions(nx,ny,nz);
     vtkNew<vtkPoints> points;
     points->Allocate(nx * ny * nz);
@@ -41,10 +111,47 @@ namespace lignumvtk{
     sgrid->SetPoints(points);
   }
   
+  VoxelSpaceToVTK::VoxelSpaceToVTK(const int extent[6], const double origin[3], const double spacing[3],
+				   VOXEL_GRID_TYPE type)
+    :grid_type(type)
+  {
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      igrid->SetExtent(extent[0],extent[1],extent[2],extent[3],extent[4],extent[5]);
+      igrid->SetOrigin(origin[0],origin[1],origin[2]);
+      igrid->SetSpacing(spacing[0],spacing[1],spacing[2]);
+      return;
+    }
+    sgrid->SetExtent(extent[0],extent[1],extent[2],extent[3],extent[4],extent[5]);
+    vtkNew<vtkPoints> points;
+    points->Allocate((extent[1]-extent[0]+1)*(extent[3]-extent[2]+1)*(extent[5]-extent[4]+1));
+    for (int k = extent[4]; k <= extent[5]; k++) {
+      for (int j = extent[2]; j <= extent[3]; j++) {
+	for (int i = extent[0]; i <= extent[1]; i++) {
+	  points->InsertNextPoint(origin[0]+i*spacing[0],origin[1]+j*spacing[1],origin[2]+k*spacing[2]);
+	}
+      }
+    }
+    sgrid->SetPoints(points);
+  }
+
+  vtkDataSet* VoxelSpaceToVTK::grid()
+  {
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      return igrid;
+    }
+    return sgrid;
+  }
+  
   VoxelSpaceToVTK& VoxelSpaceToVTK::insertVoxelSpaceData(const cxxadt::TMatrix4D<double>& vsm,const vector<string>& attr_names)
   {
     int dims[3]{0,0,0};
-    sgrid->GetDimensions(dims);
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      igrid->GetDimensions(dims);
+    }
+    else{
+      sgrid->GetDimensions(dims);
+    }
+    vtkDataSet* vsgrid = grid();
     //Make assertions: right matrix size and right number of attributes
     assert(dims[0] == vsm.a() && dims[1] == vsm.b() && dims[2] == vsm.c() && "Failed Right matrix size");
     assert(vsm.d() == attr_names.size() && "Failed Right number of attribute names");
@@ -53,7 +160,7 @@ namespace lignumvtk{
     for (int i = 0; i < v_attr_cell.size();i++){
       v_attr_cell[i]->SetName(attr_names[i].c_str());
       //Space for attribute data
-      v_attr_cell[i]->SetNumberOfTuples(sgrid->GetNumberOfCells());
+      v_attr_cell[i]->SetNumberOfTuples(vsgrid->GetNumberOfCells());
     }
     //Cell attribute values
     //Note: number of cells (i-1)*(j-1)*(k-1) vs. number of points i*j*k
@@ -81,7 +188,7 @@ namespace lignumvtk{
     vector<vtkNew<vtkDoubleArray>> v_attr_point(attr_names.size());
     for (int i = 0; i < v_attr_point.size();i++){
       v_attr_point[i]->SetName(attr_names[i].c_str());
-      v_attr_point[i]->SetNumberOfTuples(sgrid->GetNumberOfPoints());
+      v_attr_point[i]->SetNumberOfTuples(vsgrid->GetNumberOfPoints());
     }
     for (int k = 0; k < dims[2]; k++){
       for (int j = 0; j < dims[1]; j++){
@@ -104,11 +211,67 @@ namespace lignumvtk{
     }
     //Assign attribute values to cell and point data
     for (int i = 0; i < v_attr_cell.size();i++){
-      sgrid->GetCellData()->AddArray(v_attr_cell[i]);
-      sgrid->GetPointData()->AddArray(v_attr_point[i]);
+      vsgrid->GetCellData()->AddArray(v_attr_cell[i]);
+      vsgrid->GetPointData()->AddArray(v_attr_point[i]);
+    }
+    //Active scalar
+    vsgrid->GetCellData()->SetActiveScalars(attr_names[0].c_str());
+    return *this;
+  }
+
+  VoxelSpaceToVTK& VoxelSpaceToVTK::insertVoxelSpaceData(const double* data,int nx,int ny,int nz,int nd,
+							 const vector<string>& attr_names,VOXEL_DATA_ASSOCIATION association)
+  {
+    int dims[3]{0,0,0};
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      igrid->GetDimensions(dims);
+    }
+    else{
+      sgrid->GetDimensions(dims);
+    }
+    vtkDataSet* vsgrid = grid();
+    //Make assertions: right buffer size and right number of attributes
+    assert(dims[0] == nx && dims[1] == ny && dims[2] == nz && "Failed Right buffer size");
+    assert(nd == attr_names.size() && "Failed Right number of attribute names");
+    vector<vtkNew<vtkDoubleArray>> v_attr_point(nd);
+    vector<double*> point_data(nd);
+    for (int d = 0; d < nd; d++){
+      v_attr_point[d]->SetName(attr_names[d].c_str());
+      v_attr_point[d]->SetNumberOfTuples(vsgrid->GetNumberOfPoints());
+      point_data[d] = v_attr_point[d]->GetPointer(0);
+    }
+    std::size_t nnan = TransposeVoxelData(data,nx,ny,nz,nd,point_data);
+    if (nnan > 0){
+      std::cout << nnan << " NaN values set to 0" << endl;
+    }
+    if (association == VOXEL_DATA_ASSOCIATION::CELL){
+      //Cell data only, reuse the point arrays
+      for (int d = 0; d < nd; d++){
+	CopyPointToCellData(point_data[d],nx,ny,nz,point_data[d]);
+	v_attr_point[d]->SetNumberOfTuples(vsgrid->GetNumberOfCells());
+	v_attr_point[d]->Squeeze();
+	vsgrid->GetCellData()->AddArray(v_attr_point[d]);
+      }
+      vsgrid->GetCellData()->SetActiveScalars(attr_names[0].c_str());
+      return *this;
+    }
+    for (int d = 0; d < nd; d++){
+      vsgrid->GetPointData()->AddArray(v_attr_point[d]);
+    }
+    if (association == VOXEL_DATA_ASSOCIATION::POINT){
+      vsgrid->GetPointData()->SetActiveScalars(attr_names[0].c_str());
+      return *this;
+    }
+    //Note: number of cells (i-1)*(j-1)*(k-1) vs. number of points i*j*k
+    vector<vtkNew<vtkDoubleArray>> v_attr_cell(nd);
+    for (int d = 0; d < nd; d++){
+      v_attr_cell[d]->SetName(attr_names[d].c_str());
+      v_attr_cell[d]->SetNumberOfTuples(vsgrid->GetNumberOfCells());
+      CopyPointToCellData(point_data[d],nx,ny,nz,v_attr_cell[d]->GetPointer(0));
+      vsgrid->GetCellData()->AddArray(v_attr_cell[d]);
     }
     //Active scalar
-    sgrid->GetCellData()->SetActiveScalars(attr_names[0].c_str());
+    vsgrid->GetCellData()->SetActiveScalars(attr_names[0].c_str());
     return *this;
   }
 
@@ -131,4 +294,193 @@ namespace lignumvtk{
     std::cout << "Write file done" <<endl;
     return *this;
   }
+
+  VoxelSpaceToVTK& VoxelSpaceToVTK::writeImageData(const string& file_name)
+  {
+    std::cout << "Writing voxel space to: " << file_name << endl;
+    const char* ext = image_writer->GetDefaultFileExtension();
+    std::string extension("."+std::string(ext));
+    std::string::size_type n = file_name.rfind(extension);
+    if (n == std::string::npos){
+      std::cout << "File name extension should be " << std::string(ext) << endl;
+    }
+    image_writer->SetFileName(file_name.c_str());
+    image_writer->SetInputDataObject(this->igrid);
+    //Raw binary data after the XML header
+    image_writer->SetDataModeToAppended();
+    image_writer->EncodeAppendedDataOff();
+    cout << "Updating writer" <<endl;
+    image_writer->Update();
+    std::cout << "Writing data" <<endl;
+    image_writer->Write();
+    std::cout << "Write file done" <<endl;
+    return *this;
+  }
+
+  VoxelSpaceToVTK& VoxelSpaceToVTK::writeGrid(const string& file_name)
+  {
+    if (grid_type == VOXEL_GRID_TYPE::IMAGE_DATA){
+      return writeImageData(file_name);
+    }
+    return writeStructuredGrid(file_name);
+  }
+
+  SparseVoxelSpaceToVTK::SparseVoxelSpaceToVTK(const double o[3],const double s[3],const vector<string>& attr_names,
+					       double t)
+    :origin{o[0],o[1],o[2]},spacing{s[0],s[1],s[2]},threshold(t),v_attr_cell(attr_names.size())
+  {
+    for (unsigned int d = 0; d < v_attr_cell.size(); d++){
+      v_attr_cell[d]->SetName(attr_names[d].c_str());
+      ugrid->GetCellData()->AddArray(v_attr_cell[d]);
+    }
+    if (attr_names.size() > 0){
+      ugrid->GetCellData()->SetActiveScalars(attr_names[0].c_str());
+    }
+    ugrid->SetPoints(points);
+    ugrid->AllocateEstimate(1024,8);
+  }
+
+  vtkIdType SparseVoxelSpaceToVTK::pointId(int i,int j,int k)
+  {
+    //21 bits for each index
+    const std::uint64_t key = static_cast<std::uint64_t>(i) | (static_cast<std::uint64_t>(j) << 21)
+      | (static_cast<std::uint64_t>(k) << 42);
+    auto it = point_ids.find(key);
+    if (it != point_ids.end()){
+      return it->second;
+    }
+    vtkIdType id = points->InsertNextPoint(origin[0]+i*spacing[0],origin[1]+j*spacing[1],origin[2]+k*spacing[2]);
+    point_ids.emplace(key,id);
+    return id;
+  }
+
+  std::size_t SparseVoxelSpaceToVTK::insertVoxelSpaceData(const double* data,int nx,int ny,int nz,int nd,int k_offset)
+  {
+    assert(static_cast<std::size_t>(nd) == v_attr_cell.size() && "Failed Right number of attribute names");
+    std::size_t n = 0;
+    const double* value = data;
+    //Buffer order, z changes fastest
+    for (int i = 0; i < nx; i++){
+      for (int j = 0; j < ny; j++){
+	for (int k = k_offset; k < k_offset+nz; k++, value += nd){
+	  bool occupied = false;
+	  for (int d = 0; d < nd; d++){
+	    //NaN compares false and is not occupied
+	    occupied = occupied || value[d] > threshold;
+	  }
+	  if (!occupied){
+	    continue;
+	  }
+	  //VTK_HEXAHEDRON corner order: bottom face counterclockwise, then top face
+	  const vtkIdType ids[8]={pointId(i,j,k),pointId(i+1,j,k),pointId(i+1,j+1,k),pointId(i,j+1,k),
+				  pointId(i,j,k+1),pointId(i+1,j,k+1),pointId(i+1,j+1,k+1),pointId(i,j+1,k+1)};
+	  ugrid->InsertNextCell(VTK_HEXAHEDRON,8,ids);
+	  for (int d = 0; d < nd; d++){
+	    const double v = value[d];
+	    v_attr_cell[d]->InsertNextValue((v == v) ? v : 0.0);
+	  }
+	  n++;
+	}
+      }
+    }
+    return n;
+  }
+
+  SparseVoxelSpaceToVTK& SparseVoxelSpaceToVTK::writeUnstructuredGrid(const string& file_name)
+  {
+    std::cout << "Writing " << getNumberOfVoxels() << " occupied voxels to: " << file_name << endl;
+    const char* ext = writer->GetDefaultFileExtension();
+    std::string extension("."+std::string(ext));
+    std::string::size_type n = file_name.rfind(extension);
+    if (n == std::string::npos){
+      std::cout << "File name extension should be " << std::string(ext) << endl;
+    }
+    ugrid->Squeeze();
+    writer->SetFileName(file_name.c_str());
+    writer->SetInputDataObject(this->ugrid);
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    cout << "Updating writer" <<endl;
+    writer->Update();
+    std::cout << "Writing data" <<endl;
+    writer->Write();
+    std::cout << "Write file done" <<endl;
+    return *this;
+  }
+
+  VoxelPyramid::VoxelPyramid(int nx,int ny,int nz,int l,const vector<VOXEL_AGGREGATE>& a)
+    :n{nx,ny,nz},levels(l),aggregate(a),sum(l),count(l)
+  {
+    const std::size_t nd = aggregate.size();
+    for (int level = 1; level <= levels; level++){
+      const std::size_t ncells = static_cast<std::size_t>(getNumberOfCells(level,0))*getNumberOfCells(level,1)
+	*getNumberOfCells(level,2);
+      sum[level-1].assign(ncells*nd,0.0);
+      count[level-1].assign(ncells,0);
+    }
+  }
+
+  VoxelPyramid& VoxelPyramid::insertVoxelSpaceData(const double* data,int nz,int k_offset)
+  {
+    const int nd = aggregate.size();
+    const double* value = data;
+    //Buffer order, z changes fastest
+    for (int i = 0; i < n[0]; i++){
+      for (int j = 0; j < n[1]; j++){
+	for (int k = k_offset; k < k_offset+nz; k++, value += nd){
+	  for (int level = 1; level <= levels; level++){
+	    const std::size_t cell = (i >> level) + static_cast<std::size_t>(getNumberOfCells(level,0))
+	      *((j >> level) + static_cast<std::size_t>(getNumberOfCells(level,1))*(k >> level));
+	    double* s = sum[level-1].data() + cell*nd;
+	    for (int d = 0; d < nd; d++){
+	      const double v = value[d];
+	      //NaN counts as 0 as in TransposeVoxelData
+	      s[d] += (v == v) ? v : 0.0;
+	    }
+	    count[level-1][cell]++;
+	  }
+	}
+      }
+    }
+    return *this;
+  }
+
+  vtkSmartPointer<vtkImageData> VoxelPyramid::getLevel(int level,const double origin[3],const double spacing[3],
+							 const vector<string>& attr_names)const
+  {
+    assert(level >= 1 && level <= levels && "Failed Level in pyramid");
+    assert(attr_names.size() == aggregate.size() && "Failed Right number of attribute names");
+    const int nd = aggregate.size();
+    const int nx = getNumberOfCells(level,0);
+    const int ny = getNumberOfCells(level,1);
+    const int nz = getNumberOfCells(level,2);
+    const double f = static_cast<double>(1 << level);
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    //Cell centred, the number of points is the number of cells plus one
+    image->SetExtent(0,nx,0,ny,0,nz);
+    image->SetOrigin(origin[0],origin[1],origin[2]);
+    image->SetSpacing(f*spacing[0],f*spacing[1],f*spacing[2]);
+    const vector<double>& s = sum[level-1];
+    const vector<std::uint32_t>& c = count[level-1];
+    for (int d = 0; d < nd; d++){
+      vtkNew<vtkDoubleArray> attr;
+      attr->SetName(attr_names[d].c_str());
+      attr->SetNumberOfTuples(c.size());
+      double* a = attr->GetPointer(0);
+      for (std::size_t cell = 0; cell < c.size(); cell++){
+	const double v = s[cell*nd+d];
+	if (aggregate[d] == VOXEL_AGGREGATE::MEAN){
+	  a[cell] = (c[cell] > 0) ? v/c[cell] : 0.0;
+	}
+	else{
+	  a[cell] = v;
+	}
+      }
+      image->GetCellData()->AddArray(attr);
+    }
+    if (nd > 0){
+      image->GetCellData()->SetActiveScalars(attr_names[0].c_str());
+    }
+    return image;
+  }
 }
@@ -0,0 +1,264 @@
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <XMLDirectTreeReader.h>
+
+namespace lignumvtk{
+
+  bool XMLDirectTreeReader::readXMLToCollectedTree(const std::string& file_name,const std::string& tree_id,CollectedTree& ct)
+  {
+    XMLInput input(file_name);
+    if (!input.isOpen()){
+      std::cout << "XMLDirectTreeReader::readXMLToCollectedTree: Cannot open file " << file_name << std::endl;
+      return false;
+    }
+    QXmlStreamReader reader(input.device());
+    return readTree(reader,tree_id,ct);
+  }
+
+  bool XMLDirectTreeReader::readXMLStringToCollectedTree(const std::string& xml,const std::string& tree_id,CollectedTree& ct)
+  {
+    XMLInput input(xml.data(),xml.size());
+    QXmlStreamReader reader(input.device());
+    return readTree(reader,tree_id,ct);
+  }
+
+  bool XMLDirectTreeReader::readTree(QXmlStreamReader& reader,const std::string& tree_id,CollectedTree& ct)
+  {
+    if (!reader.readNextStartElement() || reader.name() != QLatin1String("Tree")){
+      std::cout << "XMLDirectTreeReader: No Tree root element in " << tree_id << std::endl;
+      return false;
+    }
+    ct.tree_type = reader.attributes().value(QLatin1String("SegmentType")).toString().toStdString();
+    if (ct.tree_type.empty()){
+      std::cout << "XMLDirectTreeReader: No SegmentType in the root element of " << tree_id << std::endl;
+      return false;
+    }
+    ct.tree_id = tree_id;
+    broadleaf = (ct.tree_type == "Hw");
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("Axis")){
+	readAxis(reader,ct,ct.segments);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    if (reader.hasError()){
+      std::cout << "XMLDirectTreeReader: " << reader.errorString().toStdString() << " at line "
+		<< reader.lineNumber() << " in " << tree_id << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void XMLDirectTreeReader::readAxis(QXmlStreamReader& reader,CollectedTree& ct,TSDataVector& v)
+  {
+    TSData data;
+    //Branches of each branching point in the axis
+    std::vector<TSDataVector> branches;
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("TreeSegment")){
+	readTreeSegment(reader,ct,data);
+      }
+      else if (reader.name() == QLatin1String("BranchingPoint")){
+	branches.push_back(TSDataVector());
+	while (reader.readNextStartElement()){
+	  if (reader.name() == QLatin1String("Axis")){
+	    readAxis(reader,ct,branches.back());
+	  }
+	  else{
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+      else if (reader.name() == QLatin1String("Bud")){
+	readBud(reader,data);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    if (!data.vpoints.empty()){
+      v.push_back(std::move(data));
+    }
+    //AccumulateDown appends the branches from the axis tip down
+    for (auto it = branches.rbegin(); it != branches.rend(); it++){
+      v.insert(v.end(),std::make_move_iterator(it->begin()),std::make_move_iterator(it->end()));
+    }
+  }
+
+  void XMLDirectTreeReader::readTreeSegment(QXmlStreamReader& reader,CollectedTree& ct,TSData& data)
+  {
+    Point p;
+    double l = 0.0;
+    double r = 0.0;
+    double rh = 0.0;
+    double rf = 0.0;
+    double wf = 0.0;
+    double qin = 0.0;
+    double qabs = 0.0;
+    double prod = 0.0;
+    while (reader.readNextStartElement()){
+      //TreeSegmentAttributes, CfTreeSegmentAttributes or HwTreeSegmentAttributes
+      if (reader.name().endsWith(QLatin1String("TreeSegmentAttributes"))){
+	while (reader.readNextStartElement()){
+	  if (reader.name() == XML_POINT){
+	    p = ReadXMLPoint(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAL")){
+	    l = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAR")){
+	    r = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGARh")){
+	    rh = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAQin")){
+	    qin = ReadXMLValue(reader);
+	  }
+	  //Foliage radius for conifers only as in CollectTSData
+	  else if (!broadleaf && reader.name() == QLatin1String("LGARf")){
+	    rf = ReadXMLValue(reader);
+	  }
+	  //For broadleaves the segment values Lignum wrote, not summed from the leaves here
+	  else if (reader.name() == QLatin1String("LGAWf")){
+	    wf = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAQabs")){
+	    qabs = ReadXMLValue(reader);
+	  }
+	  else if (reader.name() == QLatin1String("LGAP")){
+	    prod = ReadXMLValue(reader);
+	  }
+	  else{
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+      else if (broadleaf && reader.name() == QLatin1String("BroadLeaf")){
+	readBroadLeaf(reader,ct);
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    data.total_length += l;
+    data.vpoints.push_back(p);
+    data.vL.push_back(l);
+    data.vR.push_back(r);
+    data.vRh.push_back(rh);
+    data.vRf.push_back(rf);
+    data.vWf.push_back(wf);
+    data.vQin.push_back(qin);
+    data.vQabs.push_back(qabs);
+    data.vP.push_back(prod);
+    data.vname.push_back(TUBE_RADIUS_SCALAR);
+  }
+
+  void XMLDirectTreeReader::readBud(QXmlStreamReader& reader,TSData& data)
+  {
+    Point p;
+    while (reader.readNextStartElement()){
+      if (reader.name() == QLatin1String("BudAttributes")){
+	while (reader.readNextStartElement()){
+	  if (reader.name() == XML_POINT){
+	    p = ReadXMLPoint(reader);
+	  }
+	  else{
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+      else{
+	reader.skipCurrentElement();
+      }
+    }
+    //The bud point has the data of the segment below as in CollectTSData
+    const bool mother = !data.vpoints.empty();
+    data.vpoints.push_back(p);
+    data.vL.push_back(mother ? data.vL.back() : 0.0);
+    data.vR.push_back(mother ? data.vR.back() : MIN_SEGMENT_RADIUS);
+    data.vRh.push_back(mother ? data.vRh.back() : MIN_SEGMENT_RADIUS);
+    data.vRf.push_back(mother && !broadleaf ? data.vRf.back() : MIN_SEGMENT_RADIUS);
+    data.vWf.push_back(mother ? data.vWf.back() : 0.0);
+    data.vQin.push_back(mother ? data.vQin.back() : 0.0);
+    data.vQabs.push_back(mother ? data.vQabs.back() : 0.0);
+    data.vP.push_back(mother ? data.vP.back() : 0.0);
+    data.vname.push_back(TUBE_RADIUS_SCALAR);
+  }
+
+  void XMLDirectTreeReader::readBroadLeaf(QXmlStreamReader& reader,CollectedTree& ct)
+  {
+    Point petiole_start;
+    Point petiole_end;
+    Point corners[4];
+    int ncorners = 0;
+    double leaf_qin = 0.0;
+    double leaf_qabs = 0.0;
+    double leaf_p = 0.0;
+    while (reader.readNextStartElement()){
+      if (reader.name() != QLatin1String("BroadLeafAttributes")){
+	reader.skipCurrentElement();
+	continue;
+      }
+      while (reader.readNextStartElement()){
+	if (reader.name() == XML_PETIOLE_START){
+	  petiole_start = ReadXMLPoint(reader);
+	}
+	else if (reader.name() == XML_PETIOLE_END){
+	  petiole_end = ReadXMLPoint(reader);
+	}
+	else if (reader.name() == QLatin1String("LGAQin")){
+	  leaf_qin = ReadXMLValue(reader);
+	}
+	else if (reader.name() == QLatin1String("LGAQabs")){
+	  leaf_qabs = ReadXMLValue(reader);
+	}
+	else if (reader.name() == QLatin1String("LGAP")){
+	  leaf_p = ReadXMLValue(reader);
+	}
+	else{
+	  bool found = false;
+	  for (int i = 0; i < 4; i++){
+	    if (reader.name() == XML_KITE_POINTS[i]){
+	      corners[i] = ReadXMLPoint(reader);
+	      ncorners++;
+	      found = true;
+	      break;
+	    }
+	  }
+	  if (!found){
+	    reader.skipCurrentElement();
+	  }
+	}
+      }
+    }
+    if (ncorners != 4){
+      return;
+    }
+    //Petiole as in CollectPetioleData
+    TSData petiole;
+    petiole.vpoints.push_back(petiole_start);
+    petiole.vpoints.push_back(petiole_end);
+    petiole.vR.push_back(LINE_WIDTH);
+    petiole.vR.push_back(LINE_WIDTH);
+    petiole.vname.push_back(LINE_WIDTH_SCALAR);
+    petiole.vname.push_back(LINE_WIDTH_SCALAR);
+    ct.petioles.push_back(std::move(petiole));
+    //Leaf as in CollectLeafData
+    TSData leaf;
+    const Kite shape(corners[0],corners[1],corners[2],corners[3]);
+    leaf.vpoints = shape.getVertexVector(leaf.vpoints);
+    const double area = shape.getArea();
+    for (unsigned int i=0; i < leaf.vpoints.size(); i++){
+      leaf.vA.push_back(area);
+      leaf.vQin.push_back(leaf_qin);
+      leaf.vQabs.push_back(leaf_qabs);
+      leaf.vP.push_back(leaf_p);
+      leaf.vname.push_back(LEAF_AREA_SCALAR);
+    }
+    ct.leaves.push_back(std::move(leaf));
+  }
+}
@@ -0,0 +1,32 @@
+#include <limits>
+#include <XMLInput.h>
+
+namespace lignumvtk{
+
+  XMLInput::XMLInput(const std::string& file_name)
+    :use_file(false)
+  {
+    //QByteArray size is int
+    if (mapped_file.open(file_name) && mapped_file.size() <= static_cast<std::size_t>(std::numeric_limits<int>::max())){
+      openBuffer(mapped_file.data(),mapped_file.size());
+      return;
+    }
+    mapped_file.close();
+    use_file = true;
+    file.setFileName(QString::fromStdString(file_name));
+    file.open(QIODevice::ReadOnly);
+  }
+
+  XMLInput::XMLInput(const char* data,std::size_t n)
+    :use_file(false)
+  {
+    openBuffer(data,n);
+  }
+
+  void XMLInput::openBuffer(const char* data,std::size_t n)
+  {
+    //Raw data is not copied and it is not detached in read only mode
+    buffer.setData(QByteArray::fromRawData(data,static_cast<int>(n)));
+    buffer.open(QIODevice::ReadOnly);
+  }
+}
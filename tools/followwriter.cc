@@ -0,0 +1,150 @@
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <H5Cpp.h>
+#include <ParseCommandLine.h>
+#include <HDF5ToLignum.h>
+/// \file followwriter.cc
+/// \brief Main program for `followwriter`
+///
+/// Stand-in for a running simulation to try `lignumvtk -follow`. The trees of an existing
+/// Lignum HDF5 file are written to a new HDF5 file one year at a time as a simulation would do.
+/// The modes reproduce the cases for the follow mode reader:
+/// - *close*: The file is closed after each year, the reader can open it between the years.
+/// - *open*: The file is kept open in the normal write mode and flushed after each year, HDF5 file
+///   locking prevents reading unless the reader sets `HDF5_USE_FILE_LOCKING=FALSE`.
+///
+/// There is no SWMR (single writer multiple readers) write mode. Each year creates a new group and
+/// new datasets, SWMR writing only allows appending to datasets that exist when SWMR writing starts.
+
+using namespace H5;
+
+///\brief `followwriter` command line
+int Usage()
+{
+  cout << "Usage:" << endl;
+  cout << "./followwriter [-h | -help]" << endl;
+  cout << "./followwriter -input|-i file.h5 -output|-o follow.h5 [-seconds <number>] [-mode close|open]" << endl;
+  cout << "Default values:" <<endl;
+  cout << "-seconds 10" << endl;
+  cout << "-mode close" << endl;
+  cout << "Examples:" << endl;
+  cout << "Write one year every 10 seconds and follow the file in another terminal" << endl;
+  cout << "./followwriter -input File.h5 -output Follow.h5" << endl;
+  cout << "./lignumvtk -input Follow.h5 -output Follow.pvd -follow 5 -idle 60" << endl;
+  cout << "Keep the file open in the normal write mode, the reader needs HDF5_USE_FILE_LOCKING=FALSE" << endl;
+  cout << "./followwriter -input File.h5 -output Follow.h5 -mode open" << endl;
+  cout << "HDF5_USE_FILE_LOCKING=FALSE ./lignumvtk -input Follow.h5 -output Follow.pvd -follow 5 -idle 60" << endl;
+  return EXIT_SUCCESS;
+}
+
+///\brief Write the trees of one year to the output file
+///\param hdf5lignum Input file
+///\param paths Tree dataset paths of the year
+///\param main_group Main group for the trees
+///\param year Simulation year
+///\param file Output file
+void WriteYear(lignumvtk::HDF5ToLignum& hdf5lignum,const vector<string>& paths,const string& main_group,int year,
+	       H5File& file)
+{
+  const string year_group = main_group+std::to_string(year);
+  Group group = file.createGroup(year_group);
+  StrType strdatatype(PredType::C_S1,H5T_VARIABLE);
+  DataSpace strdataspace(H5S_SCALAR);
+  for (const string& path : paths){
+    const string tree_id = path.substr(path.rfind('/')+1);
+    const string xml = hdf5lignum.getLignumTreeString(path);
+    DataSet dataset = group.createDataSet(tree_id,strdatatype,strdataspace);
+    dataset.write(xml,strdatatype,strdataspace);
+  }
+}
+
+///\brief Write the trees of Lignum HDF5 file to a new file one year at a time
+///\sa Usage()
+int main(int argc,char* argv[])
+{
+  if (argc < 2||CheckCommandLine(argc,argv,"-help")||CheckCommandLine(argc,argv,"-h")){
+    return Usage();
+  }
+  std::string input_file;
+  if (!(ParseCommandLine(argc,argv,"-input",input_file)||ParseCommandLine(argc,argv,"-i",input_file))){
+    cout << "No input file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  std::string output_file;
+  if (!(ParseCommandLine(argc,argv,"-output",output_file)||ParseCommandLine(argc,argv,"-o",output_file))){
+    cout << "No output file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  if (output_file == input_file){
+    cout << "The output file must not be the input file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  std::string seconds_str;
+  int seconds = 10;
+  if (ParseCommandLine(argc,argv,"-seconds",seconds_str)){
+    try{
+      seconds = std::stoi(seconds_str);
+    }
+    catch (const std::exception& e){
+      seconds = -1;
+    }
+    if (seconds < 0){
+      cout << "Seconds " << seconds_str << " should be a non-negative number, exiting" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::string mode = "close";
+  ParseCommandLine(argc,argv,"-mode",mode);
+  if (mode != "close" && mode != "open"){
+    cout << "Mode " << mode << " should be close or open, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+
+  lignumvtk::HDF5ToLignum hdf5lignum;
+  hdf5lignum.openFile(input_file);
+  if (hdf5lignum.hasTreeColumns()){
+    cout << "The trees in " << input_file << " are in the columnar layout, use Lignum XML trees" << endl;
+    return EXIT_FAILURE;
+  }
+  const lignumvtk::HDF5TreeIndex& index = hdf5lignum.getTreeIndex();
+  const vector<int> years = index.getYears();
+  if (years.empty()){
+    cout << "No HDF5 datasets for trees in " << input_file << endl;
+    return EXIT_FAILURE;
+  }
+  const string main_group = lignumvtk::TXMLGROUP;
+  try{
+    Exception::dontPrint();
+    H5File file(output_file,H5F_ACC_TRUNC);
+    file.createGroup(main_group.substr(0,main_group.size()-1));
+    if (mode == "close"){
+      file.close();
+    }
+    for (unsigned int i = 0; i < years.size(); i++){
+      if (i > 0){
+	std::this_thread::sleep_for(std::chrono::seconds(seconds));
+      }
+      const vector<string> paths = index.getYear(years[i]);
+      if (mode == "close"){
+	file.openFile(output_file,H5F_ACC_RDWR);
+      }
+      WriteYear(hdf5lignum,paths,main_group,years[i],file);
+      file.flush(H5F_SCOPE_GLOBAL);
+      if (mode == "close"){
+	file.close();
+      }
+      cout << "Year " << years[i] << ": " << paths.size() << " trees written to " << output_file << endl;
+    }
+    //Keep the file open in the open mode until the reader has seen the last year
+    if (mode != "close"){
+      std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    }
+  }
+  catch (H5::Exception e){
+    cout << "Cannot write " << output_file << ": " << e.getDetailMsg() << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "Done, " << years.size() << " years in " << output_file << endl;
+  return EXIT_SUCCESS;
+}
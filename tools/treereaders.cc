@@ -0,0 +1,203 @@
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <ParseCommandLine.h>
+#include <LGMHDF5File.h>
+#include <Lignum.h>
+#include <XMLTree.h>
+#include <HDF5ToLignum.h>
+#include <LignumVTKTree.h>
+#include <LignumVTKXML.h>
+#include <CreateVTPCFile.h>
+/// \file treereaders.cc
+/// \brief Main program for `treereaders`
+///
+/// Compare the tree data collected with the tree readers *dom*, *stream* and *direct*.
+/// The readers should give the same tree segment, petiole and leaf data for coniferous
+/// and broadleaved trees. The first coniferous and the first broadleaved tree in the
+/// HDF5 file are compared unless the tree is given with -dataset.
+
+///\brief Relative tolerance for the collected values
+const double READER_TOLERANCE=1.0e-9;
+
+///\brief `treereaders` command line
+int Usage()
+{
+  cout << "Usage:" << endl;
+  cout << "./treereaders [-h | -help]" << endl;
+  cout << "./treereaders -input|-i file.h5 [-dataset <path_string>]" << endl;
+  cout << "./treereaders -input|-i file.xml" << endl;
+  cout << "Examples:" << endl;
+  cout << "Compare the first coniferous and the first broadleaved tree" << endl;
+  cout << "./treereaders -input File.h5" << endl;
+  cout << "Compare one tree" << endl;
+  cout << "./treereaders -input File.h5 -dataset /TreeXML/20/Tree_8" << endl;
+  return EXIT_SUCCESS;
+}
+
+///\brief Compare two values with READER_TOLERANCE
+bool SameValue(double a,double b)
+{
+  return std::fabs(a-b) <= READER_TOLERANCE*std::max(1.0,std::max(std::fabs(a),std::fabs(b)));
+}
+
+///\brief Compare two vectors of collected values
+///\param what Description for the first difference
+bool SameValues(const vector<double>& v1,const vector<double>& v2,const string& what)
+{
+  if (v1.size() != v2.size()){
+    cout << what << ": " << v1.size() << " and " << v2.size() << " values" << endl;
+    return false;
+  }
+  for (unsigned int i = 0; i < v1.size(); i++){
+    if (!SameValue(v1[i],v2[i])){
+      cout << what << "[" << i << "]: " << v1[i] << " and " << v2[i] << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+///\brief Compare two tree data vectors
+///\param what Description for the first difference
+bool SameTSData(const lignumvtk::TSDataVector& v1,const lignumvtk::TSDataVector& v2,const string& what)
+{
+  if (v1.size() != v2.size()){
+    cout << what << ": " << v1.size() << " and " << v2.size() << " items" << endl;
+    return false;
+  }
+  for (unsigned int i = 0; i < v1.size(); i++){
+    const lignumvtk::TSData& d1 = v1[i];
+    const lignumvtk::TSData& d2 = v2[i];
+    const string item = what+" "+std::to_string(i);
+    vector<double> p1;
+    vector<double> p2;
+    for (const cxxadt::Point& p : d1.vpoints){
+      p1.insert(p1.end(),{p.getX(),p.getY(),p.getZ()});
+    }
+    for (const cxxadt::Point& p : d2.vpoints){
+      p2.insert(p2.end(),{p.getX(),p.getY(),p.getZ()});
+    }
+    if (!(SameValues(p1,p2,item+" points") && SameValues({d1.total_length},{d2.total_length},item+" total length") &&
+	  SameValues(d1.vL,d2.vL,item+" LGAL") &&
+	  SameValues(d1.vR,d2.vR,item+" "+lignumvtk::TUBE_RADIUS_SCALAR) &&
+	  SameValues(d1.vRh,d2.vRh,item+" "+lignumvtk::TUBE_HW_RADIUS_SCALAR) &&
+	  SameValues(d1.vRf,d2.vRf,item+" "+lignumvtk::TUBE_FOLIAGE_RADIUS_SCALAR) &&
+	  SameValues(d1.vWf,d2.vWf,item+" "+lignumvtk::FOLIAGE_MASS_SCALAR) &&
+	  SameValues(d1.vA,d2.vA,item+" "+lignumvtk::LEAF_AREA_SCALAR) &&
+	  SameValues(d1.vQin,d2.vQin,item+" "+lignumvtk::QIN_SCALAR) &&
+	  SameValues(d1.vQabs,d2.vQabs,item+" "+lignumvtk::QABS_SCALAR) &&
+	  SameValues(d1.vP,d2.vP,item+" "+lignumvtk::PHOTOSYNTHESIS_SCALAR))){
+      return false;
+    }
+  }
+  return true;
+}
+
+///\brief Collect one tree with the three readers and compare the data
+///\param input Lignum XML file name or Lignum XML string
+///\param is_file \p input is file name
+///\param tree_type Tree type, "Cf" for coniferous or "Hw" for broadleaved
+///\param tree_id Tree id for the output
+///\return true if the readers agree, false otherwise
+bool CompareReaders(const string& input,bool is_file,const string& tree_type,const string& tree_id)
+{
+  const lignumvtk::TREE_READER readers[] = {lignumvtk::TREE_READER::DOM,lignumvtk::TREE_READER::STREAM,
+					    lignumvtk::TREE_READER::DIRECT};
+  const string names[] = {"dom","stream","direct"};
+  lignumvtk::CollectedTree ct[3];
+  for (int i = 0; i < 3; i++){
+    lignumvtk::XML_TREE_READER = readers[i];
+    if (!lignumvtk::CollectTreeFromXML(input,is_file,tree_type,tree_id,ct[i])){
+      cout << "Tree " << tree_id << " cannot be read with " << names[i] << " reader" << endl;
+      return false;
+    }
+  }
+  lignumvtk::XML_TREE_READER = lignumvtk::TREE_READER::DOM;
+  bool same = true;
+  for (int i = 1; i < 3; i++){
+    const string what = tree_id+" "+names[0]+"/"+names[i];
+    if (!(SameTSData(ct[0].segments,ct[i].segments,what+" segments") &&
+	  SameTSData(ct[0].petioles,ct[i].petioles,what+" petioles") &&
+	  SameTSData(ct[0].leaves,ct[i].leaves,what+" leaves"))){
+      same = false;
+    }
+  }
+  cout << (tree_type == "Hw" ? "Broadleaved" : "Coniferous") << " tree " << tree_id << ": " << ct[0].segments.size()
+       << " axes, " << ct[0].leaves.size() << " leaves, " << (same ? "readers agree" : "readers differ") << endl;
+  return same;
+}
+
+///\brief Compare the tree readers
+///\sa Usage()
+int main(int argc,char* argv[])
+{
+  if (argc < 2||CheckCommandLine(argc,argv,"-help")||CheckCommandLine(argc,argv,"-h")){
+    return Usage();
+  }
+  std::string input_file;
+  if (!(ParseCommandLine(argc,argv,"-input",input_file)||ParseCommandLine(argc,argv,"-i",input_file))){
+    cout << "No input file, exiting" << endl;
+    return EXIT_FAILURE;
+  }
+  if (input_file.find(".xml") != std::string::npos){
+    lignumvtk::LignumVTKXML vtk_xml;
+    vtk_xml.setFileName(input_file);
+    vtk_xml.parse();
+    const string tree_type = vtk_xml.treeType();
+    if (tree_type != "Cf" && tree_type != "Hw"){
+      cout << "No tree type in " << input_file << endl;
+      return EXIT_FAILURE;
+    }
+    return CompareReaders(input_file,true,tree_type,input_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  lignumvtk::HDF5ToLignum hdf5lignum;
+  hdf5lignum.openFile(input_file);
+  if (hdf5lignum.hasTreeColumns()){
+    cout << "The trees in " << input_file << " are in the columnar layout, use Lignum XML trees" << endl;
+    return EXIT_FAILURE;
+  }
+  vector<string> paths;
+  std::string dataset;
+  if (ParseCommandLine(argc,argv,"-dataset",dataset)){
+    paths = lignumvtk::SelectTreeDataSets(hdf5lignum,-1,dataset,"");
+  }
+  else{
+    const lignumvtk::HDF5TreeIndex& index = hdf5lignum.getTreeIndex();
+    for (int year : index.getYears()){
+      const vector<string> v = index.getYear(year);
+      paths.insert(paths.end(),v.begin(),v.end());
+    }
+  }
+  if (paths.empty()){
+    cout << "No HDF5 datasets for trees in " << input_file << endl;
+    return EXIT_FAILURE;
+  }
+  //The first tree of each type, or all trees given with -dataset
+  bool cf_found = false;
+  bool hw_found = false;
+  bool same = true;
+  for (const string& path : paths){
+    const std::string lignum_string = hdf5lignum.getLignumTreeString(path);
+    lignumvtk::LignumVTKXML vtk_xml;
+    vtk_xml.parse(lignum_string);
+    const string tree_type = vtk_xml.treeType();
+    if (dataset.empty() && ((tree_type == "Cf" && cf_found) || (tree_type == "Hw" && hw_found))){
+      continue;
+    }
+    if (tree_type != "Cf" && tree_type != "Hw"){
+      cout << "No tree type in " << path << ", skipping" << endl;
+      continue;
+    }
+    cf_found = cf_found || tree_type == "Cf";
+    hw_found = hw_found || tree_type == "Hw";
+    same = CompareReaders(lignum_string,false,tree_type,path) && same;
+    if (dataset.empty() && cf_found && hw_found){
+      break;
+    }
+  }
+  if (!cf_found && !hw_found){
+    return EXIT_FAILURE;
+  }
+  return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -10,6 +10,7 @@
 #include <LignumVTKTree.h>
 #include <VoxelSpaceToVTK.h>
 #include <CreateVTPCFile.h>
+#include <CreateVoxelSpaceFile.h>
 /// \file vsvtk.cc
 /// \brief Main file for `vsvtk`
 
@@ -18,12 +19,43 @@ int Usage()
 {
   cout << "Usage:" << endl;
   cout << "./vsvtk [-h | -help]" <<endl;
-  cout << "./vsvtk -input|-i file.h5 [-list] [-output|-o file.vts] [-dataset <path_string>] [-edge <integer>]" << endl;
+  cout << "./vsvtk -input|-i file.h5 [-list] [-output|-o file.vts|file.vti] [-dataset <path_string>] [-edge <integer>]" << endl
+       << "[-voi i0:i1,j0:j1,k0:k1] [-stride <integer>] [-attributes <name,name,...>] [-association cell|point|both]" << endl;
+  cout << "./vsvtk -input|-i file.h5 -output|-o file.pvts|file.pvti -dataset <path_string> [-edge <integer>] [-slab <integer>]" << endl
+       << "[-voi i0:i1,j0:j1,k0:k1] [-stride <integer>] [-attributes <name,name,...>] [-association cell|point|both]" << endl;
+  cout << "./vsvtk -input|-i file.h5 -output|-o file.vtu -dataset <path_string> [-sparse <number>] [-edge <integer>] [-slab <integer>]" << endl
+       << "[-voi i0:i1,j0:j1,k0:k1] [-stride <integer>] [-attributes <name,name,...>]" << endl;
+  cout << "./vsvtk -input|-i file.h5 -output|-o file.vtm -dataset <path_string> -pyramid <integer> [-aggregate <name:sum|mean,...>]" << endl
+       << "[-edge <integer>] [-slab <integer>] [-voi i0:i1,j0:j1,k0:k1] [-stride <integer>] [-attributes <name,name,...>]" << endl;
+  cout << "./vsvtk -input|-i file.h5 -output|-o file.vtp -dataset <path_string> -iso <name:value,value,...> [-edge <integer>]" << endl
+       << "[-voi i0:i1,j0:j1,k0:k1] [-stride <integer>]" << endl;
+  cout << "Derived fields for all output files: [-derive \"name=expression; name=expression...\"]" << endl;
+  cout << "Isosurfaces next to other output files: [-iso <name:value,value,...>]" << endl;
+  cout << "./vsvtk -input|-i file.h5 -output|-o file.pvd -all|-pattern <substring> [-format vti|vts|pvti|pvts|vtu|vtm|vtp] [-threads <integer>]" << endl
+       << "[options above for the format]" << endl;
   cout << "Examples:" << endl;
-  cout << "Read voxel space HDF5 and list dataset paths" << endl;
+  cout << "Read voxel space HDF5 and list datasets with voxels, attributes, stored and estimated output sizes" << endl;
   cout << "  ./vsvtk -i File.h5 -list" << endl;
   cout << "Read voxel space HDF5 file and produce VTK/VTS file with voxel edge size 3" << endl;
   cout << "  ./vsvtk -i File.h5 -o VTSFile.vts -edge 3" << endl;
+  cout << "Read voxel space HDF5 file and produce VTK/VTI image data file, no point coordinates are stored" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTIFile.vti" << endl;
+  cout << "Stream voxel space in slabs of 32 voxel layers to pieces of parallel VTK/PVTI file" << endl;
+  cout << "  ./vsvtk -i File.h5 -o PVTIFile.pvti -slab 32" << endl;
+  cout << "Convert voxels 0-99 in x and y and 50-99 in z, every second voxel" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTIFile.vti -voi 0:99,0:99,50:99 -stride 2" << endl;
+  cout << "Convert only attributes Qabs and LAD as cell data" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTIFile.vti -attributes Qabs,LAD -association cell" << endl;
+  cout << "Write only voxels where Qabs or LAD is above 0.01 as hexahedra to VTK/VTU file" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTUFile.vtu -attributes Qabs,LAD -sparse 0.01" << endl;
+  cout << "Write full resolution and 3 coarser levels to VTK/VTM file, sum leaf area A, mean for other attributes" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTMFile.vtm -pyramid 3 -aggregate A:sum" << endl;
+  cout << "Add leaf area density and Qabs/Qin ratio computed from the attributes" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTIFile.vti -derive \"LAD=A/volume; ratio=Qabs/Qin\"" << endl;
+  cout << "Contour leaf area density isosurfaces 0.5 and 1.0 to VTK/VTP file" << endl;
+  cout << "  ./vsvtk -i File.h5 -o VTPFile.vtp -derive \"LAD=A/volume\" -iso LAD:0.5,1.0" << endl;
+  cout << "Convert all voxel spaces with 4 threads to VTK/VTI files and PVD time series" << endl;
+  cout << "  ./vsvtk -i File.h5 -o PVDFile.pvd -all -threads 4" << endl;
   return EXIT_SUCCESS;
 }
 
@@ -52,25 +84,24 @@ int main(int argc, char* argv[])
 
   lignumvtk::HDF5ToVoxelSpace hdf5vs;
   if (list_content){
-    cout << "Dataset names:" << endl;
+    //Only dataset headers and attributes are read
     hdf5vs.openFile(fname);
-    vector<string> v = hdf5vs.getDataSetNames(hdf5vs.getRoot());
-    std::copy(v.begin(),v.end(),std::ostream_iterator<string>(std::cout, "\n"));
-    vector<double> vsdset;
-    lignumvtk::GridData gdata = hdf5vs.getVoxelSpace(v[0],vsdset);
-    std::tuple<double,double,double> v_size = gdata.second;
-    cout << "Single voxel size:" << endl <<
-      std::get<0>(v_size) << " " << std::get<1>(v_size) << " " << std::get<2>(v_size) << endl;
-    cout << "Attribute names:" << endl;
-    vector<string> attr_v = hdf5vs.readAttributeNames();
-    copy(attr_v.begin(),attr_v.end(),std::ostream_iterator<string>(std::cout, "\n"));
-    return EXIT_SUCCESS;
+    string pattern;
+    ParseCommandLine(argc,argv,"-pattern",pattern);
+    return lignumvtk::ListVoxelSpaces(hdf5vs,pattern);
   }
   string dataset_name;
   bool dataset_found = false;
   if (ParseCommandLine(argc,argv,"-dataset",dataset_name)){
     dataset_found = true;
   }
+  //Batch conversion of datasets to PVD time series
+  string pattern;
+  bool batch = false;
+  if (CheckCommandLine(argc,argv,"-all") || ParseCommandLine(argc,argv,"-pattern",pattern)){
+    batch = true;
+    dataset_found = true;
+  }
   if ((dataset_found == false) || (outfile_found == false)){
     if (!dataset_found){
       cout << "No dataset name" << endl;
@@ -81,26 +112,123 @@ int main(int argc, char* argv[])
     cout << "Exiting" << endl;
     return EXIT_FAILURE;
   }
+  //In batch mode the options apply to each dataset file
+  string format = lignumvtk::VTI_EXTENSION;
+  if (batch){
+    if (std::filesystem::path(outfile_name).extension().string() != lignumvtk::PVD_EXTENSION){
+      cout << "Options -all and -pattern require " << lignumvtk::PVD_EXTENSION << " output file" << endl;
+      return EXIT_FAILURE;
+    }
+    string format_name;
+    if (ParseCommandLine(argc,argv,"-format",format_name)){
+      format = "." + format_name;
+      const vector<string> formats = {lignumvtk::VTI_EXTENSION,lignumvtk::VTS_EXTENSION,lignumvtk::PVTI_EXTENSION,
+				      lignumvtk::PVTS_EXTENSION,lignumvtk::VTU_EXTENSION,lignumvtk::VTM_EXTENSION,
+				      lignumvtk::VTP_EXTENSION};
+      if (std::find(formats.begin(),formats.end(),format) == formats.end()){
+	cout << "Format " << format_name << " should be vti, vts, pvti, pvts, vtu, vtm or vtp, exiting" << endl;
+	return EXIT_FAILURE;
+      }
+    }
+  }
+  string threads;
+  unsigned int nthreads = 0;
+  if (ParseCommandLine(argc,argv,"-threads",threads)){
+    int n = -1;
+    try{
+      n = std::stoi(threads);
+    }
+    catch (const std::exception& e){
+      n = -1;
+    }
+    if (n < 0){
+      cout << "Threads " << threads << " should be a non-negative number, exiting" << endl;
+      return EXIT_FAILURE;
+    }
+    nthreads = n;
+  }
+  const string dataset_file = batch ? "dataset" + format : outfile_name;
+  lignumvtk::VoxelSpaceOptions options;
   string vedge;
-  double voxel_edge = 0.0;
   if (ParseCommandLine(argc,argv,"-edge",vedge)){
-    voxel_edge = std::stod(vedge);
+    options.voxel_edge = std::stod(vedge);
+  }
+  string slab;
+  if (ParseCommandLine(argc,argv,"-slab",slab)){
+    options.slab = std::stoi(slab);
+    if (!lignumvtk::IsParallelVoxelSpaceFile(dataset_file) && !lignumvtk::IsSparseVoxelSpaceFile(dataset_file)
+	&& !lignumvtk::IsPyramidVoxelSpaceFile(dataset_file)){
+      cout << "Option -slab requires " << lignumvtk::PVTI_EXTENSION << ", " << lignumvtk::PVTS_EXTENSION
+	   << ", " << lignumvtk::VTU_EXTENSION << " or " << lignumvtk::VTM_EXTENSION << " output file" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  string sparse;
+  if (ParseCommandLine(argc,argv,"-sparse",sparse)){
+    options.sparse_threshold = std::stod(sparse);
+    if (!lignumvtk::IsSparseVoxelSpaceFile(dataset_file)){
+      cout << "Option -sparse requires " << lignumvtk::VTU_EXTENSION << " output file" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  string pyramid;
+  if (ParseCommandLine(argc,argv,"-pyramid",pyramid)){
+    options.pyramid = std::stoi(pyramid);
+  }
+  if ((options.pyramid > 0) != lignumvtk::IsPyramidVoxelSpaceFile(dataset_file)){
+    cout << "Option -pyramid requires " << lignumvtk::VTM_EXTENSION << " output file and vice versa" << endl;
+    return EXIT_FAILURE;
+  }
+  string aggregate;
+  if (ParseCommandLine(argc,argv,"-aggregate",aggregate)){
+    if (!lignumvtk::ParseAggregate(aggregate,options.aggregate)){
+      return EXIT_FAILURE;
+    }
+  }
+  string voi;
+  if (ParseCommandLine(argc,argv,"-voi",voi)){
+    if (!lignumvtk::ParseVoxelRange(voi,options.voi)){
+      return EXIT_FAILURE;
+    }
+  }
+  string stride;
+  if (ParseCommandLine(argc,argv,"-stride",stride)){
+    options.stride = std::stoi(stride);
+  }
+  string attributes;
+  if (ParseCommandLine(argc,argv,"-attributes",attributes)){
+    options.attributes = lignumvtk::ParseNameList(attributes);
+  }
+  string association;
+  if (ParseCommandLine(argc,argv,"-association",association)){
+    if (!lignumvtk::ParseDataAssociation(association,options.association)){
+      return EXIT_FAILURE;
+    }
+  }
+  ParseCommandLine(argc,argv,"-derive",options.derive);
+  string iso;
+  if (ParseCommandLine(argc,argv,"-iso",iso)){
+    if (!lignumvtk::ParseIsoValues(iso,options.iso_attribute,options.iso_values)){
+      return EXIT_FAILURE;
+    }
+  }
+  if (lignumvtk::IsIsosurfaceFile(dataset_file) && options.iso_values.empty()){
+    cout << "Output file " << lignumvtk::VTP_EXTENSION << " requires -iso" << endl;
+    return EXIT_FAILURE;
   }
   cout << "Reading voxel space file" << endl;
   hdf5vs.openFile(fname);
-  vector<double> vsdset;
-  lignumvtk::GridData gdata = hdf5vs.getVoxelSpace(dataset_name,vsdset);
-  std::tuple<int,int,int,int> t_grid = gdata.first;
-  std::tuple<double,double,double> v_size = gdata.second;
-  cxxadt::TMatrix4D<double> vs_data(std::get<0>(t_grid),std::get<1>(t_grid),
-				    std::get<2>(t_grid),std::get<3>(t_grid),vsdset);
-  vector<string> col_names;
-  hdf5vs.readDataSetAttribute(dataset_name,lignumvtk::VOXELBOX_DATA_ATTRIBUTE_NAME,col_names);
-  if (voxel_edge == 0.0){
-    voxel_edge = std::get<0>(v_size);
-  }
-  lignumvtk::VoxelSpaceToVTK vsvtk(vs_data.a(),vs_data.b(),vs_data.c(),voxel_edge,voxel_edge,voxel_edge);
-  vsvtk.insertVoxelSpaceData(vs_data,col_names);
-  vsvtk.writeStructuredGrid(outfile_name);
-  return EXIT_SUCCESS;
+  if (batch){
+    vector<string> all_datasets = hdf5vs.getDataSetNames(hdf5vs.getRoot());
+    vector<string> datasets;
+    //Only voxel spaces, other datasets under the root are skipped
+    lignumvtk::FindSubString match(pattern);
+    for (const string& name : all_datasets){
+      if (match(name) && hdf5vs.isVoxelSpace(name)){
+	datasets.push_back(name);
+      }
+    }
+    return lignumvtk::CreateVoxelSpaceCollection(hdf5vs,datasets,outfile_name,format,options,nthreads);
+  }
+  return lignumvtk::CreateVoxelSpaceFile(hdf5vs,dataset_name,outfile_name,options);
 }